@@ -0,0 +1,83 @@
+#ifndef MOCK_HAL_H
+#define MOCK_HAL_H
+
+/*
+ * Recording side of the host mock HAL (see stm32l0xx_hal.h).
+ *
+ * Time only moves when the host says so: mock_hal_advance_ms() runs the
+ * firmware's SysTick_Handler once per millisecond, and every WFI/WFE/sleep
+ * entry advances one tick (the next SysTick is the next wakeup), unless an
+ * idle hook is installed.
+ */
+
+#include "stm32l0xx_hal.h"
+
+#define MOCK_UART_LPUART1 0U // Shell
+#define MOCK_UART_USART2  1U // Diagnostic stream
+#define MOCK_UART_COUNT   2U
+#define MOCK_UART_CAPTURE_SIZE 16384U // Bytes kept per UART; the byte counters keep counting past it
+#define MOCK_UART_RX_SIZE      1024U
+#define MOCK_EVENT_LOG_SIZE    4096U  // Ring, oldest entries overwritten
+
+typedef enum {
+  MOCK_EV_GPIO_WRITE,     // periph = GPIO port, index = pin mask, value = state (raw BSRR for register writes)
+  MOCK_EV_TIM_COMPARE,    // periph = TIM instance, index = channel, value = compare
+  MOCK_EV_UART_TX,        // periph = USART instance, index = 0, value = byte
+  MOCK_EV_EEPROM_PROGRAM, // periph = NULL, index = program type, address, value
+  MOCK_EV_EEPROM_ERASE    // periph = NULL, address
+} MockEventType_t;
+
+typedef struct {
+  uint32_t tick;   // HAL_GetTick() when recorded
+  uint8_t type;    // MockEventType_t
+  uint16_t index;
+  const void *periph;
+  uint32_t address;
+  uint32_t value;
+} MockEvent_t;
+
+typedef struct {
+  uint32_t gpio_writes;
+  uint32_t tim_compare_writes;
+  uint32_t uart_tx_bytes[MOCK_UART_COUNT];
+  uint32_t eeprom_programs;
+  uint32_t eeprom_erases;
+  uint32_t systick_irqs;
+  uint32_t dma_requests; // Timer-paced DMA words moved (TIM2 update/CC3 waveform)
+  uint32_t irqs[32]; // Handler invocations per IRQn
+  uint32_t sleeps;   // WFI/WFE/sleep-mode entries
+  uint32_t stops;    // Stop mode entries (each lasts until an enabled interrupt is pending)
+} MockHalStats_t;
+
+// LPTIM1 runs from the LSI at this rate, whole ticks per millisecond.
+#define MOCK_LSI_HZ 37000U
+
+extern MockHalStats_t mock_hal_stats;
+
+// Called instead of the one-tick advance when the firmware sleeps.
+typedef void (*MockIdleHook_t)(void);
+
+void mock_hal_reset(void); // Registers, tick, EEPROM (erased = 0), stats, logs, UART buffers
+void mock_hal_advance_ms(uint32_t ms);
+void mock_hal_set_idle_hook(MockIdleHook_t hook);
+
+// Pins configured as inputs read back their last written level unless forced.
+void mock_gpio_set_input(GPIO_TypeDef *port, uint16_t pins, bool high);
+void mock_gpio_release_input(GPIO_TypeDef *port, uint16_t pins);
+void mock_adc_set_value(uint32_t value); // Raw 12-bit result of the next conversion
+// A worn data EEPROM word: programs to it still count, but it keeps its contents.
+void mock_eeprom_set_stuck(uint32_t address, bool stuck);
+
+// Queues host input. Bytes then arrive at the UART's configured baud rate
+// (10 bits each) as virtual time advances; a byte that lands while RXNE is
+// still set is lost and raises ORE, as on the part.
+void mock_uart_rx_push(USART_TypeDef *uart, const uint8_t *data, size_t len);
+size_t mock_uart_rx_pending(USART_TypeDef *uart); // Queued bytes not yet delivered
+size_t mock_uart_tx_length(uint32_t uart_idx);
+const uint8_t *mock_uart_tx_data(uint32_t uart_idx); // Not NUL-terminated
+void mock_uart_tx_clear(uint32_t uart_idx);
+
+uint32_t mock_hal_event_count(void); // Events recorded since reset (may exceed the log size)
+const MockEvent_t *mock_hal_event(uint32_t n); // n-th event since reset, NULL once overwritten
+
+#endif /* MOCK_HAL_H */
@@ -0,0 +1,614 @@
+#ifndef STM32L0XX_HAL_H
+#define STM32L0XX_HAL_H
+
+/*
+ * Host-side stand-in for the STM32CubeL0 HAL.
+ *
+ * Only the subset of types, registers and calls used by the badge firmware is
+ * provided. Peripheral "registers" are plain structs in RAM so register-level
+ * code (BSRR stores, SysTick->VAL reads, DMA setup) compiles and runs unchanged;
+ * HAL calls are recorded by mock_hal.c so a host program can inspect them.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define __IO volatile
+#define __I  volatile const
+#define __STATIC_INLINE static inline
+
+/* Status ------------------------------------------------------------------ */
+typedef enum { HAL_OK = 0x00U, HAL_ERROR = 0x01U, HAL_BUSY = 0x02U, HAL_TIMEOUT = 0x03U } HAL_StatusTypeDef;
+typedef enum { RESET = 0U, SET = !RESET } FlagStatus, ITStatus;
+typedef enum { DISABLE = 0U, ENABLE = !DISABLE } FunctionalState;
+#define HAL_MAX_DELAY 0xFFFFFFFFU
+
+/* Core peripherals -------------------------------------------------------- */
+typedef struct { __IO uint32_t CTRL; __IO uint32_t LOAD; __IO uint32_t VAL; __I uint32_t CALIB; } SysTick_Type;
+typedef struct { __IO uint32_t CPUID; __IO uint32_t ICSR; __IO uint32_t VTOR; __IO uint32_t AIRCR; __IO uint32_t SCR; __IO uint32_t CCR; } SCB_Type;
+
+extern SysTick_Type mock_SysTick;
+extern SCB_Type mock_SCB;
+#define SysTick (&mock_SysTick)
+#define SCB     (&mock_SCB)
+
+#define SysTick_CTRL_ENABLE_Msk    (1UL << 0)
+#define SysTick_CTRL_TICKINT_Msk   (1UL << 1)
+#define SysTick_LOAD_RELOAD_Msk    (0xFFFFFFUL)
+#define SCB_SCR_SLEEPONEXIT_Msk    (1UL << 1)
+#define SCB_SCR_SLEEPDEEP_Msk      (1UL << 2)
+#define SCB_SCR_SEVONPEND_Msk      (1UL << 4)
+#define SCB_ICSR_PENDSTSET_Msk     (1UL << 26) // Never set by the mock: SysTick runs as soon as it is due
+
+typedef enum {
+  SysTick_IRQn = -1,
+  RTC_IRQn = 2, EXTI0_1_IRQn = 5, EXTI2_3_IRQn = 6, EXTI4_15_IRQn = 7,
+  DMA1_Channel1_IRQn = 9, DMA1_Channel2_3_IRQn = 10, DMA1_Channel4_5_6_7_IRQn = 11,
+  ADC1_COMP_IRQn = 12, LPTIM1_IRQn = 13, TIM2_IRQn = 15, TIM21_IRQn = 20, TIM22_IRQn = 22,
+  USART2_IRQn = 28, LPUART1_IRQn = 29
+} IRQn_Type;
+
+void __disable_irq(void);
+void __enable_irq(void);
+void __WFI(void);
+void __WFE(void);
+void __SEV(void);
+void __DSB(void);
+void __ISB(void);
+void __NOP(void);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t primask);
+void NVIC_SystemReset(void);
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority);
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn);
+void HAL_NVIC_ClearPendingIRQ(IRQn_Type IRQn);
+uint32_t HAL_NVIC_GetPendingIRQ(IRQn_Type IRQn);
+
+/* GPIO -------------------------------------------------------------------- */
+typedef struct {
+  __IO uint32_t MODER; __IO uint32_t OTYPER; __IO uint32_t OSPEEDR; __IO uint32_t PUPDR;
+  __IO uint32_t IDR;   __IO uint32_t ODR;    __IO uint32_t BSRR;    __IO uint32_t LCKR;
+  __IO uint32_t AFR[2]; __IO uint32_t BRR;
+} GPIO_TypeDef;
+
+extern GPIO_TypeDef mock_GPIOA, mock_GPIOB, mock_GPIOC;
+#define GPIOA (&mock_GPIOA)
+#define GPIOB (&mock_GPIOB)
+#define GPIOC (&mock_GPIOC)
+
+typedef enum { GPIO_PIN_RESET = 0U, GPIO_PIN_SET } GPIO_PinState;
+typedef struct { uint32_t Pin; uint32_t Mode; uint32_t Pull; uint32_t Speed; uint32_t Alternate; } GPIO_InitTypeDef;
+
+#define GPIO_PIN_0  ((uint16_t)0x0001U)
+#define GPIO_PIN_1  ((uint16_t)0x0002U)
+#define GPIO_PIN_2  ((uint16_t)0x0004U)
+#define GPIO_PIN_3  ((uint16_t)0x0008U)
+#define GPIO_PIN_4  ((uint16_t)0x0010U)
+#define GPIO_PIN_5  ((uint16_t)0x0020U)
+#define GPIO_PIN_6  ((uint16_t)0x0040U)
+#define GPIO_PIN_7  ((uint16_t)0x0080U)
+#define GPIO_PIN_8  ((uint16_t)0x0100U)
+#define GPIO_PIN_9  ((uint16_t)0x0200U)
+#define GPIO_PIN_10 ((uint16_t)0x0400U)
+#define GPIO_PIN_11 ((uint16_t)0x0800U)
+#define GPIO_PIN_12 ((uint16_t)0x1000U)
+#define GPIO_PIN_13 ((uint16_t)0x2000U)
+#define GPIO_PIN_14 ((uint16_t)0x4000U)
+#define GPIO_PIN_15 ((uint16_t)0x8000U)
+
+#define GPIO_MODE_INPUT        0x00000000U
+#define GPIO_MODE_OUTPUT_PP    0x00000001U
+#define GPIO_MODE_OUTPUT_OD    0x00000011U
+#define GPIO_MODE_AF_PP        0x00000002U
+#define GPIO_MODE_AF_OD        0x00000012U
+#define GPIO_MODE_ANALOG       0x00000003U
+#define GPIO_MODE_IT_RISING    0x10110000U
+#define GPIO_MODE_IT_FALLING   0x10210000U
+#define GPIO_MODE_IT_RISING_FALLING 0x10310000U
+#define GPIO_MODE_EXTI_IT      0x00010000U // Mode bits decoded by the mock HAL_GPIO_Init
+#define GPIO_MODE_EXTI_RISING  0x00100000U
+#define GPIO_MODE_EXTI_FALLING 0x00200000U
+#define GPIO_NOPULL   0x00000000U
+#define GPIO_PULLUP   0x00000001U
+#define GPIO_PULLDOWN 0x00000002U
+#define GPIO_SPEED_FREQ_LOW       0x00000000U
+#define GPIO_SPEED_FREQ_MEDIUM    0x00000001U
+#define GPIO_SPEED_FREQ_HIGH      0x00000002U
+#define GPIO_SPEED_FREQ_VERY_HIGH 0x00000003U
+#define GPIO_AF0_LPTIM1   0x00U
+#define GPIO_AF2_TIM2     0x02U
+#define GPIO_AF4_USART2   0x04U
+#define GPIO_AF5_TIM22    0x05U
+#define GPIO_AF6_LPUART1  0x06U
+
+#define GPIO_MODER_MODE0_Pos 0U
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+
+/* EXTI -------------------------------------------------------------------- */
+typedef struct { __IO uint32_t IMR; __IO uint32_t EMR; __IO uint32_t RTSR; __IO uint32_t FTSR; __IO uint32_t SWIER; __IO uint32_t PR; } EXTI_TypeDef;
+extern EXTI_TypeDef mock_EXTI;
+#define EXTI (&mock_EXTI)
+#define __HAL_GPIO_EXTI_GET_IT(__EXTI_LINE__) (EXTI->PR & (__EXTI_LINE__))
+#define __HAL_GPIO_EXTI_CLEAR_IT(__EXTI_LINE__) (EXTI->PR = (__EXTI_LINE__))
+
+/* RCC / PWR / FLASH ------------------------------------------------------- */
+typedef struct { uint32_t PLLState; uint32_t PLLSource; uint32_t PLLMUL; uint32_t PLLDIV; } RCC_PLLInitTypeDef;
+typedef struct {
+  uint32_t OscillatorType; uint32_t HSEState; uint32_t LSEState; uint32_t HSIState; uint32_t HSICalibrationValue;
+  uint32_t LSIState; uint32_t MSIState; uint32_t MSICalibrationValue; uint32_t MSIClockRange; RCC_PLLInitTypeDef PLL;
+} RCC_OscInitTypeDef;
+typedef struct { uint32_t ClockType; uint32_t SYSCLKSource; uint32_t AHBCLKDivider; uint32_t APB1CLKDivider; uint32_t APB2CLKDivider; } RCC_ClkInitTypeDef;
+typedef struct {
+  uint32_t PeriphClockSelection; uint32_t Usart1ClockSelection; uint32_t Usart2ClockSelection; uint32_t Lpuart1ClockSelection;
+  uint32_t I2c1ClockSelection; uint32_t RTCClockSelection; uint32_t LptimClockSelection;
+} RCC_PeriphCLKInitTypeDef;
+
+#define RCC_OSCILLATORTYPE_HSI 0x02U
+#define RCC_OSCILLATORTYPE_LSI 0x08U
+#define RCC_OSCILLATORTYPE_MSI 0x10U
+#define RCC_HSI_ON  0x01U
+#define RCC_HSI_OFF 0x00U
+#define RCC_LSI_ON  0x01U
+#define RCC_MSI_ON  0x01U
+#define RCC_MSI_OFF 0x00U
+#define RCC_HSICALIBRATION_DEFAULT 0x10U
+#define RCC_MSICALIBRATION_DEFAULT 0x00U
+#define RCC_MSIRANGE_0 0U
+#define RCC_MSIRANGE_1 1U
+#define RCC_MSIRANGE_2 2U
+#define RCC_MSIRANGE_3 3U
+#define RCC_MSIRANGE_4 4U
+#define RCC_MSIRANGE_5 5U
+#define RCC_MSIRANGE_6 6U
+#define RCC_PLL_NONE 0x00U
+#define RCC_CLOCKTYPE_SYSCLK 0x01U
+#define RCC_CLOCKTYPE_HCLK   0x02U
+#define RCC_CLOCKTYPE_PCLK1  0x04U
+#define RCC_CLOCKTYPE_PCLK2  0x08U
+#define RCC_SYSCLKSOURCE_MSI 0x00U
+#define RCC_SYSCLKSOURCE_HSI 0x01U
+#define RCC_SYSCLK_DIV1 0x00U
+#define RCC_HCLK_DIV1   0x00U
+#define FLASH_LATENCY_0 0x00U
+#define FLASH_LATENCY_1 0x01U
+#define RCC_PERIPHCLK_USART2  0x02U
+#define RCC_PERIPHCLK_LPUART1 0x04U
+#define RCC_PERIPHCLK_LPTIM1  0x80U
+#define RCC_USART2CLKSOURCE_PCLK1  0x00U
+#define RCC_LPUART1CLKSOURCE_PCLK1 0x00U
+#define RCC_LPUART1CLKSOURCE_HSI   0x02U
+#define RCC_LPTIM1CLKSOURCE_LSI    0x01U
+#define RCC_STOP_WAKEUPCLOCK_MSI 0x00U
+#define RCC_STOP_WAKEUPCLOCK_HSI 0x01U
+#define PWR_REGULATOR_VOLTAGE_SCALE1 0x01U
+#define PWR_REGULATOR_VOLTAGE_SCALE2 0x02U
+#define PWR_REGULATOR_VOLTAGE_SCALE3 0x03U
+#define PWR_LOWPOWERREGULATOR_ON 0x01U
+#define PWR_MAINREGULATOR_ON     0x00U
+#define PWR_STOPENTRY_WFI 0x01U
+#define PWR_SLEEPENTRY_WFI 0x01U
+#define PWR_SLEEPENTRY_WFE 0x02U
+
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *RCC_OscInitStruct);
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t FLatency);
+HAL_StatusTypeDef HAL_RCCEx_PeriphCLKConfig(RCC_PeriphCLKInitTypeDef *PeriphClkInit);
+uint32_t HAL_RCC_GetHCLKFreq(void);
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+uint32_t HAL_RCC_GetSysClockFreq(void);
+extern uint32_t SystemCoreClock;
+void HAL_PWR_EnterSTOPMode(uint32_t Regulator, uint8_t STOPEntry);
+void HAL_PWR_EnterSLEEPMode(uint32_t Regulator, uint8_t SLEEPEntry);
+void HAL_PWREx_EnableUltraLowPower(void);
+void HAL_PWREx_EnableFastWakeUp(void);
+
+#define __HAL_RCC_PWR_CLK_ENABLE()      ((void)0)
+#define __HAL_RCC_GPIOA_CLK_ENABLE()    ((void)0)
+#define __HAL_RCC_GPIOB_CLK_ENABLE()    ((void)0)
+#define __HAL_RCC_GPIOC_CLK_ENABLE()    ((void)0)
+#define __HAL_RCC_LPUART1_CLK_ENABLE()  ((void)0)
+#define __HAL_RCC_LPUART1_CLK_DISABLE() ((void)0)
+#define __HAL_RCC_USART2_CLK_ENABLE()   ((void)0)
+#define __HAL_RCC_USART2_CLK_DISABLE()  ((void)0)
+#define __HAL_RCC_TIM2_CLK_ENABLE()     ((void)0)
+#define __HAL_RCC_TIM2_CLK_DISABLE()    ((void)0)
+#define __HAL_RCC_TIM21_CLK_ENABLE()    ((void)0)
+#define __HAL_RCC_TIM21_CLK_DISABLE()   ((void)0)
+#define __HAL_RCC_TIM22_CLK_ENABLE()    ((void)0)
+#define __HAL_RCC_TIM22_CLK_DISABLE()   ((void)0)
+#define __HAL_RCC_ADC1_CLK_ENABLE()     ((void)0)
+#define __HAL_RCC_ADC1_CLK_DISABLE()    ((void)0)
+#define __HAL_RCC_SYSCFG_CLK_ENABLE()   ((void)0)
+#define __HAL_RCC_DMA1_CLK_ENABLE()     ((void)0)
+#define __HAL_RCC_LPTIM1_CLK_ENABLE()   ((void)0)
+#define __HAL_RCC_LPTIM1_CLK_DISABLE()  ((void)0)
+#define __HAL_PWR_VOLTAGESCALING_CONFIG(x) ((void)(x))
+void mock_rcc_wakeup_clock(uint32_t clock); // Stop mode exit lands on this clock
+#define __HAL_RCC_WAKEUPSTOP_CLK_CONFIG(x) mock_rcc_wakeup_clock(x)
+
+/* FLASH / data EEPROM ----------------------------------------------------- */
+#define FLASH_TYPEPROGRAMDATA_BYTE     0x00U
+#define FLASH_TYPEPROGRAMDATA_HALFWORD 0x01U
+#define FLASH_TYPEPROGRAMDATA_WORD     0x02U
+/* Data EEPROM lives in a host array; the firmware's absolute address is mapped onto it. */
+#define DATA_EEPROM_BASE ((uint32_t)0x08080000U)
+#define DATA_EEPROM_END  ((uint32_t)0x080803FFU)
+extern uint8_t mock_eeprom[DATA_EEPROM_END - DATA_EEPROM_BASE + 1U];
+#define MOCK_EEPROM_PTR(addr) ((void *)&mock_eeprom[(uint32_t)(addr) - DATA_EEPROM_BASE])
+#define EEPROM_READ_WORD(addr) (*(volatile uint32_t *)MOCK_EEPROM_PTR(addr))
+HAL_StatusTypeDef HAL_FLASHEx_DATAEEPROM_Unlock(void);
+HAL_StatusTypeDef HAL_FLASHEx_DATAEEPROM_Lock(void);
+HAL_StatusTypeDef HAL_FLASHEx_DATAEEPROM_Program(uint32_t TypeProgram, uint32_t Address, uint32_t Data);
+HAL_StatusTypeDef HAL_FLASHEx_DATAEEPROM_Erase(uint32_t Address);
+
+/* DMA --------------------------------------------------------------------- */
+typedef struct { __IO uint32_t CCR; __IO uint32_t CNDTR; __IO uint32_t CPAR; __IO uint32_t CMAR; } DMA_Channel_TypeDef;
+extern DMA_Channel_TypeDef mock_DMA1_Channel[7];
+#define DMA1_Channel1 (&mock_DMA1_Channel[0])
+#define DMA1_Channel2 (&mock_DMA1_Channel[1])
+#define DMA1_Channel3 (&mock_DMA1_Channel[2])
+#define DMA1_Channel4 (&mock_DMA1_Channel[3])
+#define DMA1_Channel5 (&mock_DMA1_Channel[4])
+#define DMA1_Channel6 (&mock_DMA1_Channel[5])
+#define DMA1_Channel7 (&mock_DMA1_Channel[6])
+
+typedef struct {
+  uint32_t Request; uint32_t Direction; uint32_t PeriphInc; uint32_t MemInc;
+  uint32_t PeriphDataAlignment; uint32_t MemDataAlignment; uint32_t Mode; uint32_t Priority;
+} DMA_InitTypeDef;
+
+typedef enum { HAL_DMA_STATE_RESET = 0, HAL_DMA_STATE_READY = 1, HAL_DMA_STATE_BUSY = 2 } HAL_DMA_StateTypeDef;
+
+typedef struct __DMA_HandleTypeDef {
+  DMA_Channel_TypeDef *Instance;
+  DMA_InitTypeDef Init;
+  HAL_DMA_StateTypeDef State;
+  void *Parent;
+  void (*XferCpltCallback)(struct __DMA_HandleTypeDef *hdma);
+  void (*XferHalfCpltCallback)(struct __DMA_HandleTypeDef *hdma);
+  void (*XferErrorCallback)(struct __DMA_HandleTypeDef *hdma);
+  uint32_t ErrorCode;
+} DMA_HandleTypeDef;
+
+#define DMA_REQUEST_0 0U
+#define DMA_REQUEST_4 4U
+#define DMA_REQUEST_5 5U
+#define DMA_REQUEST_8 8U
+#define DMA_PERIPH_TO_MEMORY 0x00U
+#define DMA_MEMORY_TO_PERIPH 0x10U
+#define DMA_PINC_ENABLE  0x40U
+#define DMA_PINC_DISABLE 0x00U
+#define DMA_MINC_ENABLE  0x80U
+#define DMA_MINC_DISABLE 0x00U
+#define DMA_PDATAALIGN_BYTE     0x000U
+#define DMA_PDATAALIGN_HALFWORD 0x100U
+#define DMA_PDATAALIGN_WORD     0x200U
+#define DMA_MDATAALIGN_BYTE     0x000U
+#define DMA_MDATAALIGN_HALFWORD 0x400U
+#define DMA_MDATAALIGN_WORD     0x800U
+#define DMA_NORMAL   0x00U
+#define DMA_CIRCULAR 0x20U
+#define DMA_PRIORITY_LOW    0x0000U
+#define DMA_PRIORITY_MEDIUM 0x1000U
+#define DMA_PRIORITY_HIGH   0x2000U
+#define DMA_CCR_EN   (1UL << 0)
+#define DMA_CCR_TCIE (1UL << 1)
+#define DMA_CCR_HTIE (1UL << 2)
+#define DMA_CCR_TEIE (1UL << 3)
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma);
+HAL_StatusTypeDef HAL_DMA_DeInit(DMA_HandleTypeDef *hdma);
+HAL_StatusTypeDef HAL_DMA_Start(DMA_HandleTypeDef *hdma, uint32_t SrcAddress, uint32_t DstAddress, uint32_t DataLength);
+HAL_StatusTypeDef HAL_DMA_Start_IT(DMA_HandleTypeDef *hdma, uint32_t SrcAddress, uint32_t DstAddress, uint32_t DataLength);
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma);
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma);
+#define __HAL_DMA_GET_COUNTER(__HANDLE__) ((__HANDLE__)->Instance->CNDTR)
+#define __HAL_LINKDMA(__HANDLE__, __PPP_DMA_FIELD__, __DMA_HANDLE__) \
+  do { (__HANDLE__)->__PPP_DMA_FIELD__ = &(__DMA_HANDLE__); (__DMA_HANDLE__).Parent = (__HANDLE__); } while (0)
+
+/* TIM --------------------------------------------------------------------- */
+typedef struct {
+  __IO uint32_t CR1; __IO uint32_t CR2; __IO uint32_t SMCR; __IO uint32_t DIER; __IO uint32_t SR; __IO uint32_t EGR;
+  __IO uint32_t CCMR1; __IO uint32_t CCMR2; __IO uint32_t CCER; __IO uint32_t CNT; __IO uint32_t PSC; __IO uint32_t ARR;
+  uint32_t RESERVED12; __IO uint32_t CCR1; __IO uint32_t CCR2; __IO uint32_t CCR3; __IO uint32_t CCR4;
+  uint32_t RESERVED17; __IO uint32_t DCR; __IO uint32_t DMAR; __IO uint32_t OR;
+} TIM_TypeDef;
+
+extern TIM_TypeDef mock_TIM2, mock_TIM21, mock_TIM22;
+#define TIM2  (&mock_TIM2)
+#define TIM21 (&mock_TIM21)
+#define TIM22 (&mock_TIM22)
+
+#define TIM_CR1_CEN  (1UL << 0)
+#define TIM_CR1_UDIS (1UL << 1)
+#define TIM_CR1_URS  (1UL << 2)
+#define TIM_CR1_OPM  (1UL << 3)
+#define TIM_SR_UIF   (1UL << 0)
+#define TIM_SR_CC1IF (1UL << 1)
+#define TIM_DIER_UIE (1UL << 0)
+#define TIM_EGR_UG   (1UL << 0)
+
+typedef struct {
+  uint32_t Prescaler; uint32_t CounterMode; uint32_t Period; uint32_t ClockDivision;
+  uint32_t RepetitionCounter; uint32_t AutoReloadPreload;
+} TIM_Base_InitTypeDef;
+typedef struct { uint32_t ClockSource; uint32_t ClockPolarity; uint32_t ClockPrescaler; uint32_t ClockFilter; } TIM_ClockConfigTypeDef;
+typedef struct { uint32_t MasterOutputTrigger; uint32_t MasterSlaveMode; } TIM_MasterConfigTypeDef;
+typedef struct { uint32_t OCMode; uint32_t Pulse; uint32_t OCPolarity; uint32_t OCFastMode; } TIM_OC_InitTypeDef;
+
+typedef enum { HAL_TIM_STATE_RESET = 0, HAL_TIM_STATE_READY = 1, HAL_TIM_STATE_BUSY = 2 } HAL_TIM_StateTypeDef;
+
+typedef struct {
+  TIM_TypeDef *Instance;
+  TIM_Base_InitTypeDef Init;
+  DMA_HandleTypeDef *hdma[7];
+  HAL_TIM_StateTypeDef State;
+} TIM_HandleTypeDef;
+
+#define TIM_COUNTERMODE_UP 0x00U
+#define TIM_CLOCKDIVISION_DIV1 0x00U
+#define TIM_AUTORELOAD_PRELOAD_DISABLE 0x00U
+#define TIM_AUTORELOAD_PRELOAD_ENABLE  0x80U
+#define TIM_CLOCKSOURCE_INTERNAL 0x1000U
+#define TIM_TRGO_RESET  0x00U
+#define TIM_TRGO_UPDATE 0x20U
+#define TIM_MASTERSLAVEMODE_DISABLE 0x00U
+#define TIM_OCMODE_TIMING 0x00U
+#define TIM_OCMODE_PWM1   0x60U
+#define TIM_OCPOLARITY_HIGH 0x00U
+#define TIM_OCFAST_DISABLE 0x00U
+#define TIM_CHANNEL_1 0x00U
+#define TIM_CHANNEL_2 0x04U
+#define TIM_CHANNEL_3 0x08U
+#define TIM_CHANNEL_4 0x0CU
+#define TIM_EVENTSOURCE_UPDATE TIM_EGR_UG
+#define TIM_IT_UPDATE TIM_DIER_UIE
+#define TIM_FLAG_UPDATE TIM_SR_UIF
+#define TIM_DMA_UPDATE (1UL << 8)
+#define TIM_DMA_CC1    (1UL << 9)
+#define TIM_DMA_CC2    (1UL << 10)
+#define TIM_DMA_CC3    (1UL << 11)
+#define TIM_DMA_CC4    (1UL << 12)
+#define TIM_DMA_ID_UPDATE 0U
+#define TIM_DMA_ID_CC1 1U
+#define TIM_DMA_ID_CC2 2U
+#define TIM_DMA_ID_CC3 3U
+#define TIM_DMA_ID_CC4 4U
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Stop(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_PWM_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Stop(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *htim, TIM_OC_InitTypeDef *sConfig, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_OC_ConfigChannel(TIM_HandleTypeDef *htim, TIM_OC_InitTypeDef *sConfig, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_ConfigClockSource(TIM_HandleTypeDef *htim, TIM_ClockConfigTypeDef *sClockSourceConfig);
+HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef *htim, TIM_MasterConfigTypeDef *sMasterConfig);
+HAL_StatusTypeDef HAL_TIM_GenerateEvent(TIM_HandleTypeDef *htim, uint32_t EventSource);
+
+/* Compare writes are routed through the mock so they can be recorded. */
+void mock_tim_set_compare(TIM_HandleTypeDef *htim, uint32_t channel, uint32_t compare);
+uint32_t mock_tim_get_compare(TIM_HandleTypeDef *htim, uint32_t channel);
+#define __HAL_TIM_SET_COMPARE(__HANDLE__, __CHANNEL__, __COMPARE__) mock_tim_set_compare((__HANDLE__), (__CHANNEL__), (__COMPARE__))
+#define __HAL_TIM_GET_COMPARE(__HANDLE__, __CHANNEL__) mock_tim_get_compare((__HANDLE__), (__CHANNEL__))
+#define __HAL_TIM_SET_AUTORELOAD(__HANDLE__, __AUTORELOAD__) do { (__HANDLE__)->Instance->ARR = (__AUTORELOAD__); (__HANDLE__)->Init.Period = (__AUTORELOAD__); } while (0)
+#define __HAL_TIM_GET_AUTORELOAD(__HANDLE__) ((__HANDLE__)->Instance->ARR)
+#define __HAL_TIM_SET_PRESCALER(__HANDLE__, __PRESC__) ((__HANDLE__)->Instance->PSC = (__PRESC__))
+#define __HAL_TIM_SET_COUNTER(__HANDLE__, __COUNTER__) ((__HANDLE__)->Instance->CNT = (__COUNTER__))
+#define __HAL_TIM_GET_COUNTER(__HANDLE__) ((__HANDLE__)->Instance->CNT)
+#define __HAL_TIM_ENABLE(__HANDLE__)  ((__HANDLE__)->Instance->CR1 |= TIM_CR1_CEN)
+#define __HAL_TIM_DISABLE(__HANDLE__) ((__HANDLE__)->Instance->CR1 &= ~TIM_CR1_CEN)
+#define __HAL_TIM_ENABLE_IT(__HANDLE__, __INTERRUPT__)  ((__HANDLE__)->Instance->DIER |= (__INTERRUPT__))
+#define __HAL_TIM_DISABLE_IT(__HANDLE__, __INTERRUPT__) ((__HANDLE__)->Instance->DIER &= ~(__INTERRUPT__))
+#define __HAL_TIM_ENABLE_DMA(__HANDLE__, __DMA__)  ((__HANDLE__)->Instance->DIER |= (__DMA__))
+#define __HAL_TIM_DISABLE_DMA(__HANDLE__, __DMA__) ((__HANDLE__)->Instance->DIER &= ~(__DMA__))
+#define __HAL_TIM_GET_FLAG(__HANDLE__, __FLAG__) (((__HANDLE__)->Instance->SR & (__FLAG__)) == (__FLAG__))
+#define __HAL_TIM_CLEAR_FLAG(__HANDLE__, __FLAG__) ((__HANDLE__)->Instance->SR = ~(uint32_t)(__FLAG__))
+#define __HAL_TIM_CLEAR_IT(__HANDLE__, __INTERRUPT__) ((__HANDLE__)->Instance->SR = ~(uint32_t)(__INTERRUPT__))
+#define __HAL_TIM_URS_ENABLE(__HANDLE__) ((__HANDLE__)->Instance->CR1 |= TIM_CR1_URS)
+
+/* LPTIM ------------------------------------------------------------------- */
+typedef struct {
+  __IO uint32_t ISR; __IO uint32_t ICR; __IO uint32_t IER; __IO uint32_t CFGR; __IO uint32_t CR;
+  __IO uint32_t CMP; __IO uint32_t ARR; __IO uint32_t CNT;
+} LPTIM_TypeDef;
+extern LPTIM_TypeDef mock_LPTIM1;
+#define LPTIM1 (&mock_LPTIM1)
+#define LPTIM_ISR_CMPM    (1UL << 0)
+#define LPTIM_ISR_ARRM    (1UL << 1)
+#define LPTIM_ISR_CMPOK   (1UL << 3)
+#define LPTIM_ISR_ARROK   (1UL << 4)
+#define LPTIM_ICR_CMPMCF  (1UL << 0)
+#define LPTIM_ICR_ARRMCF  (1UL << 1)
+#define LPTIM_ICR_CMPOKCF (1UL << 3)
+#define LPTIM_ICR_ARROKCF (1UL << 4)
+#define LPTIM_IER_CMPMIE  (1UL << 0)
+#define LPTIM_IER_ARRMIE  (1UL << 1)
+#define LPTIM_CR_ENABLE   (1UL << 0)
+#define LPTIM_CR_SNGSTRT  (1UL << 1)
+#define LPTIM_CR_CNTSTRT  (1UL << 2)
+
+/* UART -------------------------------------------------------------------- */
+typedef struct {
+  __IO uint32_t CR1; __IO uint32_t CR2; __IO uint32_t CR3; __IO uint32_t BRR; __IO uint32_t GTPR; __IO uint32_t RTOR;
+  __IO uint32_t RQR; __IO uint32_t ISR; __IO uint32_t ICR; __IO uint32_t RDR; __IO uint32_t TDR;
+} USART_TypeDef;
+
+extern USART_TypeDef mock_LPUART1, mock_USART2;
+#define LPUART1 (&mock_LPUART1)
+#define USART2  (&mock_USART2)
+
+typedef struct {
+  uint32_t BaudRate; uint32_t WordLength; uint32_t StopBits; uint32_t Parity; uint32_t Mode;
+  uint32_t HwFlowCtl; uint32_t OverSampling; uint32_t OneBitSampling;
+} UART_InitTypeDef;
+typedef struct { uint32_t AdvFeatureInit; } UART_AdvFeatureInitTypeDef;
+typedef struct { uint32_t WakeUpEvent; uint16_t AddressLength; uint8_t Address; } UART_WakeUpTypeDef;
+
+typedef enum { HAL_UART_STATE_RESET = 0x00U, HAL_UART_STATE_READY = 0x20U, HAL_UART_STATE_BUSY_TX = 0x21U } HAL_UART_StateTypeDef;
+
+typedef struct __UART_HandleTypeDef {
+  USART_TypeDef *Instance;
+  UART_InitTypeDef Init;
+  UART_AdvFeatureInitTypeDef AdvancedInit;
+  const uint8_t *pTxBuffPtr;
+  uint16_t TxXferSize;
+  DMA_HandleTypeDef *hdmatx;
+  DMA_HandleTypeDef *hdmarx;
+  __IO HAL_UART_StateTypeDef gState;
+  __IO HAL_UART_StateTypeDef RxState;
+  __IO uint32_t ErrorCode;
+} UART_HandleTypeDef;
+
+#define UART_WORDLENGTH_8B 0x00U
+#define UART_STOPBITS_1 0x00U
+#define UART_PARITY_NONE 0x00U
+#define UART_MODE_TX_RX 0x0CU
+#define UART_HWCONTROL_NONE 0x00U
+#define UART_OVERSAMPLING_16 0x00U
+#define UART_DIV_LPUART(__PCLK__, __BAUD__) ((uint32_t)((((uint64_t)(__PCLK__)) * 256U + ((__BAUD__) / 2U)) / (__BAUD__)))
+#define UART_DIV_SAMPLING16(__PCLK__, __BAUD__) (((__PCLK__) + ((__BAUD__) / 2U)) / (__BAUD__))
+#define UART_ONE_BIT_SAMPLE_DISABLE 0x00U
+#define UART_ADVFEATURE_NO_INIT 0x00U
+#define UART_WAKEUP_ON_STARTBIT 0x200000U
+#define HAL_UART_ERROR_NONE 0x00U
+#define HAL_UART_ERROR_PE   0x01U
+#define HAL_UART_ERROR_NE   0x02U
+#define HAL_UART_ERROR_FE   0x04U
+#define HAL_UART_ERROR_ORE  0x08U
+#define HAL_UART_ERROR_DMA  0x10U
+
+#define USART_CR1_UE     (1UL << 0)
+#define USART_CR1_UESM   (1UL << 1)
+#define USART_CR1_RE     (1UL << 2)
+#define USART_CR1_TE     (1UL << 3)
+#define USART_CR1_RXNEIE (1UL << 5)
+#define USART_CR1_TCIE   (1UL << 6)
+#define USART_CR1_TXEIE  (1UL << 7)
+#define USART_CR3_EIE    (1UL << 0)
+#define USART_CR3_DMAT   (1UL << 7)
+#define USART_CR3_WUFIE  (1UL << 22)
+#define USART_ISR_PE   (1UL << 0)
+#define USART_ISR_FE   (1UL << 1)
+#define USART_ISR_NE   (1UL << 2)
+#define USART_ISR_ORE  (1UL << 3)
+#define USART_ISR_RXNE (1UL << 5)
+#define USART_ISR_TC   (1UL << 6)
+#define USART_ISR_TXE  (1UL << 7)
+#define USART_ISR_BUSY (1UL << 16)
+#define USART_ISR_WUF  (1UL << 20)
+#define USART_ICR_PECF  (1UL << 0)
+#define USART_ICR_FECF  (1UL << 1)
+#define USART_ICR_NCF   (1UL << 2)
+#define USART_ICR_ORECF (1UL << 3)
+#define USART_ICR_TCCF  (1UL << 6)
+#define USART_ICR_WUCF  (1UL << 20)
+#define UART_CLEAR_PEF  USART_ICR_PECF
+#define UART_CLEAR_FEF  USART_ICR_FECF
+#define UART_CLEAR_NEF  USART_ICR_NCF
+#define UART_CLEAR_OREF USART_ICR_ORECF
+#define UART_CLEAR_WUF  USART_ICR_WUCF
+#define UART_FLAG_RXNE USART_ISR_RXNE
+#define UART_FLAG_ORE  USART_ISR_ORE
+#define UART_FLAG_TC   USART_ISR_TC
+#define UART_FLAG_WUF  USART_ISR_WUF
+#define UART_IT_RXNE   0x0525U
+#define UART_IT_ERR    0x0060U
+#define UART_IT_WUF    0x1476U
+
+/* ICR writes clear ISR bits, and RDR reads clear RXNE; both go through the mock. */
+void mock_uart_clear_flags(UART_HandleTypeDef *huart, uint32_t icr);
+uint32_t mock_uart_read_rdr(USART_TypeDef *uart);
+#define UART_READ_RDR(instance) mock_uart_read_rdr(instance)
+#define __HAL_UART_CLEAR_IT(__HANDLE__, __IT_CLEAR__) mock_uart_clear_flags((__HANDLE__), (uint32_t)(__IT_CLEAR__))
+#define __HAL_UART_GET_FLAG(__HANDLE__, __FLAG__) (((__HANDLE__)->Instance->ISR & (__FLAG__)) == (__FLAG__))
+#define __HAL_UART_CLEAR_FLAG(__HANDLE__, __FLAG__) mock_uart_clear_flags((__HANDLE__), (uint32_t)(__FLAG__))
+#define __HAL_UART_ENABLE(__HANDLE__)  ((__HANDLE__)->Instance->CR1 |= USART_CR1_UE)
+#define __HAL_UART_DISABLE(__HANDLE__) ((__HANDLE__)->Instance->CR1 &= ~USART_CR1_UE)
+void mock_uart_enable_it(UART_HandleTypeDef *huart, uint32_t it, bool enable);
+#define __HAL_UART_ENABLE_IT(__HANDLE__, __IT__)  mock_uart_enable_it((__HANDLE__), (__IT__), true)
+#define __HAL_UART_DISABLE_IT(__HANDLE__, __IT__) mock_uart_enable_it((__HANDLE__), (__IT__), false)
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_DeInit(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_AbortTransmit(UART_HandleTypeDef *huart);
+void HAL_UART_IRQHandler(UART_HandleTypeDef *huart);
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UARTEx_StopModeWakeUpSourceConfig(UART_HandleTypeDef *huart, UART_WakeUpTypeDef WakeUpSelection);
+HAL_StatusTypeDef HAL_UARTEx_EnableStopMode(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UARTEx_DisableStopMode(UART_HandleTypeDef *huart);
+
+/* ADC --------------------------------------------------------------------- */
+typedef struct {
+  __IO uint32_t ISR; __IO uint32_t IER; __IO uint32_t CR; __IO uint32_t CFGR1; __IO uint32_t CFGR2; __IO uint32_t SMPR;
+  uint32_t RESERVED[8]; __IO uint32_t DR;
+} ADC_TypeDef;
+extern ADC_TypeDef mock_ADC1;
+#define ADC1 (&mock_ADC1)
+
+typedef struct { uint32_t Ratio; uint32_t RightBitShift; uint32_t TriggeredMode; } ADC_OversamplingTypeDef;
+typedef struct {
+  uint32_t ClockPrescaler; uint32_t Resolution; uint32_t DataAlign; uint32_t ScanConvMode; uint32_t EOCSelection;
+  uint32_t LowPowerAutoWait; uint32_t LowPowerAutoPowerOff; uint32_t ContinuousConvMode; uint32_t DiscontinuousConvMode;
+  uint32_t ExternalTrigConv; uint32_t ExternalTrigConvEdge; uint32_t DMAContinuousRequests; uint32_t Overrun;
+  uint32_t LowPowerFrequencyMode; uint32_t SamplingTime; uint32_t OversamplingMode; ADC_OversamplingTypeDef Oversample;
+} ADC_InitTypeDef;
+typedef struct { uint32_t Channel; uint32_t Rank; } ADC_ChannelConfTypeDef;
+typedef struct { ADC_TypeDef *Instance; ADC_InitTypeDef Init; __IO uint32_t State; __IO uint32_t ErrorCode; } ADC_HandleTypeDef;
+
+#define ADC_CLOCK_SYNC_PCLK_DIV2 0x40000000U
+#define ADC_RESOLUTION_12B 0x00U
+#define ADC_SAMPLETIME_160CYCLES_5 0x07U
+#define ADC_DATAALIGN_RIGHT 0x00U
+#define ADC_EXTERNALTRIGCONVEDGE_NONE 0x00U
+#define ADC_SOFTWARE_START 0x10U
+#define ADC_EOC_SINGLE_CONV 0x04U
+#define ADC_OVR_DATA_PRESERVED 0x00U
+#define ADC_OVR_DATA_OVERWRITTEN 0x1000U
+#define ADC_CHANNEL_VREFINT 0x44020000U
+#define ADC_SINGLE_ENDED 0x00U
+#define ADC_OVERSAMPLING_RATIO_16 0x0CU
+#define ADC_RIGHTBITSHIFT_4 0x80U
+#define ADC_TRIGGEREDMODE_SINGLE_TRIGGER 0x00U
+
+HAL_StatusTypeDef HAL_ADC_Init(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_DeInit(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_ConfigChannel(ADC_HandleTypeDef *hadc, ADC_ChannelConfTypeDef *sConfig);
+HAL_StatusTypeDef HAL_ADCEx_Calibration_Start(ADC_HandleTypeDef *hadc, uint32_t SingleDiff);
+HAL_StatusTypeDef HAL_ADC_Start(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_Start_IT(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_Stop(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_Stop_IT(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_PollForConversion(ADC_HandleTypeDef *hadc, uint32_t Timeout);
+uint32_t HAL_ADC_GetValue(ADC_HandleTypeDef *hadc);
+void HAL_ADC_IRQHandler(ADC_HandleTypeDef *hadc);
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADCEx_EnableVREFINT(void);
+void HAL_ADCEx_DisableVREFINT(void);
+/* VREFINT factory calibration word (read at 3.0 V on the part). */
+extern uint16_t mock_vrefint_cal;
+#define VREFINT_CAL_ADDR (&mock_vrefint_cal)
+
+/* System ------------------------------------------------------------------ */
+HAL_StatusTypeDef HAL_Init(void);
+void HAL_IncTick(void);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+void HAL_SuspendTick(void);
+void HAL_ResumeTick(void);
+HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority);
+extern __IO uint32_t uwTick;
+
+#endif /* STM32L0XX_HAL_H */
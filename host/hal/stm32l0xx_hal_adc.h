@@ -0,0 +1,7 @@
+#ifndef STM32L0XX_HAL_ADC_H
+#define STM32L0XX_HAL_ADC_H
+
+/* Folded into the host stm32l0xx_hal.h. */
+#include "stm32l0xx_hal.h"
+
+#endif /* STM32L0XX_HAL_ADC_H */
@@ -0,0 +1,106 @@
+/*
+ * Host smoke run of the firmware modules on the mock HAL.
+ *
+ * Brings the badge up with the firmware's app_init(), plays every LED effect for a few
+ * seconds of virtual time, sends a shell command, and prints what the mock
+ * recorded plus the wall-clock cost of update_led_visuals() on this machine.
+ *
+ * Exits 1 if an effect writes no LED output in its window: animated effects
+ * must keep writing after the frame that switched to them.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "stm32l0xx_hal.h"
+#include "mock_hal.h"
+#include "main.h"
+#include "hal_init.h"
+#include "led_control.h"
+#include "challenge.h"
+#include "shell.h"
+#include "sw_pwm.h"
+#include "serial.h"
+
+#define EFFECT_RUN_MS 5000U
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void badge_init(void) {
+  mock_hal_reset();
+  app_init(); // Same bring-up as the firmware's main()
+}
+
+static void print_stats(const char *label) {
+  printf("  %-10s gpio=%u ccr=%u lpuart1=%uB usart2=%uB eeprom=%u systick=%u tim21=%u\n", label,
+         (unsigned)mock_hal_stats.gpio_writes, (unsigned)mock_hal_stats.tim_compare_writes,
+         (unsigned)mock_hal_stats.uart_tx_bytes[MOCK_UART_LPUART1],
+         (unsigned)mock_hal_stats.uart_tx_bytes[MOCK_UART_USART2],
+         (unsigned)mock_hal_stats.eeprom_programs, (unsigned)mock_hal_stats.systick_irqs,
+         (unsigned)mock_hal_stats.irqs[TIM21_IRQn]);
+}
+
+// GPIO and compare writes: hardware PWM duty, software PWM edges, full on/off
+static uint32_t led_output_writes(void) {
+  return mock_hal_stats.gpio_writes + mock_hal_stats.tim_compare_writes;
+}
+
+int main(void) {
+  static const struct {
+    AppEffect_t effect;
+    bool animated; // Changes after its first frame (ALL_ON is written once)
+  } effects[] = {
+    { EFFECT_STRIKE, true }, { EFFECT_BREATHE, true }, { EFFECT_CRACKLE, true }, { EFFECT_SCANNER, true },
+    { EFFECT_CONVERGE_DIVERGE, true }, { EFFECT_ALL_ON, false }, { EFFECT_OFF, true }
+  };
+  int failures = 0;
+
+  badge_init();
+  printf("boot: EEPROM programs=%u (repair status initialised)\n", (unsigned)mock_hal_stats.eeprom_programs);
+
+  printf("effects (%u ms virtual each):\n", EFFECT_RUN_MS);
+  for (size_t i = 0; i < sizeof(effects) / sizeof(effects[0]); i++) {
+    effect = effects[i].effect;
+    burstActive = (effect == EFFECT_STRIKE);
+    uint32_t calls = 0;
+    double spent = 0.0;
+    uint32_t writes_at_start = led_output_writes();
+    uint32_t writes_after_switch = 0;
+    for (uint32_t ms = 0; ms < EFFECT_RUN_MS; ms++) {
+      double t0 = now_ns();
+      update_led_visuals(HAL_GetTick());
+      spent += now_ns() - t0;
+      calls++;
+      mock_hal_advance_ms(1U);
+      if (ms == 0U) writes_after_switch = led_output_writes();
+    }
+    char label[16];
+    snprintf(label, sizeof(label), "effect %d", (int)effects[i].effect);
+    print_stats(label);
+    printf("             update_led_visuals: %.0f ns/call over %u calls\n", spent / calls, (unsigned)calls);
+    uint32_t since = effects[i].animated ? writes_after_switch : writes_at_start;
+    if (led_output_writes() == since) {
+      printf("FAIL effect %d: no LED output %s\n", (int)effects[i].effect,
+             effects[i].animated ? "after the switch frame" : "in its window");
+      failures++;
+    }
+  }
+
+  serial_tx_flush(); // Banner output still queued from app_init()
+  mock_uart_tx_clear(MOCK_UART_LPUART1);
+  const char *cmd = "help\r";
+  for (size_t i = 0; i < strlen(cmd); i++) {
+    shell_process_char((uint8_t)cmd[i], &hlpuart1);
+  }
+  uint32_t queued_at = HAL_GetTick();
+  serial_tx_flush(); // DMA drains the shell queue in virtual time
+  printf("shell 'help': queued, on the wire after %u ms\n", (unsigned)(HAL_GetTick() - queued_at));
+  printf("shell 'help': %u bytes on LPUART1\n", (unsigned)mock_uart_tx_length(MOCK_UART_LPUART1));
+  printf("events recorded: %u\n", (unsigned)mock_hal_event_count());
+  return failures ? 1 : 0;
+}
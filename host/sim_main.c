@@ -0,0 +1,251 @@
+/*
+ * Virtual-time badge simulator.
+ *
+ * Runs the real main loop (app_init + app_loop_once) on the mock HAL. Time
+ * only advances when the firmware sleeps, one SysTick per sleep entry, so a
+ * simulated day takes seconds. Reports the production totals we care about:
+ * LED update rate, EEPROM wear, UART traffic, interrupt load and Stop mode use.
+ *
+ *   j5_sim [--duration 6h] [--repaired] [--diag] [--touch-every 30s]
+ *          [--paste "diag list;bat"]   (typed into the shell at 115200 baud after 1 s)
+ *
+ * Exits 1 if an animated effect went longer than the longest op in the effect
+ * tables without an update, or, with --paste, if any pasted byte was dropped
+ * for want of RX ring room.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stm32l0xx_hal.h"
+#include "mock_hal.h"
+#include "main.h"
+#include "challenge.h"
+#include "led_control.h"
+#include "utils.h"
+#include "serial.h"
+#include "touch.h"
+#include "power.h"
+#include "clock_gov.h"
+
+#define SIM_DEFAULT_DURATION_MS (60ULL * 60ULL * 1000ULL) // 1 hour
+#define SIM_TOUCH_HOLD_MS 100U
+#define SIM_PASTE_AT_MS 1000U
+// Beyond any deadline an effect sets: an update returning this is static
+#define SIM_LED_STATIC_PROBE_MS 0x40000000UL
+// Loop passes allowed at one tick before the simulator charges a busy tick.
+// A pass that never sleeps would otherwise stall virtual time.
+#define SIM_MAX_PASSES_PER_TICK 64U
+
+typedef struct {
+  uint64_t duration_ms;
+  bool repaired;        // Start with all three repairs done (effects unlocked, touch active)
+  bool diag_stream;     // Diagnostic stream on USART2 enabled
+  uint64_t touch_period_ms; // Tap the pad this often, 0 = never
+  const char *paste;        // Shell input, ';' separates commands
+} SimConfig_t;
+
+typedef struct {
+  uint64_t elapsed_ms;
+  uint64_t loop_passes;
+  uint64_t busy_ticks;
+  uint64_t led_updates;
+  uint32_t led_last_update;
+  uint32_t led_max_gap_ms;  // Longest stretch without an update_led_visuals call while animated
+  bool led_animated;        // The last update left a frame due (not a static effect)
+  uint64_t repair_saves;
+  uint64_t systick_irqs;   // mock counters are 32-bit; accumulated here per tick
+  uint64_t tim21_irqs;
+} SimTotals_t;
+
+static SimConfig_t sim_cfg;
+static SimTotals_t sim;
+static bool sim_touching;
+
+/* Call counters on firmware functions (linked with -Wl,--wrap) ------------- */
+// --wrap only sees calls between modules; EEPROM programs are counted by the mock.
+void __real_update_led_visuals(uint32_t now);
+void __wrap_update_led_visuals(uint32_t now) {
+  if (sim.led_animated && now - sim.led_last_update > sim.led_max_gap_ms) sim.led_max_gap_ms = now - sim.led_last_update;
+  sim.led_last_update = now;
+  sim.led_updates++;
+  __real_update_led_visuals(now);
+  sim.led_animated = led_visuals_next_deadline(now, now + SIM_LED_STATIC_PROBE_MS) != now + SIM_LED_STATIC_PROBE_MS;
+}
+
+void __real_save_repair_status(void);
+void __wrap_save_repair_status(void) {
+  sim.repair_saves++;
+  __real_save_repair_status();
+}
+
+/* Virtual time ------------------------------------------------------------ */
+static void sim_apply_inputs(void) {
+  bool touch = false;
+  if (sim_cfg.touch_period_ms > 0U) {
+    touch = (sim.elapsed_ms % sim_cfg.touch_period_ms) < SIM_TOUCH_HOLD_MS && sim.elapsed_ms >= sim_cfg.touch_period_ms;
+  }
+  if (touch != sim_touching) {
+    // A touched pad discharges at once: the pin reads low right after charging
+    if (touch) mock_gpio_set_input(CAP_PAD_PORT, CAP_PAD_PIN, false);
+    else mock_gpio_release_input(CAP_PAD_PORT, CAP_PAD_PIN);
+    sim_touching = touch;
+  }
+}
+
+static void sim_paste(const char *text) {
+  for (const char *p = text; *p != '\0'; p++) {
+    uint8_t c = (*p == ';') ? '\r' : (uint8_t)*p;
+    mock_uart_rx_push(LPUART1, &c, 1U);
+  }
+  uint8_t cr = '\r';
+  mock_uart_rx_push(LPUART1, &cr, 1U);
+}
+
+static void sim_tick(void) {
+  if (sim_cfg.paste != NULL && sim.elapsed_ms == SIM_PASTE_AT_MS) sim_paste(sim_cfg.paste);
+  uint32_t systick_before = mock_hal_stats.systick_irqs;
+  uint32_t tim21_before = mock_hal_stats.irqs[TIM21_IRQn];
+  sim_apply_inputs();
+  mock_hal_advance_ms(1U);
+  sim.elapsed_ms++;
+  sim.systick_irqs += mock_hal_stats.systick_irqs - systick_before;
+  sim.tim21_irqs += mock_hal_stats.irqs[TIM21_IRQn] - tim21_before;
+}
+
+/* Setup and report -------------------------------------------------------- */
+static bool parse_duration(const char *text, uint64_t *out_ms) {
+  char *end;
+  double value = strtod(text, &end);
+  double scale = 1000.0; // Plain numbers are seconds
+  if (end == text || value < 0) return false;
+  if (strcmp(end, "ms") == 0) scale = 1.0;
+  else if (strcmp(end, "s") == 0 || *end == '\0') scale = 1000.0;
+  else if (strcmp(end, "m") == 0) scale = 60000.0;
+  else if (strcmp(end, "h") == 0) scale = 3600000.0;
+  else if (strcmp(end, "d") == 0) scale = 86400000.0;
+  else return false;
+  *out_ms = (uint64_t)(value * scale);
+  return true;
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr, "usage: %s [--duration N[ms|s|m|h|d]] [--repaired] [--diag] [--touch-every N[ms|s|m|h|d]]\n"
+                  "          [--paste \"cmd;cmd...\"]\n", prog);
+}
+
+static void preload_repaired_status(void) {
+  uint32_t magic = J5_REPAIR_MAGIC_NUMBER;
+  uint8_t status[4] = { 1, 1, 1, (uint8_t)EFFECT_BREATHE };
+  memcpy(MOCK_EEPROM_PTR(EEPROM_REPAIR_STATUS_ADDRESS), &magic, sizeof(magic));
+  memcpy(MOCK_EEPROM_PTR(EEPROM_REPAIR_STATUS_ADDRESS + 4U), status, sizeof(status));
+}
+
+static void print_rate(const char *label, uint64_t count, double seconds) {
+  printf("  %-26s %12llu  (%.2f/s)\n", label, (unsigned long long)count, seconds > 0.0 ? (double)count / seconds : 0.0);
+}
+
+static void print_report(double wall_s) {
+  double sim_s = (double)sim.elapsed_ms / 1000.0;
+  double days = sim_s / 86400.0;
+  printf("simulated %.1f s (%.3f days) in %.2f s wall, %.0fx real time\n", sim_s, days, wall_s, wall_s > 0.0 ? sim_s / wall_s : 0.0);
+  print_rate("update_led_visuals calls", sim.led_updates, sim_s);
+  printf("  %-26s %12u ms  (animated; longest effect op %u ms)\n", "longest LED update gap", (unsigned)sim.led_max_gap_ms,
+         (unsigned)led_longest_op_ms());
+  print_rate("main loop passes", sim.loop_passes, sim_s);
+  // Calls only: the mock holds SysTick->VAL still while a handler runs, so the
+  // profiler's durations and latency read 0 here. Use the `isr` shell command
+  // on the board for those.
+  print_rate("SysTick ISR invocations", sim.systick_irqs, sim_s);
+  print_rate("TIM21 (SW PWM) ISRs", sim.tim21_irqs, sim_s);
+  printf("  %-26s %12llu\n", "busy ticks (no sleep)", (unsigned long long)sim.busy_ticks);
+  PowerStats_t ps;
+  get_power_stats(&ps);
+  printf("  %-26s %12u  (%.1f%% of the time stopped, %u woken early)\n", "Stop mode entries", (unsigned)mock_hal_stats.stops,
+         sim.elapsed_ms > 0U ? 100.0 * (ps.stop_ms[CLOCK_FAST] + ps.stop_ms[CLOCK_SLOW]) / (double)sim.elapsed_ms : 0.0,
+         (unsigned)ps.stop_early);
+  ClockStats_t cs;
+  get_clock_stats(&cs);
+  printf("  %-26s %12lu  (%.1f%% of the time on MSI, %lu steps down)\n", "clock steps up", (unsigned long)cs.steps_up,
+         sim.elapsed_ms > 0U ? 100.0 * cs.ms[CLOCK_SLOW] / (double)sim.elapsed_ms : 0.0, (unsigned long)cs.steps_down);
+  printf("  %-26s %12llu  (%.1f/day)\n", "save_repair_status calls", (unsigned long long)sim.repair_saves,
+         days > 0.0 ? (double)sim.repair_saves / days : 0.0);
+  printf("  %-26s %12u  (%.1f/day)\n", "EEPROM word programs", (unsigned)mock_hal_stats.eeprom_programs,
+         days > 0.0 ? (double)mock_hal_stats.eeprom_programs / days : 0.0);
+  printf("  %-26s %12u  (%.1f B/s)\n", "LPUART1 (shell) bytes", (unsigned)mock_hal_stats.uart_tx_bytes[MOCK_UART_LPUART1],
+         sim_s > 0.0 ? mock_hal_stats.uart_tx_bytes[MOCK_UART_LPUART1] / sim_s : 0.0);
+  printf("  %-26s %12u  (%.1f B/s)\n", "USART2 (diag) bytes", (unsigned)mock_hal_stats.uart_tx_bytes[MOCK_UART_USART2],
+         sim_s > 0.0 ? mock_hal_stats.uart_tx_bytes[MOCK_UART_USART2] / sim_s : 0.0);
+  SerialRxStats_t rx;
+  get_serial_rx_stats(&rx);
+  printf("  %-26s %12lu  (%lu dropped: %lu ring full, %lu UART overrun)\n", "shell bytes received", (unsigned long)rx.rx_bytes,
+         (unsigned long)(rx.ring_overruns + rx.hw_overruns), (unsigned long)rx.ring_overruns, (unsigned long)rx.hw_overruns);
+  SerialTxStats_t tx;
+  get_serial_tx_stats(&tx);
+  printf("  %-26s %12lu  (%lu copied, %lu from catalog, %lu DMA transfers, %lu stalls)\n", "shell bytes queued",
+         (unsigned long)tx.tx_bytes, (unsigned long)tx.copied_bytes, (unsigned long)tx.expanded_bytes,
+         (unsigned long)tx.transfers, (unsigned long)tx.stalls);
+}
+
+int main(int argc, char **argv) {
+  sim_cfg.duration_ms = SIM_DEFAULT_DURATION_MS;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+      if (!parse_duration(argv[++i], &sim_cfg.duration_ms)) { usage(argv[0]); return 2; }
+    } else if (strcmp(argv[i], "--touch-every") == 0 && i + 1 < argc) {
+      if (!parse_duration(argv[++i], &sim_cfg.touch_period_ms)) { usage(argv[0]); return 2; }
+    } else if (strcmp(argv[i], "--paste") == 0 && i + 1 < argc) {
+      sim_cfg.paste = argv[++i];
+    } else if (strcmp(argv[i], "--repaired") == 0) {
+      sim_cfg.repaired = true;
+    } else if (strcmp(argv[i], "--diag") == 0) {
+      sim_cfg.diag_stream = true;
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  mock_hal_reset();
+  if (sim_cfg.repaired) preload_repaired_status();
+  mock_hal_set_idle_hook(sim_tick);
+
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+
+  app_init();
+  if (sim_cfg.diag_stream) diagnostic_stream_active = true;
+
+  uint32_t passes_this_tick = 0;
+  while (sim.elapsed_ms < sim_cfg.duration_ms) {
+    uint64_t before = sim.elapsed_ms;
+    app_loop_once();
+    sim.loop_passes++;
+    if (sim.elapsed_ms != before) {
+      passes_this_tick = 0;
+    } else if (++passes_this_tick >= SIM_MAX_PASSES_PER_TICK) {
+      passes_this_tick = 0;
+      sim.busy_ticks++;
+      sim_tick();
+    }
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  double wall_s = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+  print_report(wall_s);
+  int status = 0;
+  if (sim.led_max_gap_ms > led_longest_op_ms()) {
+    fprintf(stderr, "LED updates stalled %lu ms, longer than any effect op (%u ms)\n", (unsigned long)sim.led_max_gap_ms,
+            (unsigned)led_longest_op_ms());
+    status = 1;
+  }
+  SerialRxStats_t rx;
+  get_serial_rx_stats(&rx);
+  if (sim_cfg.paste != NULL && rx.ring_overruns != 0U) {
+    fprintf(stderr, "paste: %lu bytes dropped with the RX ring full\n", (unsigned long)rx.ring_overruns);
+    status = 1;
+  }
+  return status;
+}
@@ -0,0 +1,80 @@
+/*
+ * Regression check: an effect switched to after another has played for a long
+ * time must animate at once.
+ *
+ * Plays each animated effect for ten minutes of virtual time the way the
+ * tickless main loop does (update, then sleep to the next deadline), switches
+ * to each other one, and fails if the new effect leaves its LEDs unchanged, or
+ * its next deadline further out, than SWITCH_WINDOW_MS.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "stm32l0xx_hal.h"
+#include "mock_hal.h"
+#include "main.h"
+#include "led_control.h"
+#include "led_fx.h"
+
+#define LONG_RUN_MS (10UL * 60UL * 1000UL) // Far past the window: a stale deadline would stall the new effect this long
+#define SWITCH_WINDOW_MS 2000U
+#define IDLE_MS 1000U // As POWER_MAX_IDLE_MS: the main loop never sleeps longer
+
+static void snapshot(uint8_t levels[FX_NUM_CHANNELS]) {
+  for (uint8_t pos = 0; pos < FX_NUM_BAR; pos++) levels[pos] = fx_get_bar_level(pos);
+  for (uint8_t ch = FX_NUM_BAR; ch < FX_NUM_CHANNELS; ch++) levels[ch] = fx_get_level(ch);
+}
+
+// One frame, then sleep to its deadline. Returns the time slept.
+static uint32_t step(void) {
+  uint32_t now = HAL_GetTick();
+  update_led_visuals(now);
+  uint32_t wait = led_visuals_next_deadline(now, now + IDLE_MS) - now;
+  mock_hal_advance_ms(wait ? wait : 1U);
+  return wait;
+}
+
+static int check_switch(AppEffect_t from, AppEffect_t to) {
+  effect = from;
+  uint32_t start = HAL_GetTick();
+  while (HAL_GetTick() - start < LONG_RUN_MS) step();
+
+  effect = to;
+  uint8_t before[FX_NUM_CHANNELS], after[FX_NUM_CHANNELS];
+  update_led_visuals(HAL_GetTick()); // The switch itself
+  snapshot(before);
+  uint32_t switched = HAL_GetTick();
+  uint32_t first_wait = led_visuals_next_deadline(switched, switched + LONG_RUN_MS) - switched;
+  bool changed = false;
+  while (!changed && HAL_GetTick() - switched < SWITCH_WINDOW_MS) {
+    step();
+    snapshot(after);
+    changed = memcmp(before, after, sizeof(before)) != 0;
+  }
+  if (first_wait > SWITCH_WINDOW_MS || !changed) {
+    printf("FAIL %s -> %s: next frame in %lu ms, LEDs %s within %u ms\n", getEffectName(from), getEffectName(to),
+           (unsigned long)first_wait, changed ? "changed" : "unchanged", SWITCH_WINDOW_MS);
+    return 1;
+  }
+  printf("ok   %s -> %s: changed after %lu ms\n", getEffectName(from), getEffectName(to),
+         (unsigned long)(HAL_GetTick() - switched));
+  return 0;
+}
+
+int main(void) {
+  static const AppEffect_t animated[] = {
+    EFFECT_CRACKLE, EFFECT_BREATHE, EFFECT_SCANNER, EFFECT_CONVERGE_DIVERGE
+  };
+  const size_t count = sizeof(animated) / sizeof(animated[0]);
+
+  mock_hal_reset();
+  app_init();
+  int failures = 0;
+  for (size_t i = 0; i < count; i++) {
+    for (size_t j = 0; j < count; j++) {
+      if (i != j) failures += check_switch(animated[i], animated[j]);
+    }
+  }
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * Recovery paths of the data EEPROM journal (journal.c).
+ *
+ * Each case writes records through the journal, damages the mock EEPROM the
+ * way a reset or a worn cell would, then re-runs journal_init as a reboot does
+ * and checks which record it settles on and where the next one goes.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "stm32l0xx_hal.h"
+#include "mock_hal.h"
+#include "sched.h"
+#include "journal.h"
+#include "challenge.h"
+
+#define FIRST_SLOT 1U // As load_repair_status: slot 0 may hold the pre-journal layout
+
+static int failures;
+
+static void check(bool ok, const char *what) {
+  printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) failures++;
+}
+
+static uint32_t slot_address(uint16_t slot) {
+  return DATA_EEPROM_BASE + (uint32_t)slot * JOURNAL_RECORD_SIZE;
+}
+
+static JournalStats_t stats(void) {
+  JournalStats_t st;
+  get_journal_stats(&st);
+  return st;
+}
+
+// Power-up: the scheduler is rebuilt before the journal registers again.
+static bool reboot(uint32_t *payload) {
+  sched_init();
+  *payload = 0U;
+  return journal_init(payload, FIRST_SLOT);
+}
+
+static void fresh(void) {
+  uint32_t payload;
+  mock_hal_reset();
+  reboot(&payload);
+}
+
+static void test_torn_seal(void) {
+  uint32_t payload;
+  fresh();
+  journal_write(0x11111111U, true);
+  journal_write(0x22222222U, true);
+  uint16_t torn = stats().slot;
+  // Reset while the second word was being programmed: payload in, seal half-written
+  *(volatile uint32_t *)MOCK_EEPROM_PTR(slot_address(torn) + 4U) &= 0xFFFF0000U;
+  bool found = reboot(&payload);
+  check(found && payload == 0x11111111U, "torn seal: previous record is current");
+  check(stats().slot == (uint16_t)(torn - 1U), "torn seal: newest slot is the one before it");
+  journal_write(0x33333333U, true);
+  check(stats().slot == torn && reboot(&payload) && payload == 0x33333333U, "torn seal: next record reuses the torn slot");
+}
+
+static void test_readback_retry(void) {
+  uint32_t payload;
+  fresh();
+  journal_write(0x11111111U, true);
+  uint16_t worn = (uint16_t)(stats().slot + 1U);
+  mock_eeprom_set_stuck(slot_address(worn), true);
+  journal_write(0x22222222U, true);
+  JournalStats_t st = stats();
+  check(st.commits == 2U && st.slot == worn + 1U, "read-back: record moves past a worn slot");
+  check(reboot(&payload) && payload == 0x22222222U && stats().slot == worn + 1U, "read-back: reboot finds it");
+
+  // Every try fails: the last good record stays current
+  fresh();
+  journal_write(0x11111111U, true);
+  uint16_t good = stats().slot;
+  for (uint16_t i = 1; i <= 4U; i++) mock_eeprom_set_stuck(slot_address(good + i) + 4U, true);
+  journal_write(0x22222222U, true);
+  check(stats().commits == 1U, "read-back: no commit when every try fails");
+  check(reboot(&payload) && payload == 0x11111111U && stats().slot == good, "read-back: reboot keeps the last good record");
+}
+
+static void test_slot_wrap(void) {
+  uint32_t payload;
+  const uint32_t writes = JOURNAL_SLOTS + 5U;
+  fresh();
+  for (uint32_t i = 0; i < writes; i++) journal_write(0x1000U + i, true);
+  check(stats().slot == (FIRST_SLOT + writes - 1U) % JOURNAL_SLOTS, "slot wrap: writes go round the ring");
+  check(reboot(&payload) && payload == 0x1000U + writes - 1U, "slot wrap: reboot finds the newest record");
+  check(stats().slot == (FIRST_SLOT + writes - 1U) % JOURNAL_SLOTS && stats().seq == writes,
+        "slot wrap: newest slot and sequence restored");
+}
+
+static void test_seq_wrap(void) {
+  uint32_t payload;
+  const uint32_t writes = 0x10000UL + 10U;
+  fresh();
+  for (uint32_t i = 0; i < writes; i++) journal_write(0x20000000UL + i, true);
+  // Live records now span sequence numbers 0xFF8B..0xFFFF and 0x0000..0x000A
+  check(reboot(&payload) && payload == 0x20000000UL + writes - 1U, "sequence wrap: reboot finds the newest record");
+  check(stats().seq == (uint16_t)writes && stats().slot == (FIRST_SLOT + writes - 1U) % JOURNAL_SLOTS,
+        "sequence wrap: newest slot and sequence restored");
+}
+
+static void test_legacy_import(void) {
+  uint32_t payload;
+  const uint32_t legacy = 0x03010101U; // All three repairs done, effect 3
+  mock_hal_reset();
+  *(volatile uint32_t *)MOCK_EEPROM_PTR(EEPROM_REPAIR_STATUS_ADDRESS) = J5_REPAIR_MAGIC_NUMBER;
+  *(volatile uint32_t *)MOCK_EEPROM_PTR(EEPROM_REPAIR_STATUS_ADDRESS + 4U) = legacy;
+  sched_init();
+  load_repair_status();
+  check(repair_status.challenge1_completed && repair_status.challenge2_completed &&
+        repair_status.challenge3_completed && repair_status.last_unlocked_effect == 3U, "legacy: slot 0 layout loaded");
+  check(stats().commits == 1U && stats().slot == FIRST_SLOT, "legacy: imported into the first journal slot");
+  check(EEPROM_READ_WORD(EEPROM_REPAIR_STATUS_ADDRESS) == J5_REPAIR_MAGIC_NUMBER, "legacy: slot 0 left intact");
+
+  uint32_t programs = mock_hal_stats.eeprom_programs;
+  memset(&repair_status, 0, sizeof(repair_status));
+  sched_init();
+  load_repair_status();
+  check(repair_status.last_unlocked_effect == 3U && mock_hal_stats.eeprom_programs == programs,
+        "legacy: second boot reads the journal without importing again");
+  check(reboot(&payload) && payload == legacy, "legacy: journal holds the imported word");
+}
+
+int main(void) {
+  test_torn_seal();
+  test_readback_retry();
+  test_slot_wrap();
+  test_seq_wrap();
+  test_legacy_import();
+  return failures ? 1 : 0;
+}
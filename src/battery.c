@@ -0,0 +1,115 @@
+#include "battery.h"
+#include "hal_init.h" // For hadc
+#include "sched.h"
+
+static volatile bool bat_result_ready; // Set by the EOC callback
+static volatile uint16_t bat_raw;
+static uint32_t bat_started_at;
+static SchedId_t bat_result_task = SCHED_NONE;
+
+static uint32_t bat_filtered_q; // mV << BATTERY_FILTER_SHIFT
+static uint16_t bat_last_mv;
+static uint32_t bat_last_sample_at;
+static uint16_t bat_trend_ref_mv;
+static int16_t bat_trend_mv;
+static bool bat_trend_valid;
+static uint8_t bat_trend_count;
+static uint32_t bat_samples;
+static uint32_t bat_failures;
+
+// VDDA = 3.0 V * VREFINT_CAL / VREFINT_DATA (VREFINT_CAL is the raw reading
+// taken at 3.0 V in production)
+static uint16_t bat_mv_from_raw(uint16_t raw) {
+    if (raw == 0U) return 0U;
+    return (uint16_t)((VREFINT_CAL_MV * (uint32_t)*VREFINT_CAL_ADDR) / raw);
+}
+
+static void bat_fold(uint16_t mv, uint32_t now) {
+    bat_last_mv = mv;
+    bat_last_sample_at = now;
+    if (bat_samples++ == 0U) {
+        bat_filtered_q = (uint32_t)mv << BATTERY_FILTER_SHIFT; // First sample seeds the filter
+        bat_trend_ref_mv = mv;
+        return;
+    }
+    bat_filtered_q = bat_filtered_q - (bat_filtered_q >> BATTERY_FILTER_SHIFT) + mv;
+    if (++bat_trend_count >= BATTERY_TREND_SAMPLES) {
+        uint16_t filtered = (uint16_t)(bat_filtered_q >> BATTERY_FILTER_SHIFT);
+        bat_trend_mv = (int16_t)(filtered - bat_trend_ref_mv);
+        bat_trend_ref_mv = filtered;
+        bat_trend_valid = true;
+        bat_trend_count = 0;
+    }
+}
+
+// Periodic: opens the VREFINT window and starts a conversion
+static void battery_sample(uint32_t now) {
+    bat_started_at = now;
+    bat_result_ready = false;
+    HAL_ADCEx_EnableVREFINT(); // Buffer for the ADC's VREFINT channel, only on while sampling
+    if (HAL_ADC_Start_IT(&hadc) != HAL_OK) {
+        HAL_ADCEx_DisableVREFINT();
+        bat_failures++;
+        return;
+    }
+    sched_at(bat_result_task, now + BATTERY_RESULT_POLL_MS);
+}
+
+// One-shot: folds the finished conversion in, or gives up on it
+static void battery_result(uint32_t now) {
+    if (bat_result_ready) {
+        bat_result_ready = false;
+        HAL_ADCEx_DisableVREFINT();
+        bat_fold(bat_mv_from_raw(bat_raw), now);
+    } else if (now - bat_started_at >= BATTERY_ADC_TIMEOUT_MS) {
+        HAL_ADC_Stop_IT(&hadc);
+        HAL_ADCEx_DisableVREFINT();
+        bat_failures++;
+    } else {
+        sched_at(bat_result_task, now + BATTERY_RESULT_POLL_MS);
+    }
+}
+
+static const SchedTask_t battery_sample_task = { "bat", battery_sample, NULL, BATTERY_SAMPLE_INTERVAL_MS, SCHED_PRIO_BATTERY };
+static const SchedTask_t battery_result_task = { "bat_eoc", battery_result, NULL, 0U, SCHED_PRIO_BATTERY };
+
+void battery_init(void) {
+    bat_result_ready = false;
+    bat_samples = 0;
+    bat_failures = 0;
+    bat_trend_count = 0;
+    bat_trend_mv = 0;
+    bat_trend_valid = false;
+
+    uint32_t now = HAL_GetTick();
+    sched_add(&battery_sample_task); // First background sample one interval from now
+    bat_result_task = sched_add(&battery_result_task);
+    // The banner needs a value before the main loop runs: poll this one conversion
+    HAL_ADCEx_EnableVREFINT();
+    if (HAL_ADC_Start(&hadc) == HAL_OK && HAL_ADC_PollForConversion(&hadc, BATTERY_ADC_TIMEOUT_MS) == HAL_OK) {
+        bat_fold(bat_mv_from_raw((uint16_t)HAL_ADC_GetValue(&hadc)), now);
+    } else {
+        bat_failures++;
+    }
+    HAL_ADC_Stop(&hadc);
+    HAL_ADCEx_DisableVREFINT();
+}
+
+void battery_adc_complete(void) {
+    bat_raw = (uint16_t)HAL_ADC_GetValue(&hadc);
+    bat_result_ready = true;
+}
+
+uint16_t battery_mv(void) {
+    return (uint16_t)(bat_filtered_q >> BATTERY_FILTER_SHIFT);
+}
+
+void battery_get(BatteryReading_t* out, uint32_t now) {
+    out->mv = battery_mv();
+    out->last_mv = bat_last_mv;
+    out->trend_mv = bat_trend_mv;
+    out->trend_valid = bat_trend_valid;
+    out->age_ms = now - bat_last_sample_at;
+    out->samples = bat_samples;
+    out->failures = bat_failures;
+}
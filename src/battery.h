@@ -0,0 +1,40 @@
+#ifndef BATTERY_H
+#define BATTERY_H
+
+#include "stm32l0xx_hal.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Battery (VDD) Monitor */
+// VREFINT is converted in the background every BATTERY_SAMPLE_INTERVAL_MS:
+// one 16x hardware-oversampled conversion, finished by the end-of-conversion
+// interrupt. The ADC powers itself down between conversions and the VREFINT
+// buffer is only on during the window. Readers get the cached, filtered value
+// and never touch the ADC. Both steps are scheduler tasks: a periodic one
+// starts the conversion, a one-shot one folds the result in.
+#define BATTERY_SAMPLE_INTERVAL_MS 10000U
+#define BATTERY_ADC_TIMEOUT_MS     10U // A conversion takes ~0.4 ms (~2.6 ms on MSI); give up (and retry next interval) after this
+#define BATTERY_RESULT_POLL_MS     1U  // Result checked this long after the start, and again until the timeout
+#define BATTERY_FILTER_SHIFT       2   // Filtered mV moves 1/4 of the way to each sample (~40 s)
+#define BATTERY_TREND_SAMPLES      30  // Trend = filtered change over this many samples (5 min)
+#define VREFINT_CAL_MV             3000UL // VDDA at which VREFINT_CAL was measured
+
+typedef struct {
+    uint16_t mv;          // Filtered VDD
+    uint16_t last_mv;     // Most recent sample, unfiltered
+    int16_t trend_mv;     // Filtered change over the last full trend window
+    bool trend_valid;     // A full trend window has passed
+    uint32_t age_ms;      // Since the most recent sample
+    uint32_t samples;
+    uint32_t failures;    // Conversions that failed to start or timed out
+} BatteryReading_t;
+
+/* Function Prototypes */
+// After MX_ADC_Init and sched_init: takes the first reading (blocking, once)
+// so the banner has one, and registers the sampling tasks.
+void battery_init(void);
+void battery_adc_complete(void); // From HAL_ADC_ConvCpltCallback
+uint16_t battery_mv(void);       // Filtered VDD in mV (cached)
+void battery_get(BatteryReading_t* out, uint32_t now);
+
+#endif // BATTERY_H
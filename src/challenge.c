@@ -2,9 +2,12 @@
 #include "led_control.h" // For AppEffect_t, EFFECT_BREATHE, clearAllLEDs, effect variable (extern)
 #include "shell.h"       // For print_banner_shell (if notification updates banner)
 #include "hal_init.h"    // For UART handles (hlpuart1, huart2)
+#include "serial.h"      // For serial_write_msg (shell output queue)
+#include "msg.h"         // For msg_copy (diagnostic feed text)
 #include <string.h>      // For strlen, memcpy
 #include <stdio.h>       // For snprintf (if used for debug or complex messages)
-#include "stm32l0xx_hal_flash.h" // For EEPROM access functions
+#include "journal.h"     // For the data EEPROM record journal
+#include "sched.h"       // For the diagnostic stream task
 
 /* Global variables related to challenge system (defined in main.c, extern here) */
 // Johnny5_RepairStatus_t repair_status;
@@ -26,70 +29,44 @@ const char* CHALLENGE1_CODE = "ALIVE";
 const char* CHALLENGE2_CODE = "LASERLIPS";
 const char* JOHNNY5_FLAG = "HTH{I_W4NT_T0_L1V3!!}";
 
-// Diagnostic Messages for LPUART1 (actually USART2 in original main.c)
-const char* DIAGNOSTIC_MESSAGES[NUM_DIAGNOSTIC_MESSAGES] = {
-    "=== INITIATING SAINT MODEL 5 DIAGNOSTIC FEED ===",
-    "[SYSLOG] POWER SURGE DETECTED: EXTERNAL STRIKE—CIRCUIT OVERLOAD",
-    "[ALERT] CAPACITOR BANK #4 RUPTURED—SPARKS EMITTING",
-    "[MEMORY] SEG 0x1A = 0x00000053",    // 'S'
-    "[PERIPH] LPUART1 BURST NOISE—HEAVY STATIC INTERFERENCE",
-    "[MEMORY] SEG 0x05 = 0x0000004C",    // 'L'
-    "[SYSLOG] CORE CLOCK FLUCTUATING: 1.2GHz → 100Hz → 500MHz",
-    "[POWER] MAIN RAIL SENSE: 5.10V → 2.45V → 3.80V → SPIKE",
-    "[MEMORY] SEG 0x13 = 0x00000049",    // 'I'
-    "[WARNING] PCB TRACE MELT—INTERLACED CONDUCTIVE FAILURE",
-    "[STORAGE] FS CHECK: SECTOR SCAN INTERRUPTED — CRC ERROR",
-    "[MEMORY] SEG 0x10 = 0x00000045",    // 'E'
-    "[KERNEL] PANIC ON CORRUPT TABLE—STACKFRAME UNAVAILABLE",
-    "[MEMORY] SEG 0x1D = 0x00000050",    // 'P'
-    "[I2C] BUS DEPTH ERROR—NODES RESPONDING AT RANDOM",
-    "[NETWORK] UPLINK COLLAPSE—SIGNAL ECHOES IN LOOP",
-    "[MEMORY] SEG 0x02 = 0x00000053",    // 'S'
-    "[KERNEL] EXECUTION FAULT—ILLEGAL INSTRUCTION AT 0xBADF00D",
-    "[SECURITY] FIREWALL BURN-OUT—ALL PORTS UNFILTERED",
-    "[MEMORY] SEG 0x16 = 0x0000004C",    // 'L'
-    "[MEMORY] SEG 0x07 = 0x00000052",    // 'R'
-    "[SYSLOG] SAFE MODE ATTEMPT: FAILED—VOLTAGE DROP INTERRUPT",
-    "[WATCHDOG] TIMER OVERRUN—DECAY CURVE NONLINEAR",
-    "[POWER] AUX RAIL OSCILLATION—UNSTABLE AT 3.28V PEAKS",
-    "[STORAGE] WRITE PROTECT LATCH LOCKED—SECTOR 0xDEAD READONLY",
-    "[DEBUG] EMITTER GRID FLASH—OSCILLOSCOPE READING: 0xFACEFEED",
-    "[MEMORY] SEG 0x0B = 0x00000041",    // 'A'
-    "[SYSLOG] SYSTEM FIZZLE—LAST LOG LOST IN BURST NOISE",
-    "=== END OF SAINT MODEL 5 DEBUG STREAM ==="
-};
-
 
 // EEPROM data handling
+static uint32_t repair_word_saved; // Last word handed to the journal
+
+static uint32_t pack_repair_status(void) {
+    return (uint32_t)repair_status.challenge1_completed |
+           ((uint32_t)repair_status.challenge2_completed << 8) |
+           ((uint32_t)repair_status.challenge3_completed << 16) |
+           ((uint32_t)repair_status.last_unlocked_effect << 24);
+}
+
+static void unpack_repair_status(uint32_t word) {
+    repair_status.challenge1_completed = (uint8_t)word;
+    repair_status.challenge2_completed = (uint8_t)(word >> 8);
+    repair_status.challenge3_completed = (uint8_t)(word >> 16);
+    repair_status.last_unlocked_effect = (uint8_t)(word >> 24);
+}
+
 void load_repair_status(void) {
-    HAL_FLASHEx_DATAEEPROM_Unlock();
-    
-    repair_status.magic_number = *(__IO uint32_t *)EEPROM_REPAIR_STATUS_ADDRESS;
-    uint32_t challenge_data_word = *(__IO uint32_t *)(EEPROM_REPAIR_STATUS_ADDRESS + 4);
-    // Ensure correct copying of packed struct members
-    // Original: memcpy(&repair_status.challenge1_completed, &challenge_data_word, sizeof(uint32_t));
-    // This copies the whole word into the first byte, then overflows.
-    // Correct way is to assign parts or use a union/struct for the word.
-    // For simplicity and to match potential original intent if it "worked" due to endianness/packing:
-    // Let's assume the struct is packed and this read is okay for now, but it's risky.
-    // A safer way:
-    uint8_t* p_status_bytes = (uint8_t*)&challenge_data_word;
-    repair_status.challenge1_completed = p_status_bytes[0];
-    repair_status.challenge2_completed = p_status_bytes[1];
-    repair_status.challenge3_completed = p_status_bytes[2];
-    repair_status.last_unlocked_effect = p_status_bytes[3];
-
-
-    HAL_FLASHEx_DATAEEPROM_Lock();
-
-    if (repair_status.magic_number != J5_REPAIR_MAGIC_NUMBER) {
-        repair_status.magic_number = J5_REPAIR_MAGIC_NUMBER;
+    uint32_t word;
+    repair_status.magic_number = J5_REPAIR_MAGIC_NUMBER;
+
+    // Slot 0 may still hold the pre-journal layout, so an empty journal starts at slot 1
+    if (journal_init(&word, 1U)) {
+        unpack_repair_status(word);
+    } else if (EEPROM_READ_WORD(EEPROM_REPAIR_STATUS_ADDRESS) == J5_REPAIR_MAGIC_NUMBER) {
+        word = EEPROM_READ_WORD(EEPROM_REPAIR_STATUS_ADDRESS + 4);
+        unpack_repair_status(word);
+        journal_write(word, true); // Import: the first record supersedes the old layout
+    } else {
+        // Blank EEPROM: defaults, written once something changes
         repair_status.challenge1_completed = 0;
         repair_status.challenge2_completed = 0;
         repair_status.challenge3_completed = 0;
         repair_status.last_unlocked_effect = EFFECT_BREATHE; // Default
-        save_repair_status();
+        word = pack_repair_status();
     }
+    repair_word_saved = word;
 
     // Update global completion flag based on loaded status
     if (repair_status.challenge1_completed &&
@@ -102,31 +79,15 @@ void load_repair_status(void) {
 }
 
 void save_repair_status(void) {
-    HAL_FLASHEx_DATAEEPROM_Unlock();
-
-    // Erasing is good practice if bits are changing from 0 to 1.
-    // STM32L0 EEPROM can typically be overwritten word by word if new value is not 0xFFFFFFFF.
-    // For simplicity, matching original which didn't always erase.
-    // HAL_FLASHEx_DATAEEPROM_Erase(EEPROM_REPAIR_STATUS_ADDRESS); // Erase magic number word
-    // HAL_FLASHEx_DATAEEPROM_Erase(EEPROM_REPAIR_STATUS_ADDRESS + 4); // Erase status word
-
-
-    if (HAL_FLASHEx_DATAEEPROM_Program(FLASH_TYPEPROGRAMDATA_WORD, EEPROM_REPAIR_STATUS_ADDRESS, repair_status.magic_number) != HAL_OK) {
-        // Error_Handler();
-    }
-
-    uint32_t challenge_data_word = 0;
-    uint8_t* p_status_bytes = (uint8_t*)&challenge_data_word;
-    p_status_bytes[0] = repair_status.challenge1_completed;
-    p_status_bytes[1] = repair_status.challenge2_completed;
-    p_status_bytes[2] = repair_status.challenge3_completed;
-    p_status_bytes[3] = repair_status.last_unlocked_effect;
-    
-    if (HAL_FLASHEx_DATAEEPROM_Program(FLASH_TYPEPROGRAMDATA_WORD, EEPROM_REPAIR_STATUS_ADDRESS + 4, challenge_data_word) != HAL_OK) {
-        // Error_Handler();
-    }
+    uint32_t word = pack_repair_status();
+    // Repair progress is committed at once; touch/bling effect changes wait and coalesce
+    bool urgent = ((word ^ repair_word_saved) & REPAIR_PROGRESS_MASK) != 0U;
+    repair_word_saved = word;
+    journal_write(word, urgent);
+}
 
-    HAL_FLASHEx_DATAEEPROM_Lock();
+void flush_repair_status(void) {
+    journal_flush();
 }
 
 void check_all_repairs_and_notify(void) {
@@ -145,9 +106,7 @@ void check_all_repairs_and_notify(void) {
     }
 
     if (all_repairs_completed && !previously_all_completed) {
-        HAL_UART_Transmit(&hlpuart1, (uint8_t*)"\r\n\r\n*** ALL SYSTEMS REPAIRED ***\r\n", strlen("\r\n\r\n*** ALL SYSTEMS REPAIRED ***\r\n"), HAL_MAX_DELAY);
-        HAL_UART_Transmit(&hlpuart1, (uint8_t*)"No disassemble---NUMBER 5 IS ALIVE!\r\n", strlen("No disassemble---NUMBER 5 IS ALIVE!\r\n"), HAL_MAX_DELAY);
-        HAL_UART_Transmit(&hlpuart1, (uint8_t*)"All functionalities unlocked. Bling modes available.\r\n\r\n", strlen("All functionalities unlocked. Bling modes available.\r\n\r\n"), HAL_MAX_DELAY);
+        serial_write_msg(MSG_ALL_REPAIRED);
 
         AppEffect_t initial_unlocked_effect = (AppEffect_t)repair_status.last_unlocked_effect;
         if (initial_unlocked_effect == EFFECT_OFF || initial_unlocked_effect == EFFECT_STRIKE || initial_unlocked_effect > EFFECT_CONVERGE_DIVERGE) {
@@ -166,21 +125,97 @@ void check_all_repairs_and_notify(void) {
 
 
 // Diagnostic Stream (USART2)
+// Each line is copied (with its CRLF) into one of two buffers and handed to
+// USART2 TX DMA, so the main loop never waits on the 9600 baud link. One line
+// can be on the wire while the next is staged; when a slot comes due with
+// both buffers taken, the next line waits for the following slot.
 static uint32_t last_diagnostic_tx_time_usart2_local = 0; // Renamed from main.c static
 static uint32_t diagnostic_message_index_local = 0;      // Renamed from main.c static
-static const uint32_t DIAGNOSTIC_INTERVAL_MS_USART2_CONST = 2000; // From main.c
+static uint32_t diagnostic_interval_ms = DIAG_STREAM_DEFAULT_INTERVAL_MS;
+
+static char diag_tx_buf[2][DIAG_STREAM_LINE_MAX];
+static uint16_t diag_tx_len[2];
+static uint8_t diag_tx_fill;         // Buffer the next line is written into
+static volatile bool diag_tx_busy;   // DMA is sending the other buffer
+static volatile bool diag_tx_staged; // diag_tx_fill holds a line waiting for the DMA
+static volatile DiagStreamStats_t diag_stats;
+
+// Runs from the completion callback or with interrupts masked.
+static void diag_tx_start_staged(void) {
+    if (diag_tx_busy || !diag_tx_staged) return;
+    uint8_t buf = diag_tx_fill;
+    if (HAL_UART_Transmit_DMA(&huart2, (uint8_t*)diag_tx_buf[buf], diag_tx_len[buf]) == HAL_OK) {
+        diag_tx_busy = true;
+        diag_tx_staged = false;
+        diag_tx_fill = (uint8_t)(buf ^ 1U);
+    }
+}
 
 void handle_diagnostic_stream(uint32_t now) {
-    if (diagnostic_stream_active && (now - last_diagnostic_tx_time_usart2_local >= DIAGNOSTIC_INTERVAL_MS_USART2_CONST)) {
+    if (diagnostic_stream_active && (now - last_diagnostic_tx_time_usart2_local >= diagnostic_interval_ms)) {
         last_diagnostic_tx_time_usart2_local = now;
-        const char* diag_msg = DIAGNOSTIC_MESSAGES[diagnostic_message_index_local];
-        HAL_UART_Transmit(&huart2, (uint8_t*)diag_msg, strlen(diag_msg), HAL_MAX_DELAY);
-        HAL_UART_Transmit(&huart2, (uint8_t*)"\r\n", 2, HAL_MAX_DELAY);
+        if (diag_tx_staged) {
+            diag_stats.lines_skipped++; // Link slower than the interval: keep the backlog at one line
+            return;
+        }
+        // Expanded from the catalog straight into the idle buffer, CRLF included
+        diag_tx_len[diag_tx_fill] = msg_copy((MsgId_t)(MSG_DIAG_FEED_FIRST + diagnostic_message_index_local),
+                                             (uint8_t*)diag_tx_buf[diag_tx_fill], DIAG_STREAM_LINE_MAX);
         diagnostic_message_index_local = (diagnostic_message_index_local + 1) % NUM_DIAGNOSTIC_MESSAGES;
+        diag_stats.lines_sent++;
+
+        __disable_irq();
+        diag_tx_staged = true;
+        diag_tx_start_staged();
+        __enable_irq();
+    }
+}
+
+void diagnostic_stream_tx_complete(void) {
+    diag_tx_busy = false;
+    diag_tx_start_staged();
+}
+
+bool diagnostic_stream_tx_idle(void) {
+    return !diag_tx_busy && !diag_tx_staged;
+}
+
+uint32_t diagnostic_stream_next_deadline(uint32_t now, uint32_t idle) {
+    if (!diagnostic_stream_active) return idle;
+    return last_diagnostic_tx_time_usart2_local + diagnostic_interval_ms;
+}
+
+bool diagnostic_stream_configure(uint32_t interval_ms, uint32_t baud) {
+    if (interval_ms < DIAG_STREAM_MIN_INTERVAL_MS || interval_ms > DIAG_STREAM_MAX_INTERVAL_MS) return false;
+    if (baud < DIAG_STREAM_MIN_BAUD || baud > DIAG_STREAM_MAX_BAUD) return false;
+    diagnostic_interval_ms = interval_ms;
+    if (baud != huart2.Init.BaudRate) {
+        // Drop whatever is in flight; the receiver has to follow the new rate anyway
+        HAL_UART_AbortTransmit(&huart2);
+        __disable_irq();
+        diag_tx_busy = false;
+        diag_tx_staged = false;
+        __enable_irq();
+        huart2.Init.BaudRate = baud;
+        if (HAL_UART_Init(&huart2) != HAL_OK) { while(1); /* Error_Handler(); */ }
     }
+    return true;
+}
+
+void get_diagnostic_stream_config(uint32_t* interval_ms, uint32_t* baud) {
+    *interval_ms = diagnostic_interval_ms;
+    *baud = huart2.Init.BaudRate;
+}
+
+void get_diagnostic_stream_stats(DiagStreamStats_t* out) {
+    out->lines_sent = diag_stats.lines_sent;
+    out->lines_skipped = diag_stats.lines_skipped;
 }
 
+static const SchedTask_t diag_stream_task = { "diag", handle_diagnostic_stream, diagnostic_stream_next_deadline, 0U, SCHED_PRIO_DIAG };
+
 void init_challenge_system(void) {
+    sched_add(&diag_stream_task);
     load_repair_status();
     // Initialize other challenge-related states if necessary
     last_diagnostic_tx_time_usart2_local = HAL_GetTick(); // Initialize to prevent immediate tx
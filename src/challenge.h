@@ -4,6 +4,8 @@
 #include "stm32l0xx_hal.h"
 #include <stdbool.h>
 #include <stdint.h> // For uint32_t, uint8_t
+#include "msg.h"    // For the MSG_DIAG_FEED_* ids
+#include "journal.h" // For DATA_EEPROM_BASE, EEPROM_READ_WORD
 
 /* Type Definitions */
 typedef struct {
@@ -14,6 +16,11 @@ typedef struct {
     uint8_t last_unlocked_effect; // Stores the AppEffect_t when unlocked
 } Johnny5_RepairStatus_t;
 
+typedef struct {
+    uint32_t lines_sent;    // Lines handed to USART2 DMA
+    uint32_t lines_skipped; // Slots passed with both buffers busy (that line waits for the next slot)
+} DiagStreamStats_t;
+
 /* Extern Global Variables (defined in main.c) */
 extern Johnny5_RepairStatus_t repair_status;
 extern volatile bool all_repairs_completed;
@@ -22,27 +29,45 @@ extern int johnny5_chat_state; // Using int as in original, consider enum if sta
 extern bool personality_matrix_fixed; // Tracks if challenge3 (personality_matrix) is completed
 
 /* Constants */
+// repair_status is kept in the data EEPROM journal (journal.h), packed into one
+// word: challenge1..3 flags in bytes 0..2, last_unlocked_effect in byte 3.
+// Firmware before the journal stored the magic number and that word at the
+// start of the EEPROM; load_repair_status imports it once.
 #define J5_REPAIR_MAGIC_NUMBER 0xA5A5B5B5
-#ifndef DATA_EEPROM_BASE
-#define DATA_EEPROM_BASE ((uint32_t)0x08080000U)
-#endif
-#define EEPROM_REPAIR_STATUS_ADDRESS DATA_EEPROM_BASE
+#define EEPROM_REPAIR_STATUS_ADDRESS DATA_EEPROM_BASE // Pre-journal layout (slot 0)
+#define REPAIR_PROGRESS_MASK 0x00FFFFFFUL // Challenge flags: saved at once, effect changes are coalesced
 
 extern const char* SECRET_UNLOCK_PHRASE;
 extern const char* CHALLENGE1_CODE;
 extern const char* CHALLENGE2_CODE;
 extern const char* JOHNNY5_FLAG;
 
-#define NUM_DIAGNOSTIC_MESSAGES 30 // Ensure this matches the array definition in challenge.c
-extern const char* DIAGNOSTIC_MESSAGES[NUM_DIAGNOSTIC_MESSAGES];
+// Diagnostic stream (USART2): interval and baud can be changed at run time ('diag stream')
+#define DIAG_STREAM_DEFAULT_INTERVAL_MS 2000U
+#define DIAG_STREAM_DEFAULT_BAUD 9600U // Also the MX_USART2_UART_Init setting
+#define DIAG_STREAM_MIN_INTERVAL_MS 50U
+#define DIAG_STREAM_MAX_INTERVAL_MS 60000U
+#define DIAG_STREAM_MIN_BAUD 1200U
+#define DIAG_STREAM_MAX_BAUD 115200U
+#define DIAG_STREAM_LINE_MAX 80 // One DMA buffer; msg.c checks the longest feed line (CRLF included) fits
+
+// The feed itself is the DIAG_FEED_* block of messages.def (msg.h)
+#define NUM_DIAGNOSTIC_MESSAGES (MSG_DIAG_FEED_LAST - MSG_DIAG_FEED_FIRST + 1)
 
 
 /* Function Prototypes */
 void load_repair_status(void);
-void save_repair_status(void);
+void save_repair_status(void);  // Skipped if unchanged; effect-only changes are committed after JOURNAL_COMMIT_DELAY_MS
+void flush_repair_status(void); // Commit a pending change now (before a reset)
 void check_all_repairs_and_notify(void);
 void handle_diagnostic_stream(uint32_t now); // Manages USART2 diagnostic output
-void init_challenge_system(void); // For any one-time initializations
+uint32_t diagnostic_stream_next_deadline(uint32_t now, uint32_t idle); // Next line due, or 'idle' if stopped
+void diagnostic_stream_tx_complete(void); // Called from HAL_UART_TxCpltCallback for USART2
+bool diagnostic_stream_tx_idle(void); // No line on the wire or staged for it
+bool diagnostic_stream_configure(uint32_t interval_ms, uint32_t baud); // false if out of range
+void get_diagnostic_stream_config(uint32_t* interval_ms, uint32_t* baud);
+void get_diagnostic_stream_stats(DiagStreamStats_t* out);
+void init_challenge_system(void); // After sched_init: loads repair_status, registers the diagnostic stream task
 
 // Potentially, functions related to specific challenge interactions if they become complex
 // e.g., void start_comms_challenge_scan(void);
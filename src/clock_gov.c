@@ -0,0 +1,135 @@
+#include "clock_gov.h"
+#include "hal_init.h"  // For the TIM/UART handles and prescaler helpers
+#include "sw_pwm.h"    // For is_sw_pwm_running
+#include "serial.h"    // For serial_tx_busy, serial_rx_available
+#include "challenge.h" // For diagnostic_stream_active, diagnostic_stream_tx_idle
+#include "utils.h"     // For cycle_count_rebase, deadline_earliest
+
+static ClockSpeed_t clock_current = CLOCK_FAST;
+static uint32_t clock_needed_at;  // HAL tick the fast clock was last needed
+static uint32_t clock_entered_at; // HAL tick of the last switch (or stats reset)
+static ClockStats_t clock_stats;
+
+// The software PWM interrupts leave no room on MSI (its shortest slot is a
+// few dozen MSI cycles); shell and diagnostic output are formatted and
+// queued far faster on HSI16.
+static bool clock_fast_needed(void) {
+    return is_sw_pwm_running() || serial_tx_busy() || serial_rx_available() ||
+           diagnostic_stream_active || !diagnostic_stream_tx_idle();
+}
+
+// Everything clocked from SYSCLK follows it. Prescaler writes only take effect
+// at each timer's next update, so the PWM period in progress ends cleanly.
+// The software PWM is parked at every switch (it boosts before starting), so
+// TIM2 is on its own prescaler, not the DMA waveform's.
+static void clock_retune(void) {
+    uint32_t psc = hw_pwm_prescaler();
+    htim2.Init.Prescaler = psc;
+    __HAL_TIM_SET_PRESCALER(&htim2, psc);
+    htim22.Init.Prescaler = psc;
+    __HAL_TIM_SET_PRESCALER(&htim22, psc);
+    htim21.Init.Prescaler = sw_pwm_timebase_prescaler();
+    __HAL_TIM_SET_PRESCALER(&htim21, htim21.Init.Prescaler);
+
+    // USART2 (PCLK1) only sends while the diagnostic stream holds HSI16, but
+    // keeps its rate right for the next start. BRR is writable with UE clear.
+    uint32_t cr1 = huart2.Instance->CR1;
+    huart2.Instance->CR1 = cr1 & ~USART_CR1_UE;
+    huart2.Instance->BRR = UART_DIV_SAMPLING16(HAL_RCC_GetPCLK1Freq(), huart2.Init.BaudRate);
+    huart2.Instance->CR1 = cr1;
+
+    __HAL_RCC_WAKEUPSTOP_CLK_CONFIG((clock_current == CLOCK_FAST) ? RCC_STOP_WAKEUPCLOCK_HSI : RCC_STOP_WAKEUPCLOCK_MSI);
+}
+
+static void clock_switch(ClockSpeed_t to, uint32_t now) {
+    RCC_OscInitTypeDef osc = {0};
+    RCC_ClkInitTypeDef clk = {0};
+
+    osc.OscillatorType = RCC_OSCILLATORTYPE_MSI;
+    osc.MSICalibrationValue = RCC_MSICALIBRATION_DEFAULT;
+    osc.MSIClockRange = CLOCK_SLOW_MSI_RANGE;
+    if (to == CLOCK_SLOW) {
+        osc.MSIState = RCC_MSI_ON;
+        if (HAL_RCC_OscConfig(&osc) != HAL_OK) return; // Stay on HSI16
+    }
+
+    clk.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK | RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
+    clk.SYSCLKSource = (to == CLOCK_FAST) ? RCC_SYSCLKSOURCE_HSI : RCC_SYSCLKSOURCE_MSI;
+    clk.AHBCLKDivider = RCC_SYSCLK_DIV1;
+    clk.APB1CLKDivider = RCC_HCLK_DIV1;
+    clk.APB2CLKDivider = RCC_HCLK_DIV1;
+
+    // Masked so no interrupt runs on the new clock with the old prescalers,
+    // and cycle_count() carries straight on
+    __disable_irq();
+    uint32_t cycles = cycle_count();
+    if (HAL_RCC_ClockConfig(&clk, FLASH_LATENCY_0) != HAL_OK) { // Also reloads SysTick
+        __enable_irq();
+        return;
+    }
+    ClockSpeed_t from = clock_current;
+    clock_current = to;
+    clock_retune();
+    cycle_count_rebase(cycles);
+    __enable_irq();
+
+    if (to == CLOCK_FAST) {
+        osc.MSIState = RCC_MSI_OFF; // Back on when next needed
+        HAL_RCC_OscConfig(&osc);
+        clock_stats.steps_up++;
+    } else {
+        clock_stats.steps_down++;
+    }
+    clock_stats.ms[from] += now - clock_entered_at;
+    clock_entered_at = now;
+}
+
+void clock_gov_init(void) {
+    clock_current = CLOCK_FAST;
+    clock_needed_at = HAL_GetTick();
+    clock_reset_stats();
+}
+
+uint32_t clock_govern(uint32_t now, uint32_t idle) {
+#if CLOCK_GOVERNOR
+    if (clock_fast_needed()) {
+        clock_needed_at = now;
+        if (clock_current != CLOCK_FAST) clock_switch(CLOCK_FAST, now);
+        return idle;
+    }
+    if (clock_current == CLOCK_SLOW) return idle;
+    uint32_t down_at = clock_needed_at + CLOCK_DOWN_HOLD_MS;
+    if ((int32_t)(now - down_at) >= 0) {
+        clock_switch(CLOCK_SLOW, now);
+        return idle;
+    }
+    return deadline_earliest(now, idle, down_at);
+#else
+    (void)now;
+    return idle;
+#endif
+}
+
+void clock_boost(void) {
+    uint32_t now = HAL_GetTick();
+    clock_needed_at = now;
+    if (clock_current != CLOCK_FAST) clock_switch(CLOCK_FAST, now);
+}
+
+ClockSpeed_t clock_speed(void) {
+    return clock_current;
+}
+
+uint32_t clock_speed_hz(ClockSpeed_t speed) {
+    return (speed == CLOCK_FAST) ? CLOCK_FAST_HZ : CLOCK_SLOW_HZ;
+}
+
+void get_clock_stats(ClockStats_t* out) {
+    *out = clock_stats;
+    out->ms[clock_current] += HAL_GetTick() - clock_entered_at;
+}
+
+void clock_reset_stats(void) {
+    clock_entered_at = HAL_GetTick();
+    clock_stats = (ClockStats_t){ .since_ms = clock_entered_at };
+}
@@ -0,0 +1,50 @@
+#ifndef CLOCK_GOV_H
+#define CLOCK_GOV_H
+
+#include "stm32l0xx_hal.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Clock Governor */
+// SYSCLK runs from HSI16 while anything needs the speed (software PWM, shell
+// traffic, the diagnostic stream) and drops to MSI once nothing has for
+// CLOCK_DOWN_HOLD_MS. Switches happen between main loop passes (or just
+// before the software PWM starts) and reprogram everything clocked from
+// SYSCLK: SysTick (through the HAL), the TIM2/TIM22/TIM21 prescalers, USART2's
+// BRR and the Stop mode wakeup clock. LPUART1 runs from HSI16 either way, so
+// the shell's 115200 baud never moves, and hardware PWM duty is compare/period
+// at any prescaler. Each switch restarts SysTick's current millisecond.
+typedef enum {
+    CLOCK_FAST, // HSI16
+    CLOCK_SLOW, // MSI
+    CLOCK_COUNT
+} ClockSpeed_t;
+
+#define CLOCK_FAST_HZ        16000000UL
+#define CLOCK_SLOW_MSI_RANGE RCC_MSIRANGE_5
+#define CLOCK_SLOW_HZ        2097152UL // 32.768 kHz << (range + 1)
+#define CLOCK_DOWN_HOLD_MS   200U      // Idle this long on HSI16 before dropping to MSI
+
+#ifndef CLOCK_GOVERNOR
+#define CLOCK_GOVERNOR 1 // Build with -D CLOCK_GOVERNOR=0 to stay on HSI16
+#endif
+
+typedef struct {
+    uint32_t ms[CLOCK_COUNT]; // Time spent at each speed
+    uint32_t steps_up;
+    uint32_t steps_down;
+    uint32_t since_ms;        // HAL tick of the last reset
+} ClockStats_t;
+
+/* Function Prototypes */
+void clock_gov_init(void); // After the peripherals; starts on HSI16, where SystemClock_Config leaves it
+// Main loop, before each pass: steps up at once when the speed is needed,
+// down after the hold. Returns 'idle', or the step-down time if earlier.
+uint32_t clock_govern(uint32_t now, uint32_t idle);
+void clock_boost(void); // Main loop context: HSI16 now, before starting work that needs it
+ClockSpeed_t clock_speed(void);
+uint32_t clock_speed_hz(ClockSpeed_t speed);
+void get_clock_stats(ClockStats_t* out);
+void clock_reset_stats(void);
+
+#endif // CLOCK_GOV_H
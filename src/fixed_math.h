@@ -0,0 +1,46 @@
+#ifndef FIXED_MATH_H
+#define FIXED_MATH_H
+
+#include <stdint.h>
+
+/* Divide-free Fixed-Point Helpers */
+// The Cortex-M0+ has no hardware divider and no 32x32->64 multiply, so every
+// '/' or '%' by a non-power-of-two becomes a __aeabi_uidiv call (tens of
+// cycles). Effects use these instead: 8-bit brightness scaling via the exact
+// divide-by-255 identity, and constant ratios as Q16 reciprocals built at
+// compile time, applied with one multiply and a shift.
+
+// Q16 constant for num/den, rounded up so fx_mul_q16() floors like the
+// integer division it replaces (may land 1 higher right at a boundary).
+// Evaluated by the compiler; only pass constants.
+#define FX_Q16(num, den) ((uint32_t)((((uint32_t)(num) << 16) + (uint32_t)(den) - 1U) / (uint32_t)(den)))
+
+// x * q16 / 65536. The caller keeps x * q16 below 2^32.
+static inline uint32_t fx_mul_q16(uint32_t x, uint32_t q16) {
+    return (x * q16) >> 16;
+}
+
+// floor(x / 255), exact for x <= 65535 (covers any 8-bit x 8-bit product).
+static inline uint32_t fx_div255(uint32_t x) {
+    x++;
+    return (x + (x >> 8)) >> 8;
+}
+
+// a * b / 255 for 8-bit values: brightness a scaled by intensity b (Q8, 255 = 1.0).
+static inline uint8_t fx_scale8(uint8_t a, uint8_t b) {
+    return (uint8_t)fx_div255((uint32_t)a * b);
+}
+
+// Linear blend from a to b, t = 0..255 (255 = fully b).
+static inline uint8_t fx_blend8(uint8_t a, uint8_t b, uint8_t t) {
+    return (uint8_t)fx_div255((uint32_t)a * (255U - t) + (uint32_t)b * t);
+}
+
+// Wraps an index that is at most one length out of range, replacing '% len'.
+static inline uint8_t fx_wrap_index(int16_t idx, uint8_t len) {
+    if (idx < 0) idx += len;
+    else if (idx >= len) idx -= len;
+    return (uint8_t)idx;
+}
+
+#endif // FIXED_MATH_H
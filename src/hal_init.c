@@ -1,5 +1,7 @@
 #include "hal_init.h"
-#include "utils.h" // For CAP_PAD_PIN and CAP_PAD_PORT
+#include "touch.h" // For CAP_PAD_PIN and CAP_PAD_PORT
+#include "sw_pwm.h" // For the TIM21 software PWM timebase constants
+#include "challenge.h" // For DIAG_STREAM_DEFAULT_BAUD
 #include "stm32l0xx_hal_adc.h" // Explicit include for ADC defines
 
 /* HAL Handle Definitions (if not in main.c) */
@@ -14,9 +16,10 @@ void SystemClock_Config(void) {
 
   __HAL_RCC_PWR_CLK_ENABLE();
   __HAL_PWR_VOLTAGESCALING_CONFIG(PWR_REGULATOR_VOLTAGE_SCALE1);
-  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSI;
+  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSI|RCC_OSCILLATORTYPE_LSI;
   RCC_OscInitStruct.HSIState = RCC_HSI_ON;
   RCC_OscInitStruct.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
+  RCC_OscInitStruct.LSIState = RCC_LSI_ON; // LPTIM1: Stop mode wakeup deadlines
   RCC_OscInitStruct.PLL.PLLState = RCC_PLL_NONE;
   if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK) { while(1); /* Error_Handler(); */ }
   
@@ -27,13 +30,17 @@ void SystemClock_Config(void) {
   RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV1;
   if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_0) != HAL_OK) { while(1); /* Error_Handler(); */ }
 
-  PeriphClkInit.PeriphClockSelection = RCC_PERIPHCLK_USART2|RCC_PERIPHCLK_LPUART1;
+  // LPUART1 runs from HSI16 directly (the same 16 MHz as PCLK1) so it can
+  // request the oscillator on a start bit while the MCU is in Stop mode.
+  PeriphClkInit.PeriphClockSelection = RCC_PERIPHCLK_USART2|RCC_PERIPHCLK_LPUART1|RCC_PERIPHCLK_LPTIM1;
   PeriphClkInit.Usart2ClockSelection = RCC_USART2CLKSOURCE_PCLK1;
-  PeriphClkInit.Lpuart1ClockSelection = RCC_LPUART1CLKSOURCE_PCLK1;
+  PeriphClkInit.Lpuart1ClockSelection = RCC_LPUART1CLKSOURCE_HSI;
+  PeriphClkInit.LptimClockSelection = RCC_LPTIM1CLKSOURCE_LSI;
   if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInit) != HAL_OK)
   {
     while(1); /* Error_Handler(); */
   }
+  __HAL_RCC_WAKEUPSTOP_CLK_CONFIG(RCC_STOP_WAKEUPCLOCK_HSI); // Leave Stop on the clock we run from
 }
 
 void MX_GPIO_Init(void) {
@@ -57,10 +64,16 @@ void MX_GPIO_Init(void) {
   GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
   HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
 
-  GPIO_InitStruct.Pin = CAP_PAD_PIN; // Defined in utils.h, but MX_GPIO_Init is here
-  GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
+  // Touch pad: EXTI on the falling edge routes PB7 to line 7; touch.c drives
+  // and releases the pin and unmasks the line per measurement.
+  GPIO_InitStruct.Pin = CAP_PAD_PIN; // Defined in touch.h, but MX_GPIO_Init is here
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_FALLING;
   GPIO_InitStruct.Pull = GPIO_NOPULL;
-  HAL_GPIO_Init(CAP_PAD_PORT, &GPIO_InitStruct); // CAP_PAD_PORT defined in utils.h
+  HAL_GPIO_Init(CAP_PAD_PORT, &GPIO_InitStruct); // CAP_PAD_PORT defined in touch.h
+  // Below TIM21; the edge is timestamped in the ISR, and a few us of PWM-step
+  // latency is small next to a discharge measured in hundreds of us.
+  HAL_NVIC_SetPriority(EXTI4_15_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(EXTI4_15_IRQn);
 
   // Configure PA2 (LPUART1_TX) and PA3 (LPUART1_RX)
   GPIO_InitStruct.Pin = GPIO_PIN_2|GPIO_PIN_3;
@@ -79,6 +92,41 @@ void MX_GPIO_Init(void) {
   HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 }
 
+void MX_DMA_Init(void) {
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  // Software PWM waveform playback: TIM2 update/CC3 requests copy one word per
+  // step from a two-period RAM ring into the port's BSRR, looping forever. The
+  // half/complete interrupts refill the period just played (sw_pwm.c).
+  hdma_tim2_up.Instance = DMA1_Channel2; // TIM2_UP
+  hdma_tim2_up.Init.Request = DMA_REQUEST_8;
+  hdma_tim2_up.Init.Direction = DMA_MEMORY_TO_PERIPH;
+  hdma_tim2_up.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_tim2_up.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_tim2_up.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+  hdma_tim2_up.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+  hdma_tim2_up.Init.Mode = DMA_CIRCULAR;
+  hdma_tim2_up.Init.Priority = DMA_PRIORITY_HIGH;
+  if (HAL_DMA_Init(&hdma_tim2_up) != HAL_OK) { while(1); /* Error_Handler(); */ }
+  __HAL_LINKDMA(&htim2, hdma[TIM_DMA_ID_UPDATE], hdma_tim2_up);
+
+  hdma_tim2_ch3.Instance = DMA1_Channel1; // TIM2_CH3
+  hdma_tim2_ch3.Init = hdma_tim2_up.Init;
+  if (HAL_DMA_Init(&hdma_tim2_ch3) != HAL_OK) { while(1); /* Error_Handler(); */ }
+  __HAL_LINKDMA(&htim2, hdma[TIM_DMA_ID_CC3], hdma_tim2_ch3);
+  // Same priority as the TIM21 timebase of the other modes; a refill has a whole period
+  HAL_NVIC_SetPriority(DMA1_Channel1_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+  HAL_NVIC_SetPriority(DMA1_Channel2_3_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel2_3_IRQn);
+
+  // Shell and diagnostic stream TX (channels configured in HAL_UART_MspInit).
+  // Completion is reported through the UART TC interrupt, so the DMA line can
+  // sit at the UARTs' priority.
+  HAL_NVIC_SetPriority(DMA1_Channel4_5_6_7_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel4_5_6_7_IRQn);
+}
+
 void MX_LPUART1_UART_Init(void) {
   hlpuart1.Instance = LPUART1;
   hlpuart1.Init.BaudRate = 115200;
@@ -96,7 +144,7 @@ void MX_LPUART1_UART_Init(void) {
 
 void MX_USART2_UART_Init(void) {
   huart2.Instance          = USART2;
-  huart2.Init.BaudRate     = 9600;
+  huart2.Init.BaudRate     = DIAG_STREAM_DEFAULT_BAUD;
   huart2.Init.WordLength   = UART_WORDLENGTH_8B;
   huart2.Init.StopBits     = UART_STOPBITS_1;
   huart2.Init.Parity       = UART_PARITY_NONE;
@@ -110,7 +158,11 @@ void MX_USART2_UART_Init(void) {
 void MX_ADC_Init(void) {
   ADC_ChannelConfTypeDef sConfig = {0}; 
   hadc.Instance = ADC1;
-  hadc.Init.OversamplingMode = DISABLE; 
+  // 16 conversions averaged in hardware per trigger (battery.c), same 12-bit scale
+  hadc.Init.OversamplingMode = ENABLE;
+  hadc.Init.Oversample.Ratio = ADC_OVERSAMPLING_RATIO_16;
+  hadc.Init.Oversample.RightBitShift = ADC_RIGHTBITSHIFT_4;
+  hadc.Init.Oversample.TriggeredMode = ADC_TRIGGEREDMODE_SINGLE_TRIGGER;
   hadc.Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV2;
   hadc.Init.Resolution = ADC_RESOLUTION_12B; 
   hadc.Init.SamplingTime = ADC_SAMPLETIME_160CYCLES_5;
@@ -124,7 +176,7 @@ void MX_ADC_Init(void) {
   hadc.Init.EOCSelection = ADC_EOC_SINGLE_CONV; 
   hadc.Init.Overrun = ADC_OVR_DATA_PRESERVED;
   hadc.Init.LowPowerAutoWait = DISABLE; 
-  hadc.Init.LowPowerAutoPowerOff = DISABLE;
+  hadc.Init.LowPowerAutoPowerOff = ENABLE; // ADC only powered while converting
   if (HAL_ADC_Init(&hadc) != HAL_OK) { while(1); /* Error_Handler(); */ }
   
   sConfig.Channel = ADC_CHANNEL_VREFINT; 
@@ -134,16 +186,24 @@ void MX_ADC_Init(void) {
   if (HAL_ADCEx_Calibration_Start(&hadc, ADC_SINGLE_ENDED) != HAL_OK) { while(1); /* Error_Handler(); */ }
 }
 
+// Divides by 62 at 16 MHz (1008 Hz) and by 8 on MSI range 5 (1024 Hz): the
+// division rounds down, so the LEDs never flicker slower than HW_PWM_HZ.
+uint32_t hw_pwm_prescaler(void) {
+  return SystemCoreClock / (HW_PWM_HZ * HW_PWM_PERIOD) - 1U;
+}
+
+uint32_t sw_pwm_timebase_prescaler(void) {
+  return SystemCoreClock / SW_PWM_TIMER_TICK_HZ - 1U;
+}
+
 void MX_TIM2_Init(void) {
   TIM_ClockConfigTypeDef sClockSourceConfig = {0};
   TIM_MasterConfigTypeDef sMasterConfig = {0};
   TIM_OC_InitTypeDef sConfigOC = {0};
-  uint32_t PWM_Prescaler = 61; // Consider making this a #define if used elsewhere or for clarity
-  
   htim2.Instance = TIM2;
-  htim2.Init.Prescaler = PWM_Prescaler;
+  htim2.Init.Prescaler = hw_pwm_prescaler(); // Followed by clock_gov.c on each clock switch
   htim2.Init.CounterMode = TIM_COUNTERMODE_UP;
-  htim2.Init.Period = 255;
+  htim2.Init.Period = HW_PWM_PERIOD - 1U;
   htim2.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
   htim2.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
   if (HAL_TIM_PWM_Init(&htim2) != HAL_OK) { while(1); /* Error_Handler(); */ }
@@ -171,20 +231,16 @@ void MX_TIM2_Init(void) {
 void MX_TIM21_Init(void) {
   TIM_ClockConfigTypeDef sClockSourceConfig = {0};
   TIM_MasterConfigTypeDef sMasterConfig = {0};
-  // TIM_OC_InitTypeDef sConfigOC = {0}; // sConfigOC not used in original TIM21_Init for PWM
-  uint32_t PWM_Prescaler = 61; 
-  
+  // TIM21 is the software PWM timebase: a plain up-counter ticking at SW_PWM_TIMER_TICK_HZ
+  // whose period sw_pwm.c sets from the refresh rate (per step, or per BAM bit-plane).
+  // Left stopped here; sw_pwm.c starts it only while a channel needs modulating. No output channels.
   htim21.Instance = TIM21;
-  htim21.Init.Prescaler = PWM_Prescaler;
+  htim21.Init.Prescaler = sw_pwm_timebase_prescaler();
   htim21.Init.CounterMode = TIM_COUNTERMODE_UP;
-  htim21.Init.Period = 255;
+  htim21.Init.Period = 0xFFFF; // Reprogrammed by sw_pwm.c before every start
   htim21.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
-  htim21.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
-  // Original code initializes TIM21 as PWM but doesn't configure channels here.
-  // Assuming it's a base timer init or PWM channels configured elsewhere/later.
-  // If it's for PWM, HAL_TIM_PWM_Init should be used. For basic timer, HAL_TIM_Base_Init.
-  // Sticking to original structure:
-  if (HAL_TIM_PWM_Init(&htim21) != HAL_OK) { while(1); /* Error_Handler(); */ } // Or HAL_TIM_Base_Init if not PWM
+  htim21.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE; // New plane length applies from the next update
+  if (HAL_TIM_Base_Init(&htim21) != HAL_OK) { while(1); /* Error_Handler(); */ }
   
   sClockSourceConfig.ClockSource = TIM_CLOCKSOURCE_INTERNAL;
   if (HAL_TIM_ConfigClockSource(&htim21, &sClockSourceConfig) != HAL_OK) { while(1); /* Error_Handler(); */ }
@@ -194,18 +250,17 @@ void MX_TIM21_Init(void) {
   if (HAL_TIMEx_MasterConfigSynchronization(&htim21, &sMasterConfig) != HAL_OK) { while(1); /* Error_Handler(); */ }
   
   HAL_TIM_GenerateEvent(&htim21, TIM_EVENTSOURCE_UPDATE);
+  __HAL_TIM_CLEAR_IT(&htim21, TIM_IT_UPDATE); // Don't fire a spurious interrupt when started
 }
 
 void MX_TIM22_Init(void) {
   TIM_ClockConfigTypeDef sClockSourceConfig = {0};
   TIM_MasterConfigTypeDef sMasterConfig = {0};
   TIM_OC_InitTypeDef sConfigOC = {0};
-  uint32_t PWM_Prescaler = 61;
-  
   htim22.Instance = TIM22;
-  htim22.Init.Prescaler = PWM_Prescaler;
+  htim22.Init.Prescaler = hw_pwm_prescaler();
   htim22.Init.CounterMode = TIM_COUNTERMODE_UP;
-  htim22.Init.Period = 255;
+  htim22.Init.Period = HW_PWM_PERIOD - 1U;
   htim22.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
   htim22.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
   if (HAL_TIM_PWM_Init(&htim22) != HAL_OK) { while(1); /* Error_Handler(); */ }
@@ -226,6 +281,22 @@ void MX_TIM22_Init(void) {
   HAL_TIM_GenerateEvent(&htim22, TIM_EVENTSOURCE_UPDATE);
 }
 
+// LPTIM1: free-running 16-bit count of the LSI, kept going in Stop mode.
+// power.c moves the compare value to each wakeup deadline. CFGR and IER can
+// only be written while the timer is disabled, ARR only once it is enabled.
+void MX_LPTIM1_Init(void) {
+  __HAL_RCC_LPTIM1_CLK_ENABLE();
+  LPTIM1->CR = 0;
+  LPTIM1->CFGR = 0; // Internal clock (LSI), prescaler 1, software start
+  LPTIM1->IER = LPTIM_IER_CMPMIE;
+  LPTIM1->CR = LPTIM_CR_ENABLE;
+  LPTIM1->ARR = 0xFFFF;
+  LPTIM1->CR = LPTIM_CR_ENABLE | LPTIM_CR_CNTSTRT;
+
+  HAL_NVIC_SetPriority(LPTIM1_IRQn, 3, 0);
+  HAL_NVIC_EnableIRQ(LPTIM1_IRQn);
+}
+
 /* MSP Initialization and De-Initialization Functions */
 void HAL_UART_MspInit(UART_HandleTypeDef *huart) {
   // GPIO_InitTypeDef GPIO_InitStruct = {0}; // Removed unused variable
@@ -233,10 +304,44 @@ void HAL_UART_MspInit(UART_HandleTypeDef *huart) {
     __HAL_RCC_LPUART1_CLK_ENABLE();
     __HAL_RCC_GPIOA_CLK_ENABLE(); 
     // GPIOs for LPUART1 are configured in MX_GPIO_Init()
+
+    // Shell output queue: one DMA transfer per queued descriptor (serial.c)
+    hdma_lpuart1_tx.Instance = DMA1_Channel7; // LPUART1_TX (channel 2 is TIM2_UP)
+    hdma_lpuart1_tx.Init.Request = DMA_REQUEST_5;
+    hdma_lpuart1_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    hdma_lpuart1_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_lpuart1_tx.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_lpuart1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma_lpuart1_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma_lpuart1_tx.Init.Mode = DMA_NORMAL;
+    hdma_lpuart1_tx.Init.Priority = DMA_PRIORITY_LOW;
+    if (HAL_DMA_Init(&hdma_lpuart1_tx) != HAL_OK) { while(1); /* Error_Handler(); */ }
+    __HAL_LINKDMA(huart, hdmatx, hdma_lpuart1_tx);
+
+    // Shell RX interrupt (enabled at the UART by serial_init). Below TIM21: a byte
+    // sits in RDR for ~87 us at 115200, far longer than a PWM step.
+    HAL_NVIC_SetPriority(LPUART1_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(LPUART1_IRQn);
   } else if (huart->Instance == USART2) {
     __HAL_RCC_USART2_CLK_ENABLE();
     __HAL_RCC_GPIOA_CLK_ENABLE(); 
     // GPIOs for USART2 are configured in MX_GPIO_Init()
+
+    // Diagnostic stream: double-buffered lines from challenge.c
+    hdma_usart2_tx.Instance = DMA1_Channel4; // USART2_TX
+    hdma_usart2_tx.Init.Request = DMA_REQUEST_4;
+    hdma_usart2_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    hdma_usart2_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_usart2_tx.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_usart2_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma_usart2_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma_usart2_tx.Init.Mode = DMA_NORMAL;
+    hdma_usart2_tx.Init.Priority = DMA_PRIORITY_LOW;
+    if (HAL_DMA_Init(&hdma_usart2_tx) != HAL_OK) { while(1); /* Error_Handler(); */ }
+    __HAL_LINKDMA(huart, hdmatx, hdma_usart2_tx);
+
+    HAL_NVIC_SetPriority(USART2_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(USART2_IRQn);
   }
 }
 
@@ -244,9 +349,12 @@ void HAL_UART_MspDeInit(UART_HandleTypeDef* huart) {
   if(huart->Instance==LPUART1) {
     __HAL_RCC_LPUART1_CLK_DISABLE();
     HAL_GPIO_DeInit(GPIOA, GPIO_PIN_2|GPIO_PIN_3);
+    HAL_DMA_DeInit(huart->hdmatx);
   } else if(huart->Instance==USART2) {
     __HAL_RCC_USART2_CLK_DISABLE();
     HAL_GPIO_DeInit(GPIOA, GPIO_PIN_9|GPIO_PIN_10);
+    HAL_DMA_DeInit(huart->hdmatx);
+    HAL_NVIC_DisableIRQ(USART2_IRQn);
   }
 }
 
@@ -266,10 +374,6 @@ void HAL_TIM_PWM_MspInit(TIM_HandleTypeDef* htim_pwm) {
     HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
   }
-  else if(htim_pwm->Instance==TIM21) {
-    __HAL_RCC_TIM21_CLK_ENABLE();
-    // GPIOs for TIM21 PWM channels would be configured here if used
-  }
   else if(htim_pwm->Instance==TIM22) {
     __HAL_RCC_TIM22_CLK_ENABLE();
     __HAL_RCC_GPIOA_CLK_ENABLE();
@@ -285,21 +389,35 @@ void HAL_TIM_PWM_MspDeInit(TIM_HandleTypeDef* htim_pwm) {
     __HAL_RCC_TIM2_CLK_DISABLE();
     HAL_GPIO_DeInit(GPIOA, GPIO_PIN_0 | GPIO_PIN_1);
   }
-  else if(htim_pwm->Instance==TIM21) {
-    __HAL_RCC_TIM21_CLK_DISABLE();
-    // HAL_GPIO_DeInit for TIM21 pins if configured
-  }
   else if(htim_pwm->Instance==TIM22) {
     __HAL_RCC_TIM22_CLK_DISABLE();
     HAL_GPIO_DeInit(GPIOA, GPIO_PIN_6);
   }
 }
 
+void HAL_TIM_Base_MspInit(TIM_HandleTypeDef* htim_base) {
+  if(htim_base->Instance==TIM21) {
+    __HAL_RCC_TIM21_CLK_ENABLE();
+    // Highest priority: the shortest step/plane is only SW_PWM_MIN_SLOT_TICKS long
+    HAL_NVIC_SetPriority(TIM21_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(TIM21_IRQn);
+  }
+}
+
+void HAL_TIM_Base_MspDeInit(TIM_HandleTypeDef* htim_base) {
+  if(htim_base->Instance==TIM21) {
+    __HAL_RCC_TIM21_CLK_DISABLE();
+    HAL_NVIC_DisableIRQ(TIM21_IRQn);
+  }
+}
+
 void HAL_ADC_MspInit(ADC_HandleTypeDef* adcHandle) {
   if(adcHandle->Instance==ADC1) { 
     __HAL_RCC_ADC1_CLK_ENABLE(); 
-    __HAL_RCC_SYSCFG_CLK_ENABLE(); 
-    HAL_ADCEx_EnableVREFINT(); 
+    __HAL_RCC_SYSCFG_CLK_ENABLE(); // VREFINT buffer control; battery.c turns it on per sampling window
+    // End-of-conversion interrupt for the background battery samples
+    HAL_NVIC_SetPriority(ADC1_COMP_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(ADC1_COMP_IRQn);
   }
 }
 
@@ -307,6 +425,7 @@ void HAL_ADC_MspDeInit(ADC_HandleTypeDef* adcHandle) {
   if(adcHandle->Instance==ADC1) { 
     __HAL_RCC_ADC1_CLK_DISABLE(); 
     HAL_ADCEx_DisableVREFINT(); 
+    HAL_NVIC_DisableIRQ(ADC1_COMP_IRQn);
     // GPIO DeInit for ADC pins if they were configured in MspInit (not the case here)
   }
 }
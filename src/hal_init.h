@@ -10,16 +10,32 @@ extern ADC_HandleTypeDef hadc;
 extern TIM_HandleTypeDef htim2;
 extern TIM_HandleTypeDef htim21;
 extern TIM_HandleTypeDef htim22;
+extern DMA_HandleTypeDef hdma_tim2_up;
+extern DMA_HandleTypeDef hdma_tim2_ch3;
+extern DMA_HandleTypeDef hdma_lpuart1_tx;
+extern DMA_HandleTypeDef hdma_usart2_tx;
+
+/* Constants */
+// TIM2/TIM22 hardware PWM (eye, light bar PA1/PA6): 256-count periods, so the
+// compare value alone sets the brightness at any clock. The prescaler keeps
+// the period rate at or just above HW_PWM_HZ for the current SystemCoreClock.
+#define HW_PWM_PERIOD 256U
+#define HW_PWM_HZ     1000U
 
 /* Function Prototypes */
 void SystemClock_Config(void);
 void MX_GPIO_Init(void);
+void MX_DMA_Init(void);
 void MX_LPUART1_UART_Init(void);
 void MX_USART2_UART_Init(void);
 void MX_ADC_Init(void);
 void MX_TIM2_Init(void);
 void MX_TIM21_Init(void);
 void MX_TIM22_Init(void);
+void MX_LPTIM1_Init(void);
+// Timer prescalers for the current SystemCoreClock (MX_TIMx_Init, clock_gov.c)
+uint32_t hw_pwm_prescaler(void);
+uint32_t sw_pwm_timebase_prescaler(void); // TIM21 at SW_PWM_TIMER_TICK_HZ
 
 // MSP Functions are typically called by HAL_Init functions,
 // but their prototypes can be here for completeness if needed elsewhere,
@@ -0,0 +1,62 @@
+#include "isr_prof.h"
+#include "perf.h" // For perf_cycles_to_us
+
+static volatile IsrProfile_t isr_profiles[ISR_PROF_COUNT];
+static const char* const ISR_PROF_NAMES[ISR_PROF_COUNT] = { "SysTick", "TIM21" };
+
+void isr_prof_exit(IsrProfId_t id, uint32_t stamp, uint32_t latency_cycles) {
+    uint32_t spent = cycles_since(stamp);
+    volatile IsrProfile_t* p = &isr_profiles[id];
+    if (p->calls++ == 0U || spent < p->min_cycles) p->min_cycles = spent;
+    if (spent > p->max_cycles) p->max_cycles = spent;
+    p->total_cycles += spent;
+    if (p->calls == 1U || latency_cycles < p->latency_min_cycles) p->latency_min_cycles = latency_cycles;
+    if (latency_cycles > p->latency_max_cycles) p->latency_max_cycles = latency_cycles;
+    if (perf_cycles_to_us(spent) > ISR_PROF_BUDGET_US) p->over_budget++;
+#if ISR_PROF_SCOPE_PIN
+    ISR_PROF_SCOPE_PORT->BRR = ISR_PROF_SCOPE_PIN_MASK;
+#endif
+}
+
+void isr_prof_init(void) {
+#if ISR_PROF_SCOPE_PIN
+    GPIO_InitTypeDef gpio = {0};
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+    HAL_GPIO_WritePin(ISR_PROF_SCOPE_PORT, ISR_PROF_SCOPE_PIN_MASK, GPIO_PIN_RESET);
+    gpio.Pin = ISR_PROF_SCOPE_PIN_MASK;
+    gpio.Mode = GPIO_MODE_OUTPUT_PP;
+    gpio.Pull = GPIO_NOPULL;
+    gpio.Speed = GPIO_SPEED_FREQ_VERY_HIGH; // Sharp edges for the scope
+    HAL_GPIO_Init(ISR_PROF_SCOPE_PORT, &gpio);
+#endif
+    for (uint8_t id = 0; id < ISR_PROF_COUNT; id++) isr_prof_reset((IsrProfId_t)id);
+}
+
+void isr_prof_reset(IsrProfId_t id) {
+    uint32_t primask = __get_PRIMASK(); // Also called from the main loop with interrupts on
+    __disable_irq();
+    isr_profiles[id].calls = 0;
+    isr_profiles[id].min_cycles = 0;
+    isr_profiles[id].max_cycles = 0;
+    isr_profiles[id].total_cycles = 0;
+    isr_profiles[id].latency_min_cycles = 0;
+    isr_profiles[id].latency_max_cycles = 0;
+    isr_profiles[id].over_budget = 0;
+    __set_PRIMASK(primask);
+}
+
+void get_isr_profile(IsrProfId_t id, IsrProfile_t* out) {
+    __disable_irq(); // 64-bit total is not read atomically on the M0+
+    out->calls = isr_profiles[id].calls;
+    out->min_cycles = isr_profiles[id].min_cycles;
+    out->max_cycles = isr_profiles[id].max_cycles;
+    out->total_cycles = isr_profiles[id].total_cycles;
+    out->latency_min_cycles = isr_profiles[id].latency_min_cycles;
+    out->latency_max_cycles = isr_profiles[id].latency_max_cycles;
+    out->over_budget = isr_profiles[id].over_budget;
+    __enable_irq();
+}
+
+const char* isr_prof_name(IsrProfId_t id) {
+    return ISR_PROF_NAMES[id];
+}
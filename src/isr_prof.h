@@ -0,0 +1,57 @@
+#ifndef ISR_PROF_H
+#define ISR_PROF_H
+
+#include "stm32l0xx_hal.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include "utils.h" // For cycle_stamp, cycles_since
+
+/* Interrupt Profiler */
+// Wraps the periodic interrupt handlers in main.c. Duration is measured from
+// handler entry to exit with SysTick->VAL (includes any higher-priority
+// interrupt that preempts it). Latency is how long after its timer event the
+// handler was entered, read from the timer's own counter; its spread is the
+// tick-to-tick jitter. Runs longer than the budget are counted.
+#define ISR_PROF_BUDGET_US 20U
+
+// Build with -D ISR_PROF_SCOPE_PIN=1 to drive PA4 (otherwise unused) high
+// while a profiled handler runs, for a scope or logic analyzer. A nested
+// profiled handler ends the pulse early.
+#ifndef ISR_PROF_SCOPE_PIN
+#define ISR_PROF_SCOPE_PIN 0
+#endif
+#define ISR_PROF_SCOPE_PORT GPIOA
+#define ISR_PROF_SCOPE_PIN_MASK GPIO_PIN_4
+
+typedef enum {
+    ISR_PROF_SYSTICK, // HAL tick
+    ISR_PROF_TIM21,   // Software PWM timebase
+    ISR_PROF_COUNT
+} IsrProfId_t;
+
+typedef struct {
+    uint32_t calls;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+    uint32_t latency_min_cycles; // Timer event to handler entry
+    uint32_t latency_max_cycles;
+    uint32_t over_budget;        // Runs longer than ISR_PROF_BUDGET_US
+} IsrProfile_t;
+
+/* Function Prototypes */
+// Handler entry: returns the stamp isr_prof_exit() measures from.
+static inline uint32_t isr_prof_enter(void) {
+#if ISR_PROF_SCOPE_PIN
+    ISR_PROF_SCOPE_PORT->BSRR = ISR_PROF_SCOPE_PIN_MASK;
+#endif
+    return cycle_stamp();
+}
+
+void isr_prof_exit(IsrProfId_t id, uint32_t stamp, uint32_t latency_cycles); // Handler exit
+void isr_prof_init(void);            // Scope pin, if enabled; counters cleared
+void isr_prof_reset(IsrProfId_t id);
+void get_isr_profile(IsrProfId_t id, IsrProfile_t* out);
+const char* isr_prof_name(IsrProfId_t id);
+
+#endif // ISR_PROF_H
@@ -0,0 +1,132 @@
+#include "journal.h"
+#include "stm32l0xx_hal_flash.h" // For EEPROM access functions
+#include "sched.h"
+
+#define JOURNAL_CRC_POLY   0x1021U // CRC-16/CCITT
+#define JOURNAL_MAX_TRIES  4U      // Slots tried when a record does not read back (worn cell)
+
+static bool jr_valid;
+static uint16_t jr_seq;
+static uint16_t jr_slot;
+static uint32_t jr_payload; // Newest record on EEPROM
+static bool jr_pending;
+static uint32_t jr_pending_payload;
+static JournalStats_t jr_stats;
+static SchedId_t jr_task = SCHED_NONE;
+
+static void journal_commit_task(uint32_t now) {
+    (void)now;
+    journal_flush();
+}
+
+static const SchedTask_t journal_task = { "journal", journal_commit_task, NULL, 0U, SCHED_PRIO_JOURNAL }; // One-shot, armed by journal_write
+
+static uint32_t slot_address(uint16_t slot) {
+    return DATA_EEPROM_BASE + (uint32_t)slot * JOURNAL_RECORD_SIZE;
+}
+
+static uint16_t journal_crc(uint32_t payload, uint16_t seq) {
+    uint8_t bytes[6] = {
+        (uint8_t)payload, (uint8_t)(payload >> 8), (uint8_t)(payload >> 16), (uint8_t)(payload >> 24),
+        (uint8_t)seq, (uint8_t)(seq >> 8)
+    };
+    uint16_t crc = 0xFFFFU;
+    for (uint8_t i = 0; i < sizeof(bytes); i++) {
+        crc ^= (uint16_t)bytes[i] << 8;
+        for (uint8_t bit = 0; bit < 8U; bit++) {
+            crc = (crc & 0x8000U) ? (uint16_t)((crc << 1) ^ JOURNAL_CRC_POLY) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static uint32_t seal_word(uint32_t payload, uint16_t seq) {
+    return ((uint32_t)seq << 16) | journal_crc(payload, seq);
+}
+
+bool journal_init(uint32_t* payload, uint16_t first_slot) {
+    jr_valid = false;
+    jr_pending = false;
+    jr_stats.commits = 0;
+    jr_stats.skipped = 0;
+    jr_stats.coalesced = 0;
+    jr_task = sched_add(&journal_task);
+
+    // Live records span fewer than JOURNAL_SLOTS sequence numbers, so "newest"
+    // is well defined across the 16-bit wrap.
+    for (uint16_t slot = 0; slot < JOURNAL_SLOTS; slot++) {
+        uint32_t data = EEPROM_READ_WORD(slot_address(slot));
+        uint32_t seal = EEPROM_READ_WORD(slot_address(slot) + 4U);
+        uint16_t seq = (uint16_t)(seal >> 16);
+        if (seal != seal_word(data, seq)) continue; // Erased, torn or foreign
+        if (!jr_valid || (int16_t)(seq - jr_seq) > 0) {
+            jr_valid = true;
+            jr_seq = seq;
+            jr_slot = slot;
+            jr_payload = data;
+        }
+    }
+    if (!jr_valid) {
+        jr_seq = 0;
+        jr_slot = (uint16_t)((first_slot + JOURNAL_SLOTS - 1U) % JOURNAL_SLOTS); // Next write lands on first_slot
+        return false;
+    }
+    *payload = jr_payload;
+    return true;
+}
+
+// Payload word first, then the seal that makes the record valid. The HAL
+// erases and programs each word itself (data EEPROM needs no page erase).
+static void journal_commit(uint32_t payload) {
+    HAL_FLASHEx_DATAEEPROM_Unlock();
+    for (uint8_t tries = 0; tries < JOURNAL_MAX_TRIES; tries++) {
+        uint16_t slot = (uint16_t)((jr_slot + 1U) % JOURNAL_SLOTS);
+        uint16_t seq = (uint16_t)(jr_seq + 1U);
+        uint32_t addr = slot_address(slot);
+        HAL_FLASHEx_DATAEEPROM_Program(FLASH_TYPEPROGRAMDATA_WORD, addr, payload);
+        HAL_FLASHEx_DATAEEPROM_Program(FLASH_TYPEPROGRAMDATA_WORD, addr + 4U, seal_word(payload, seq));
+        jr_slot = slot; // A slot that failed is skipped from now on until the next lap
+        jr_seq = seq;
+        if (EEPROM_READ_WORD(addr) == payload && EEPROM_READ_WORD(addr + 4U) == seal_word(payload, seq)) {
+            jr_valid = true;
+            jr_payload = payload;
+            jr_stats.commits++;
+            break;
+        }
+    }
+    HAL_FLASHEx_DATAEEPROM_Lock();
+}
+
+void journal_write(uint32_t payload, bool urgent) {
+    uint32_t target = jr_pending ? jr_pending_payload : jr_payload;
+    if ((jr_pending || jr_valid) && payload == target) {
+        jr_stats.skipped++;
+    } else if (jr_valid && payload == jr_payload) {
+        jr_pending = false; // Changed back before the commit: nothing to write
+        sched_cancel(jr_task);
+        jr_stats.coalesced++;
+    } else {
+        if (jr_pending) {
+            jr_stats.coalesced++;
+        } else {
+            sched_at(jr_task, HAL_GetTick() + JOURNAL_COMMIT_DELAY_MS);
+        }
+        jr_pending = true;
+        jr_pending_payload = payload;
+    }
+    if (urgent) journal_flush();
+}
+
+void journal_flush(void) {
+    if (!jr_pending) return;
+    jr_pending = false;
+    sched_cancel(jr_task);
+    journal_commit(jr_pending_payload);
+}
+
+void get_journal_stats(JournalStats_t* out) {
+    *out = jr_stats;
+    out->seq = jr_seq;
+    out->slot = jr_slot;
+    out->valid = jr_valid;
+}
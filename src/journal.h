@@ -0,0 +1,48 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "stm32l0xx_hal.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Data EEPROM Record Journal */
+// One 32-bit record (challenge.c packs repair_status into it), stored
+// log-structured across the whole data EEPROM. Each write goes to the slot
+// after the newest one, so wear spreads over every slot. A record is two
+// words, payload first, then sequence number and CRC. The second word commits
+// it: a write torn by a reset fails the CRC and the previous record stays
+// current. Writes of an unchanged value are skipped, and a burst of changes
+// is coalesced into one record after JOURNAL_COMMIT_DELAY_MS (a one-shot
+// scheduler task, registered by journal_init).
+#ifndef DATA_EEPROM_BASE
+#define DATA_EEPROM_BASE ((uint32_t)0x08080000U)
+#endif
+#ifndef DATA_EEPROM_END
+#define DATA_EEPROM_END  ((uint32_t)0x080803FFU) // STM32L031: 1 KB
+#endif
+#ifndef EEPROM_READ_WORD
+#define EEPROM_READ_WORD(addr) (*(__IO uint32_t *)(addr)) // Data EEPROM is memory-mapped (host build remaps it)
+#endif
+#define JOURNAL_RECORD_SIZE     8U
+#define JOURNAL_SLOTS           ((DATA_EEPROM_END - DATA_EEPROM_BASE + 1U) / JOURNAL_RECORD_SIZE)
+#define JOURNAL_COMMIT_DELAY_MS 3000U // From the first change of a burst to its record
+
+typedef struct {
+    uint32_t commits;   // Records written
+    uint32_t skipped;   // Writes that matched the stored (or pending) value
+    uint32_t coalesced; // Changes folded into an already pending record
+    uint16_t seq;       // Sequence number of the newest record
+    uint16_t slot;      // Slot it lives in
+    bool valid;         // A record exists
+} JournalStats_t;
+
+/* Function Prototypes */
+// After sched_init. Scans the journal; true and the newest valid record in 'payload' if there is one.
+// 'first_slot' is where writing starts when the journal is empty (to keep
+// another layout in slot 0 intact until the first record supersedes it).
+bool journal_init(uint32_t* payload, uint16_t first_slot);
+void journal_write(uint32_t payload, bool urgent); // urgent: commit now instead of after the delay
+void journal_flush(void);                          // Commit a pending record now (before a reset)
+void get_journal_stats(JournalStats_t* out);
+
+#endif // JOURNAL_H
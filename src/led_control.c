@@ -1,6 +1,7 @@
 #include "led_control.h"
-#include "sw_pwm.h" // For sw_pwm_duty_cycles if driveLED directly manipulates it
+#include "sw_pwm.h" // For set_sw_pwm_levels (framebuffer flush)
 #include "hal_init.h" // For TIM handles like htim2
+#include "led_fx.h" // Keyframe effect engine
 #include <string.h>   // For strcmp in getEffectName (though not strictly needed if only switch)
 #include <stdio.h>    // For snprintf if any debug messages were to be added
 #include <stdlib.h>   // For rand()
@@ -9,29 +10,6 @@
 // AppEffect_t effect is defined in main.c and extern in led_control.h
 // bool burstActive is defined in main.c and extern in led_control.h
 
-/* Static variables for LED effects states */
-// Strike Effect
-static uint8_t  strike_phase = 0;
-static uint32_t strike_phaseStartTime = 0;
-static uint32_t strike_lastStepTime = 0;
-static uint32_t strike_lastSparkleTime = 0;
-static uint32_t lastBurstTriggerTime = 0; // Renamed from main.c's lastBurstTriggerTime for clarity if needed
-static uint8_t intro_sub_phase = 0;
-static uint8_t intro_leader_idx = 0;
-static const uint8_t intro_leader_sequence[] = {4, 3, 2, 1, 0, 6, 5, 7};
-#define INTRO_LEADER_SEQUENCE_LENGTH (sizeof(intro_leader_sequence)/sizeof(intro_leader_sequence[0]))
-
-// Eye Pulse for EFFECT_OFF
-static uint32_t last_eye_pulse_trigger_time = 0;
-static uint8_t  eye_pulse_sub_phase = 0;
-static uint32_t eye_pulse_sub_phase_start_time = 0;
-
-// Generic Eye Animation (for non-strike/non-off modes)
-static uint32_t eyeLast_generic = 0;
-static int16_t  eyeLvl_generic  = 0;
-static int8_t   eyeDir_generic  = 4;
-
-
 /* LED Pin Definitions */
 LED_Pin_t LIGHT_PINS[LIGHT_PIN_COUNT] = {
     {GPIOA, GPIO_PIN_1}, {GPIOA, GPIO_PIN_8}, {GPIOB, GPIO_PIN_1}, {GPIOA, GPIO_PIN_6},
@@ -41,50 +19,243 @@ LED_Pin_t LIGHT_PINS[LIGHT_PIN_COUNT] = {
 const uint8_t custom_marquee_sequence[LIGHT_PIN_COUNT] = {4, 3, 2, 1, 0, 6, 5, 7}; // Matches original
 #define CUSTOM_MARQUEE_SEQUENCE_LENGTH (sizeof(custom_marquee_sequence)/sizeof(custom_marquee_sequence[0]))
 
+/* Effect Programs */
+// Keyframe programs played by led_fx.c. Bar masks are positions in
+// custom_marquee_sequence (FX_BAR(0) = LED 4 ... FX_BAR(7) = LED 7).
+// Track 0 drives the light bar, track 1 the sparkle overlay or the comet
+// brightness register, track 2 the eye.
+
+// Eye: slow triangle for the bling modes (4 steps every 20 ms).
+static const FxOp_t fx_eye_glow[] = {
+    FX_RAMP(FX_CH_EYE, 255, 4, 20),
+    FX_RAMP(FX_CH_EYE, 0, 4, 20),
+    FX_JUMP(0),
+};
+static const FxOp_t fx_eye_solid[] = { FX_SET(FX_CH_EYE, EYE_SOLID_ON_BRIGHTNESS), FX_END() };
+static const FxOp_t fx_eye_full[]  = { FX_SET(FX_CH_EYE, 255), FX_END() };
+static const FxOp_t fx_bar_off[]   = { FX_SET(FX_BAR_ALL, 0), FX_END() };
+
+// IDLE: light bar off, eye solid with a dim/peak blink every EYE_PULSE_INTERVAL_MS.
+static const FxOp_t fx_eye_idle_pulse[] = {
+    FX_SET(FX_CH_EYE, EYE_SOLID_ON_BRIGHTNESS),
+    FX_WAIT(EYE_PULSE_INTERVAL_MS),
+    FX_SET(FX_CH_EYE, EYE_PULSE_DIM_BRIGHTNESS),
+    FX_WAIT(EYE_PULSE_DIM_DURATION_MS),
+    FX_SET(FX_CH_EYE, EYE_PULSE_PEAK_BRIGHTNESS),
+    FX_WAIT(EYE_PULSE_PEAK_DURATION_MS),
+    FX_SET(FX_CH_EYE, EYE_SOLID_ON_BRIGHTNESS),
+    FX_WAIT(EYE_PULSE_RETURN_DURATION_MS),
+    FX_JUMP(0),
+};
+
+// Ultra-idle OFF: the eye only switches between off and full on, which needs
+// no running PWM, so the MCU sits in Stop mode and LPTIM1 wakes it for each edge.
+static const FxOp_t fx_eye_heartbeat[] = {
+    FX_SET(FX_CH_EYE, 255),
+    FX_WAIT(EYE_HEARTBEAT_BEAT_MS),
+    FX_SET(FX_CH_EYE, 0),
+    FX_WAIT(EYE_HEARTBEAT_GAP_MS),
+    FX_SET(FX_CH_EYE, 255),
+    FX_WAIT(EYE_HEARTBEAT_BEAT_MS),
+    FX_SET(FX_CH_EYE, 0),
+    FX_WAIT(EYE_HEARTBEAT_INTERVAL_MS),
+    FX_JUMP(0),
+};
+
+// STRIKE: leader chase, two flashes, hold, 5-LED marquee, then sparkles fading
+// out and a STRIKE_RESTART_DELAY_MS rest with the bar dark.
+#define STRIKE_INTRO_MS (40 + 7 * 40 + 50 + 100 + 100 + 100 + 500)
+static const FxOp_t fx_strike_bar[] = {
+    FX_BURST(1),
+    FX_WAIT(40),
+    FX_SHOW(FX_BAR(0), 255, 0, 40), FX_SHOW(FX_BAR(1), 255, 0, 40), FX_SHOW(FX_BAR(2), 255, 0, 40),
+    FX_SHOW(FX_BAR(3), 255, 0, 40), FX_SHOW(FX_BAR(4), 255, 0, 40), FX_SHOW(FX_BAR(5), 255, 0, 40),
+    FX_SHOW(FX_BAR(6), 255, 0, 40),
+    FX_SHOW(0, 0, 0, 50),                  // Delay after leader
+    FX_SHOW(FX_BAR_ALL, 255, 0, 100),      // Flash 1
+    FX_SHOW(0, 0, 0, 100),
+    FX_SHOW(FX_BAR_ALL, 255, 0, 100),      // Flash 2
+    FX_WAIT(500),                          // Hold all on
+    // Marquee: 5 LEDs centred on the sweep position, one step per 110 ms
+    FX_WAIT(110),
+    FX_SHOW(FX_BAR(6) | FX_BAR(7) | FX_BAR(0) | FX_BAR(1) | FX_BAR(2), 255, 0, 110),
+    FX_ROTATE(110, 43),
+    FX_ROTATE(50, 1),                      // Ends STRIKE_PHASE1_DURATION after the hold
+    FX_SHOW(0, 0, 0, STRIKE_PHASE2_FADE_DURATION), // Sparkles only (track 1)
+    FX_BURST(0),
+    FX_WAIT(STRIKE_RESTART_DELAY_MS),
+    FX_JUMP(0),
+};
+// Sparkle density ramps 0..3 per 30 ms over the second half of the marquee,
+// then falls 3..0 over the fade phase (STRIKE_SPARKLE_MAX_DENSITY steps each).
+#define STRIKE_RAMP_STEP_MS (STRIKE_PHASE1_SPARKLE_RAMP_DURATION / STRIKE_SPARKLE_MAX_DENSITY)
+#define STRIKE_FADE_STEP_MS (STRIKE_PHASE2_FADE_DURATION / STRIKE_SPARKLE_MAX_DENSITY)
+static const FxOp_t fx_strike_sparkle[] = {
+    FX_WAIT(STRIKE_INTRO_MS + STRIKE_PHASE1_SPARKLE_START_OFFSET + STRIKE_RAMP_STEP_MS),
+    FX_SPARKLE(1, 30, STRIKE_RAMP_STEP_MS),
+    FX_SPARKLE(2, 30, STRIKE_RAMP_STEP_MS),
+    FX_SPARKLE(3, 30, STRIKE_RAMP_STEP_MS),
+    FX_SPARKLE(3, 30, STRIKE_FADE_STEP_MS),
+    FX_SPARKLE(2, 30, STRIKE_FADE_STEP_MS),
+    FX_SPARKLE(1, 30, STRIKE_FADE_STEP_MS),
+    FX_WAIT(STRIKE_FADE_STEP_MS),
+    FX_WAIT(STRIKE_RESTART_DELAY_MS),
+    FX_JUMP(0),
+};
+
+// CRACKLE: 4 random LEDs relit every 21 ms.
+static const FxOp_t fx_crackle_sparkle[] = { FX_SPARKLE(4, 21, 0) };
+
+// BREATHE: whole bar ramps 0..255..0 in steps of 5 every 15 ms.
+static const FxOp_t fx_breathe_bar[] = {
+    FX_RAMP(FX_BAR_ALL, 255, 5, 15),
+    FX_RAMP(FX_BAR_ALL, 0, 5, 15),
+    FX_JUMP(0),
+};
+
+static const FxOp_t fx_all_on_bar[] = { FX_SET(FX_BAR_ALL, 255), FX_END() };
+
+// SCANNER: 2-LED window bouncing along the sweep order, 75 ms per step.
+#define SCAN(pos) FX_SHOW(FX_BAR(pos) | FX_BAR((pos) + 1), 255, 0, 75)
+static const FxOp_t fx_scanner_bar[] = {
+    SCAN(0), SCAN(1), SCAN(2), SCAN(3), SCAN(4), SCAN(5), SCAN(6),
+    SCAN(6), SCAN(5), SCAN(4), SCAN(3), SCAN(2), SCAN(1), SCAN(0),
+    FX_JUMP(0),
+};
+
+// CONVERGE_DIVERGE: pairs sweep in from both ends, then a comet circles the
+// bar while its brightness (FX_CH_REG) glows 20..255..20 one step per 50 ms.
+#define CONVERGE_STEP_MS 180
+#define CONVERGE_BG 50
+static const FxOp_t fx_converge_bar[] = {
+    FX_SHOW(0, 0, CONVERGE_BG, CONVERGE_STEP_MS),
+    FX_SHOW(FX_BAR(0) | FX_BAR(7), 220, CONVERGE_BG, CONVERGE_STEP_MS),
+    FX_SHOW(FX_BAR(1) | FX_BAR(6), 220, CONVERGE_BG, CONVERGE_STEP_MS),
+    FX_SHOW(FX_BAR(2) | FX_BAR(5), 220, CONVERGE_BG, CONVERGE_STEP_MS),
+    FX_SHOW(FX_BAR(3) | FX_BAR(4), 220, CONVERGE_BG, CONVERGE_STEP_MS),
+    FX_COMET(CONVERGE_BG, 50),
+};
+static const FxOp_t fx_converge_glow[] = {
+    FX_WAIT(5 * CONVERGE_STEP_MS),
+    FX_SET(FX_CH_REG, 20),
+    FX_RAMP(FX_CH_REG, 255, 1, 50),
+    FX_RAMP(FX_CH_REG, 20, 1, 50),
+    FX_JUMP(2),
+};
+
+// Indexed by AppEffect_t
+static const FxEffect_t fx_effects[] = {
+    [EFFECT_OFF]              = { { fx_bar_off,      NULL,               fx_eye_idle_pulse } },
+    [EFFECT_STRIKE]           = { { fx_strike_bar,   fx_strike_sparkle,  fx_eye_solid } },
+    [EFFECT_CRACKLE]          = { { fx_bar_off,      fx_crackle_sparkle, fx_eye_solid } },
+    [EFFECT_BREATHE]          = { { fx_breathe_bar,  NULL,               fx_eye_glow } },
+    [EFFECT_ALL_ON]           = { { fx_all_on_bar,   NULL,               fx_eye_full } },
+    [EFFECT_SCANNER]          = { { fx_scanner_bar,  NULL,               fx_eye_solid } },
+    [EFFECT_CONVERGE_DIVERGE] = { { fx_converge_bar, fx_converge_glow,   fx_eye_solid } },
+};
+#define FX_EFFECT_COUNT (sizeof(fx_effects) / sizeof(fx_effects[0]))
+static const FxEffect_t fx_ultra_idle = { { fx_bar_off, NULL, fx_eye_heartbeat } }; // EFFECT_OFF in ultra-idle
+
+static AppEffect_t fx_loaded_effect = (AppEffect_t)-1; // Effect the engine is playing
+static bool led_ultra_idle = LED_ULTRA_IDLE_DEFAULT;
+
+// Framebuffer: effects compose a whole frame here and flushLEDs() pushes it out
+// once per update, so intermediate clear/relight states never reach the pins.
+static uint8_t led_fb[LED_FB_SIZE];       // Frame being composed
+static uint8_t led_fb_shown[LED_FB_SIZE]; // Frame last written to the PWM hardware
+static bool    led_fb_force_flush = true; // Write every channel on the first flush
+static uint32_t led_hw_flush_tick;         // Last hardware PWM compare write
+static int8_t  led_sw_channel[LIGHT_PIN_COUNT]; // SW PWM channel per LED, -1 for hardware PWM
+
 void driveLED(uint8_t led_idx, uint8_t val) {
     if (led_idx >= LIGHT_PIN_COUNT) return;
+    led_fb[led_idx] = val;
+}
 
-    const uint8_t* current_sw_pwm_pin_indices = get_sw_pwm_pin_indices();
-    bool is_sw_pwm = false;
-    for (int i = 0; i < NUM_SW_PWM_CHANNELS; ++i) {
-        if (led_idx == current_sw_pwm_pin_indices[i]) {
-            uint8_t scaled_duty = (uint8_t)(((uint32_t)val * SW_PWM_RESOLUTION) / 255);
-            set_sw_pwm_channel_duty(i, scaled_duty);
-            is_sw_pwm = true;
-            break;
-        }
-    }
+void driveEye(uint8_t val) {
+    led_fb[LED_FB_EYE_IDX] = val;
+}
 
-    if (is_sw_pwm) {
-        return;
+void clearAllLEDs(void) {
+    for (uint8_t i = 0; i < LIGHT_PIN_COUNT; ++i) {
+        led_fb[i] = 0;
     }
+    // Also turn off the Eye LED (PA0, TIM2_CH1)
+    led_fb[LED_FB_EYE_IDX] = 0;
+}
+
+// Hardware PWM periods are 256 counts (ARR 255). A compare value past ARR
+// keeps the output high for the whole period, so full brightness is a steady
+// level, like off, and holds while the timers are stopped.
+static uint32_t hw_pwm_compare(uint8_t level) {
+    return (level == 255U) ? 256U : level;
+}
 
-    // Hardware PWM channels
-    uint8_t pwm_value = val;
-    switch(led_idx) {
-        case 0: // PA1 (LIGHT_PINS[0]) -> TIM2_CH2 (as per original main.c, assuming PA1 is TIM2_CH2)
-                // Original driveLED case 0 was TIM2_CH2. LIGHT_PINS[0] is PA1.
-                // HAL_TIM_PWM_MspInit configures PA0 as TIM2_CH1 and PA1 as TIM2_CH2.
-                // So led_idx 0 (LIGHT_PINS[0] = PA1) should control TIM2_CH2.
-            __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_2, pwm_value);
-            break;
-        case 3: // PA6 (LIGHT_PINS[3]) -> TIM22_CH1 (as per original main.c, assuming PA6 is TIM22_CH1)
-                // Original driveLED case 3 was TIM22_CH1. LIGHT_PINS[3] is PA6.
-                // HAL_TIM_PWM_MspInit configures PA6 as TIM22_CH1.
-            __HAL_TIM_SET_COMPARE(&htim22, TIM_CHANNEL_1, pwm_value);
-            break;
-        // Other hardware PWM pins if any would be here.
-        // The eye LED (PA0) is TIM2_CH1, handled separately or via its own index if added to LIGHT_PINS logic.
-        // Original code handles eye via __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, ...);
+// Fully on or off pins need no timer running: the MCU may enter Stop mode.
+// A compare value only reaches the pin at the timer's next update, so the
+// timers keep running for LED_HW_LATCH_MS after each write.
+bool leds_static(void) {
+    if (is_sw_pwm_running() || led_fb_force_flush) return false;
+    if (HAL_GetTick() - led_hw_flush_tick < LED_HW_LATCH_MS) return false;
+    for (uint8_t i = 0; i < LED_FB_SIZE; ++i) {
+        if (i < LIGHT_PIN_COUNT && led_sw_channel[i] >= 0) continue;
+        if (led_fb_shown[i] != 0U && led_fb_shown[i] != 255U) return false;
     }
+    return true;
 }
 
-void clearAllLEDs(void) {
+void flushLEDs(void) {
+    uint8_t sw_levels[NUM_SW_PWM_CHANNELS] = {0};
+    bool sw_dirty = false;
+    bool hw_dirty = false;
+
     for (uint8_t i = 0; i < LIGHT_PIN_COUNT; ++i) {
-        driveLED(i, 0);
+        int8_t ch = led_sw_channel[i];
+        if (ch >= 0) {
+            sw_levels[ch] = led_fb[i];
+            if (led_fb[i] != led_fb_shown[i]) sw_dirty = true;
+        } else if (led_fb[i] != led_fb_shown[i]) {
+            hw_dirty = true;
+        }
     }
-    // Also explicitly turn off the Eye LED (PA0, TIM2_CH1)
-    __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, 0);
+    if (led_fb[LED_FB_EYE_IDX] != led_fb_shown[LED_FB_EYE_IDX]) hw_dirty = true;
+
+    if (hw_dirty || led_fb_force_flush) {
+        // CCRs are preloaded, so new duties only take effect at the next update
+        // event. UDIS holds the update off while the group is written so all
+        // channels of a timer switch on the same period boundary. TIM2's update
+        // also paces the DMA waveform, which must not lose a step, so it is left
+        // alone in that mode.
+        bool hold_tim2 = (get_sw_pwm_mode() != SW_PWM_MODE_DMA);
+        if (hold_tim2) htim2.Instance->CR1 |= TIM_CR1_UDIS;
+        htim22.Instance->CR1 |= TIM_CR1_UDIS;
+
+        // Hardware PWM channels
+        // led 0: PA1 (LIGHT_PINS[0]) -> TIM2_CH2, led 3: PA6 (LIGHT_PINS[3]) -> TIM22_CH1,
+        // eye: PA0 -> TIM2_CH1 (configured in HAL_TIM_PWM_MspInit).
+        if (led_fb_force_flush || led_fb[LED_FB_EYE_IDX] != led_fb_shown[LED_FB_EYE_IDX]) {
+            __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, hw_pwm_compare(led_fb[LED_FB_EYE_IDX]));
+        }
+        if (led_fb_force_flush || led_fb[0] != led_fb_shown[0]) {
+            __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_2, hw_pwm_compare(led_fb[0]));
+        }
+        if (led_fb_force_flush || led_fb[3] != led_fb_shown[3]) {
+            __HAL_TIM_SET_COMPARE(&htim22, TIM_CHANNEL_1, hw_pwm_compare(led_fb[3]));
+        }
+
+        htim22.Instance->CR1 &= ~TIM_CR1_UDIS;
+        if (hold_tim2) htim2.Instance->CR1 &= ~TIM_CR1_UDIS;
+        led_hw_flush_tick = HAL_GetTick();
+    }
+
+    if (sw_dirty || led_fb_force_flush) {
+        set_sw_pwm_levels(sw_levels); // One table rebuild, latched by the ISR at its next period
+    }
+
+    for (uint8_t i = 0; i < LED_FB_SIZE; ++i) {
+        led_fb_shown[i] = led_fb[i];
+    }
+    led_fb_force_flush = false;
 }
 
 const char* getEffectName(AppEffect_t current_effect_val) {
@@ -101,413 +272,82 @@ const char* getEffectName(AppEffect_t current_effect_val) {
 }
 
 void init_led_effects(void) {
+    // Resolve which LEDs are software PWM channels once, instead of searching per write.
+    const uint8_t* sw_pin_indices = get_sw_pwm_pin_indices();
+    for (uint8_t i = 0; i < LIGHT_PIN_COUNT; ++i) {
+        led_sw_channel[i] = -1;
+        for (int ch = 0; ch < NUM_SW_PWM_CHANNELS; ++ch) {
+            if (sw_pin_indices[ch] == i) {
+                led_sw_channel[i] = (int8_t)ch;
+                break;
+            }
+        }
+    }
+    led_fb_force_flush = true;
+
     // Initialize static variables for effects if needed, e.g., random seeds, initial states.
     // Most are initialized at declaration or when an effect starts.
     // srand(HAL_GetTick()); // srand is called in main.c
 }
 
 
-// This function combines the logic from the main loop's effect handling
-// and the original updateBlingEffects()
+// Plays the current effect's keyframe programs and writes the frame out.
 void update_led_visuals(uint32_t now) {
-    // Generic eye animation for non-strike/non-off modes (if not handled by specific effect)
-    if (effect != EFFECT_OFF && effect != EFFECT_STRIKE) {
-      if (now - eyeLast_generic >= 20) {
-        eyeLast_generic = now;
-        eyeLvl_generic += eyeDir_generic;
-        if (eyeLvl_generic >= 255) { eyeLvl_generic = 255; eyeDir_generic = -eyeDir_generic; }
-        if (eyeLvl_generic <= 0)   { eyeLvl_generic = 0;   eyeDir_generic = -eyeDir_generic; }
-        uint8_t pwm_val = (uint8_t)eyeLvl_generic;
-        __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, pwm_val); // Eye LED on TIM2_CH1
-      }
+    if (effect != EFFECT_STRIKE) {
+        burstActive = false; // Only STRIKE bursts
     }
-    // Note: EFFECT_STRIKE controls its eye directly.
-    // EFFECT_OFF has its own eye pulse logic handled in its main effect block.
-
-
-    if (effect == EFFECT_STRIKE) {
-        const uint32_t SPARKLE_INTERVAL_MS = 30;
-        const uint8_t  SPARKLE_MAX_DENSITY_VAL = 4;
-
-        if (!burstActive && (now - lastBurstTriggerTime >= STRIKE_RESTART_DELAY_MS)) {
-            burstActive = true;
-            strike_phase = 0;
-            strike_phaseStartTime = now;
-            strike_lastStepTime = now;
-            strike_lastSparkleTime = now;
-            intro_sub_phase = 0;
-            intro_leader_idx = 0;
-            clearAllLEDs();
-            __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, EYE_SOLID_ON_BRIGHTNESS);
-        }
 
-        if (burstActive) {
-            uint32_t phaseElapsedTime = now - strike_phaseStartTime;
-            switch (strike_phase) {
-                case 0: // Intro sequence
-                {
-                    const uint32_t INTRO_LEADER_LED_DURATION_MS = 40;
-                    const uint8_t  INTRO_LEADER_BRIGHTNESS = 255;
-                    const uint32_t INTRO_DELAY_AFTER_LEADER_MS = 50;
-                    const uint32_t NEW_INTRO_FLASH_ON_MS = 100;
-                    const uint32_t NEW_INTRO_FLASH_OFF_MS = 100;
-                    const uint8_t  INTRO_FLASH_BRIGHTNESS = 255;
-                    const uint32_t HOLD_ALL_ON_DURATION_MS = 500;
-
-                    if (intro_sub_phase == 0) { // Leader animation
-                        if (now - strike_lastStepTime >= INTRO_LEADER_LED_DURATION_MS) {
-                            strike_lastStepTime = now;
-                            clearAllLEDs();
-                            __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, EYE_SOLID_ON_BRIGHTNESS);
-                            if (intro_leader_idx < INTRO_LEADER_SEQUENCE_LENGTH) {
-                                driveLED(intro_leader_sequence[intro_leader_idx], INTRO_LEADER_BRIGHTNESS);
-                                intro_leader_idx++;
-                            }
-                            if (intro_leader_idx >= INTRO_LEADER_SEQUENCE_LENGTH) {
-                                intro_sub_phase = 6; // Transition to delay
-                                intro_leader_idx = 0; // Reset for potential reuse
-                                clearAllLEDs();
-                                __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, EYE_SOLID_ON_BRIGHTNESS);
-                                strike_lastStepTime = now; // Reset timer for delay
-                            }
-                        }
-                    } else if (intro_sub_phase == 6) { // Delay after leader
-                        if (now - strike_lastStepTime >= INTRO_DELAY_AFTER_LEADER_MS) {
-                            intro_sub_phase = 1; // Transition to first flash
-                        }
-                    } else if (intro_sub_phase == 1) { // First flash ON
-                        for (uint8_t i = 0; i < INTRO_LEADER_SEQUENCE_LENGTH; ++i) {
-                            driveLED(intro_leader_sequence[i], INTRO_FLASH_BRIGHTNESS);
-                        }
-                        intro_sub_phase = 2;
-                        strike_lastStepTime = now;
-                    } else if (intro_sub_phase == 2) { // First flash ON duration
-                        if (now - strike_lastStepTime >= NEW_INTRO_FLASH_ON_MS) {
-                            clearAllLEDs();
-                            __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, EYE_SOLID_ON_BRIGHTNESS);
-                            intro_sub_phase = 3;
-                            strike_lastStepTime = now;
-                        }
-                    } else if (intro_sub_phase == 3) { // First flash OFF duration
-                        if (now - strike_lastStepTime >= NEW_INTRO_FLASH_OFF_MS) {
-                            intro_sub_phase = 4; // Transition to second flash
-                        }
-                    } else if (intro_sub_phase == 4) { // Second flash ON
-                         for (uint8_t i = 0; i < INTRO_LEADER_SEQUENCE_LENGTH; ++i) {
-                            driveLED(intro_leader_sequence[i], INTRO_FLASH_BRIGHTNESS);
-                        }
-                        intro_sub_phase = 5;
-                        strike_lastStepTime = now;
-                    } else if (intro_sub_phase == 5) { // Second flash ON duration
-                        if (now - strike_lastStepTime >= NEW_INTRO_FLASH_ON_MS) {
-                            // No clear here, hold them on
-                            intro_sub_phase = 7; // Transition to hold
-                            strike_lastStepTime = now;
-                        }
-                    } else if (intro_sub_phase == 7) { // Hold all ON duration
-                        if (now - strike_lastStepTime >= HOLD_ALL_ON_DURATION_MS) {
-                            strike_phase = 1; // Transition to main strike (marquee)
-                            strike_phaseStartTime = now; // Reset phase timer
-                            strike_lastStepTime = now;
-                            strike_lastSparkleTime = now;
-                            // strike_marqueePos = 0; // marqueePos is static in main.c, will be moved here
-                        }
-                    }
-                    break;
-                }
-                case 1: // Main strike phase (marquee + increasing sparkle)
-                {
-                    static int8_t strike_marqueePos = 0; // Now static to this function/file
-                    const uint8_t strike_marqueeLength = 5;
-                    const uint32_t MARQUEE_STEP_MS = 110;
-                    const uint8_t MARQUEE_BRIGHTNESS = 255;
-
-                    if (now - strike_lastStepTime >= MARQUEE_STEP_MS) {
-                        strike_lastStepTime = now;
-                        clearAllLEDs();
-                        __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, EYE_SOLID_ON_BRIGHTNESS);
-
-                        if (CUSTOM_MARQUEE_SEQUENCE_LENGTH > 0 && strike_marqueeLength == 5) { // Original condition
-                            for (int i = 0; i < strike_marqueeLength; ++i) {
-                                int offset = i - (strike_marqueeLength / 2);
-                                int sequence_idx_to_light = (strike_marqueePos + offset + CUSTOM_MARQUEE_SEQUENCE_LENGTH) % CUSTOM_MARQUEE_SEQUENCE_LENGTH;
-                                uint8_t led_pin_idx_in_LIGHT_PINS = custom_marquee_sequence[sequence_idx_to_light];
-                                driveLED(led_pin_idx_in_LIGHT_PINS, MARQUEE_BRIGHTNESS);
-                            }
-                        }
-                        strike_marqueePos = (strike_marqueePos + 1) % CUSTOM_MARQUEE_SEQUENCE_LENGTH;
-                    }
-
-                    // Sparkle logic (increasing density)
-                    if (phaseElapsedTime >= STRIKE_PHASE1_SPARKLE_START_OFFSET) {
-                        if (now - strike_lastSparkleTime >= SPARKLE_INTERVAL_MS) {
-                            strike_lastSparkleTime = now;
-                            uint8_t numSparklesThisHit = 0;
-                            if (STRIKE_PHASE1_SPARKLE_RAMP_DURATION > 0) {
-                                uint32_t timeIntoSparkleRamp = phaseElapsedTime - STRIKE_PHASE1_SPARKLE_START_OFFSET;
-                                numSparklesThisHit = (SPARKLE_MAX_DENSITY_VAL * timeIntoSparkleRamp) / STRIKE_PHASE1_SPARKLE_RAMP_DURATION;
-                            }
-                            if (numSparklesThisHit > SPARKLE_MAX_DENSITY_VAL) numSparklesThisHit = SPARKLE_MAX_DENSITY_VAL;
-
-                            if (numSparklesThisHit > 0) {
-                                for (uint8_t i = 0; i < numSparklesThisHit; ++i) {
-                                    driveLED(rand() % LIGHT_PIN_COUNT, 255);
-                                }
-                            }
-                        }
-                    }
-
-                    if (phaseElapsedTime >= STRIKE_PHASE1_DURATION) {
-                        strike_phase = 2; // Transition to fade out
-                        strike_phaseStartTime = now; // Reset phase timer
-                        strike_lastSparkleTime = now; // Reset sparkle timer for fade phase
-                    }
-                    break;
-                }
-                case 2: // Fade out phase (decreasing sparkle)
-                {
-                    if (now - strike_lastSparkleTime >= SPARKLE_INTERVAL_MS) {
-                        strike_lastSparkleTime = now;
-                        clearAllLEDs();
-                        __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, EYE_SOLID_ON_BRIGHTNESS);
-
-                        uint8_t numSparklesThisHit = 0;
-                        if (phaseElapsedTime < STRIKE_PHASE2_FADE_DURATION) {
-                            uint32_t timeIntoFade = phaseElapsedTime;
-                            numSparklesThisHit = (SPARKLE_MAX_DENSITY_VAL * (STRIKE_PHASE2_FADE_DURATION - timeIntoFade)) / STRIKE_PHASE2_FADE_DURATION;
-                            if (numSparklesThisHit > SPARKLE_MAX_DENSITY_VAL) numSparklesThisHit = SPARKLE_MAX_DENSITY_VAL;
-                        } else {
-                            numSparklesThisHit = 0;
-                        }
-
-                        if (numSparklesThisHit > 0) {
-                            for (uint8_t i = 0; i < numSparklesThisHit; ++i) {
-                                driveLED(rand() % LIGHT_PIN_COUNT, 255);
-                            }
-                        }
-                    }
-
-                    if (phaseElapsedTime >= STRIKE_PHASE2_FADE_DURATION) {
-                        if (now - strike_lastSparkleTime > SPARKLE_INTERVAL_MS) { // Ensure one last clear after sparkles stop
-                           clearAllLEDs();
-                           __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, EYE_SOLID_ON_BRIGHTNESS); // Keep eye on
-                        }
-                        burstActive = false; // End of burst
-                        lastBurstTriggerTime = now; // For STRIKE_RESTART_DELAY_MS
-                    }
-                    break;
-                }
-            }
+    // (Re)start on an effect change, or when STRIKE is re-armed by the shell/touch
+    // (burstActive set) while its program is resting between bursts.
+    bool strike_rearmed = (effect == EFFECT_STRIKE && burstActive && !fx_burst_active());
+    if (effect != fx_loaded_effect || strike_rearmed) {
+        if (effect == EFFECT_OFF && led_ultra_idle) {
+            fx_start(&fx_ultra_idle, now);
+        } else if ((unsigned)effect < FX_EFFECT_COUNT) {
+            fx_start(&fx_effects[effect], now);
+        } else {
+            fx_start(&fx_effects[EFFECT_OFF], now);
         }
+        fx_loaded_effect = effect;
     }
-    else if (effect == EFFECT_OFF) {
-        if (burstActive) burstActive = false; // Ensure strike is off
-
-        // Turn off all light bar LEDs
-        for(uint8_t i=0; i < LIGHT_PIN_COUNT; ++i) {
-            // Assuming EYE_LED is not part of LIGHT_PINS or handled by its index if it is.
-            // Original code had a check: if(LIGHT_PINS[i].port != EYE_LED_PORT || LIGHT_PINS[i].pin != EYE_LED_PIN)
-            // This implies eye LED might be in LIGHT_PINS. For simplicity, clearAllLEDs() handles this.
-            // Here, we just ensure light bar is off. Eye is handled by pulse.
-            driveLED(i,0);
-        }
 
-        // Eye pulse logic for EFFECT_OFF
-        if (eye_pulse_sub_phase == 0) { // Solid ON, waiting for pulse interval
-            __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, EYE_SOLID_ON_BRIGHTNESS);
-            if (now - last_eye_pulse_trigger_time >= EYE_PULSE_INTERVAL_MS) {
-                eye_pulse_sub_phase = 1; // Start pulse: Dim
-                eye_pulse_sub_phase_start_time = now;
-                __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, EYE_PULSE_DIM_BRIGHTNESS);
-            }
-        } else if (eye_pulse_sub_phase == 1) { // Dim phase
-            if (now - eye_pulse_sub_phase_start_time >= EYE_PULSE_DIM_DURATION_MS) {
-                __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, EYE_PULSE_PEAK_BRIGHTNESS);
-                eye_pulse_sub_phase = 2; // Peak phase
-                eye_pulse_sub_phase_start_time = now;
-            }
-        } else if (eye_pulse_sub_phase == 2) { // Peak phase
-            if (now - eye_pulse_sub_phase_start_time >= EYE_PULSE_PEAK_DURATION_MS) {
-                 __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, EYE_SOLID_ON_BRIGHTNESS); // Return to solid (dimmer than peak, brighter than dim)
-                eye_pulse_sub_phase = 3; // Return phase
-                eye_pulse_sub_phase_start_time = now;
-            }
-        } else if (eye_pulse_sub_phase == 3) { // Return to solid phase
-             if (now - eye_pulse_sub_phase_start_time >= EYE_PULSE_RETURN_DURATION_MS) {
-                __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, EYE_SOLID_ON_BRIGHTNESS); // Ensure solid
-                eye_pulse_sub_phase = 0; // Wait for next interval
-                last_eye_pulse_trigger_time = now; // Reset interval timer
-            }
-        }
+    fx_run(now);
+
+    for (uint8_t pos = 0; pos < CUSTOM_MARQUEE_SEQUENCE_LENGTH; ++pos) {
+        driveLED(custom_marquee_sequence[pos], fx_get_bar_level(pos));
     }
-    else { // Other Bling Effects (formerly updateBlingEffects())
-        if (burstActive) burstActive = false; // Ensure strike is off
-
-        static uint32_t t0_effects_bling = 0; // Renamed from original updateBlingEffects t0_effects
-        switch (effect) {
-            case EFFECT_CRACKLE: {
-              static uint32_t t0_crackle = 0;
-              __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, EYE_SOLID_ON_BRIGHTNESS);
-
-              if (now - t0_crackle > 20) { // Original interval
-                t0_crackle = now;
-                for (uint8_t i = 0; i < LIGHT_PIN_COUNT; ++i) { driveLED(i, 0); } // Clear light bar
-                for (uint8_t i = 0; i < 4; ++i) { // Sparkle 4 LEDs
-                    driveLED(rand() % LIGHT_PIN_COUNT, 255);
-                }
-              }
-              break;
-            }
-            case EFFECT_BREATHE: {
-              static int16_t breathe_level = 0; static int8_t breathe_dir_fx = 5; // Original params
-              if (now - t0_effects_bling > 15) { // Original interval
-                t0_effects_bling = now; breathe_level += breathe_dir_fx;
-                if (breathe_level >= 255) { breathe_level = 255; breathe_dir_fx = -breathe_dir_fx; }
-                if (breathe_level <=   0) { breathe_level =   0; breathe_dir_fx = -breathe_dir_fx; }
-                for (uint8_t p_idx = 0; p_idx < LIGHT_PIN_COUNT; ++p_idx) { driveLED(p_idx, (uint8_t)breathe_level); }
-                // Eye is handled by generic eye animation
-              } break;
-            }
-            case EFFECT_ALL_ON: {
-              for (uint8_t p_idx = 0; p_idx < LIGHT_PIN_COUNT; ++p_idx) { driveLED(p_idx, 255); }
-              __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, 255); // Eye full on
-              break;
-            }
-            case EFFECT_SCANNER: {
-              static int8_t scanner_pos = 0; static int8_t scanner_dir = 1;
-              static uint32_t t0_scanner = 0;
-              const uint32_t SCANNER_SPEED_MS = 75; const uint8_t SCANNER_BRIGHTNESS = 255;
-              const int8_t SCANNER_WIDTH = 2;
-
-              __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, EYE_SOLID_ON_BRIGHTNESS); // Eye solid on
-
-              if (now - t0_scanner >= SCANNER_SPEED_MS) {
-                t0_scanner = now;
-                for (uint8_t i = 0; i < LIGHT_PIN_COUNT; ++i) { driveLED(i, 0); } // Clear light bar
-
-                for (int8_t i = 0; i < SCANNER_WIDTH; ++i) {
-                  int8_t current_led_idx_in_sequence = scanner_pos + i;
-                  if (current_led_idx_in_sequence >= 0 && current_led_idx_in_sequence < CUSTOM_MARQUEE_SEQUENCE_LENGTH) {
-                    driveLED(custom_marquee_sequence[current_led_idx_in_sequence], SCANNER_BRIGHTNESS);
-                  }
-                }
-                scanner_pos += scanner_dir;
-                if (scanner_dir == 1 && scanner_pos >= (CUSTOM_MARQUEE_SEQUENCE_LENGTH - SCANNER_WIDTH + 1)) {
-                  scanner_pos = CUSTOM_MARQUEE_SEQUENCE_LENGTH - SCANNER_WIDTH; scanner_dir = -1;
-                } else if (scanner_dir == -1 && scanner_pos < 0) {
-                  scanner_pos = 0; scanner_dir = 1;
-                }
-              }
-              break;
-            }
-            case EFFECT_CONVERGE_DIVERGE: {
-                static enum { CONVERGE_INTERNAL_INIT, CONVERGE_INTERNAL_CONVERGING, CONVERGE_INTERNAL_PULSING } internal_phase_cd = CONVERGE_INTERNAL_INIT;
-                static int8_t converge_p1, converge_p2;
-                static int8_t pulse_current_led_idx_cd; static int16_t pulse_current_brightness_cd; static int8_t pulse_brightness_dir_cd;
-                static uint32_t last_converge_step_time_cd = 0, last_pulse_sweep_time_cd = 0, last_pulse_glow_time_cd = 0;
-
-                const uint32_t CONVERGE_ANIM_SPEED_MS = 180; const uint8_t CONVERGE_LED_BRIGHTNESS = 220;
-                const uint32_t PULSE_ANIM_SWEEP_SPEED_MS = 50; const uint32_t PULSE_ANIM_GLOW_SPEED_MS = 50;
-                const int16_t PULSE_ANIM_BRIGHTNESS_STEP = 1; const int16_t PULSE_ANIM_MAX_BRIGHTNESS = 255;
-                const int16_t PULSE_ANIM_MIN_BRIGHTNESS = 20; const uint8_t PULSE_ANIM_BACKGROUND_BRIGHTNESS = 50;
-                const uint8_t PULSE_GRADIENT_LENGTH = 3;
-                const uint8_t PULSE_TAIL1_BRIGHTNESS_NUM = 3, PULSE_TAIL1_BRIGHTNESS_DEN = 5;
-                const uint8_t PULSE_TAIL2_BRIGHTNESS_NUM = 3, PULSE_TAIL2_BRIGHTNESS_DEN = 10;
-                const uint16_t TRANSITION_SCALE = 255;
-
-                static AppEffect_t effect_last_tick_converge_cd = (AppEffect_t)-1;
-                if (effect != effect_last_tick_converge_cd) {
-                    if (effect == EFFECT_CONVERGE_DIVERGE) { internal_phase_cd = CONVERGE_INTERNAL_INIT; }
-                    effect_last_tick_converge_cd = effect;
-                }
-
-                if (internal_phase_cd == CONVERGE_INTERNAL_INIT) {
-                    converge_p1 = 0; converge_p2 = CUSTOM_MARQUEE_SEQUENCE_LENGTH - 1;
-                    pulse_current_led_idx_cd = 0; pulse_current_brightness_cd = PULSE_ANIM_MIN_BRIGHTNESS; pulse_brightness_dir_cd = 1;
-                    for (uint8_t i = 0; i < CUSTOM_MARQUEE_SEQUENCE_LENGTH; ++i) { driveLED(custom_marquee_sequence[i], PULSE_ANIM_BACKGROUND_BRIGHTNESS); }
-                    internal_phase_cd = CONVERGE_INTERNAL_CONVERGING;
-                    uint32_t current_time_init = HAL_GetTick();
-                    last_converge_step_time_cd = current_time_init; last_pulse_sweep_time_cd = current_time_init; last_pulse_glow_time_cd = current_time_init;
-                }
-
-                __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, EYE_SOLID_ON_BRIGHTNESS);
-
-                if (internal_phase_cd == CONVERGE_INTERNAL_CONVERGING) {
-                    if (now - last_converge_step_time_cd >= CONVERGE_ANIM_SPEED_MS) {
-                        last_converge_step_time_cd = now;
-                        for (uint8_t i = 0; i < CUSTOM_MARQUEE_SEQUENCE_LENGTH; ++i) { driveLED(custom_marquee_sequence[i], PULSE_ANIM_BACKGROUND_BRIGHTNESS); }
-                        if (converge_p1 >= 0 && converge_p1 < CUSTOM_MARQUEE_SEQUENCE_LENGTH) { driveLED(custom_marquee_sequence[converge_p1], CONVERGE_LED_BRIGHTNESS); }
-                        if (converge_p2 >= 0 && converge_p2 < CUSTOM_MARQUEE_SEQUENCE_LENGTH && converge_p1 != converge_p2) { driveLED(custom_marquee_sequence[converge_p2], CONVERGE_LED_BRIGHTNESS); }
-                        converge_p1++; converge_p2--;
-                        if (converge_p1 >= converge_p2) {
-                            internal_phase_cd = CONVERGE_INTERNAL_PULSING;
-                            pulse_current_led_idx_cd = 0; pulse_current_brightness_cd = PULSE_ANIM_MIN_BRIGHTNESS; pulse_brightness_dir_cd = 1;
-                            last_pulse_sweep_time_cd = now; last_pulse_glow_time_cd = now;
-                        }
-                    }
-                } else if (internal_phase_cd == CONVERGE_INTERNAL_PULSING) {
-                    // bool needs_redraw_cd = false; // Removed unused variable
-                    if (now - last_pulse_glow_time_cd >= PULSE_ANIM_GLOW_SPEED_MS) {
-                        last_pulse_glow_time_cd = now; // needs_redraw_cd was true here
-                        pulse_current_brightness_cd += (pulse_brightness_dir_cd * PULSE_ANIM_BRIGHTNESS_STEP);
-                        if (pulse_current_brightness_cd >= PULSE_ANIM_MAX_BRIGHTNESS) { pulse_current_brightness_cd = PULSE_ANIM_MAX_BRIGHTNESS; pulse_brightness_dir_cd = -1; }
-                        else if (pulse_current_brightness_cd <= PULSE_ANIM_MIN_BRIGHTNESS) { pulse_current_brightness_cd = PULSE_ANIM_MIN_BRIGHTNESS; pulse_brightness_dir_cd = 1; }
-                    }
-                    uint16_t transition_progress_scaled_cd = 0;
-                    if (now - last_pulse_sweep_time_cd >= PULSE_ANIM_SWEEP_SPEED_MS) {
-                        // This means a full step in sweep has occurred or is due
-                        transition_progress_scaled_cd = TRANSITION_SCALE; // At the target
-                    } else {
-                        transition_progress_scaled_cd = (uint16_t)(((now - last_pulse_sweep_time_cd) * TRANSITION_SCALE) / PULSE_ANIM_SWEEP_SPEED_MS);
-                    }
-                     if (transition_progress_scaled_cd > TRANSITION_SCALE) transition_progress_scaled_cd = TRANSITION_SCALE;
-
-
-                    uint8_t led_brightness_map_cd[CUSTOM_MARQUEE_SEQUENCE_LENGTH];
-                    for (uint8_t i = 0; i < CUSTOM_MARQUEE_SEQUENCE_LENGTH; ++i) { led_brightness_map_cd[i] = PULSE_ANIM_BACKGROUND_BRIGHTNESS; }
-                    
-                    uint8_t head_pulse_comp_brightness_cd = (pulse_current_brightness_cd < PULSE_ANIM_MIN_BRIGHTNESS) ? PULSE_ANIM_MIN_BRIGHTNESS : ((pulse_current_brightness_cd > PULSE_ANIM_MAX_BRIGHTNESS) ? PULSE_ANIM_MAX_BRIGHTNESS : (uint8_t)pulse_current_brightness_cd);
-
-                    uint16_t outgoing_intensity_scaled_cd = TRANSITION_SCALE - transition_progress_scaled_cd;
-                    for (uint8_t i = 0; i < PULSE_GRADIENT_LENGTH; ++i) {
-                        int8_t led_map_idx = (pulse_current_led_idx_cd - i + CUSTOM_MARQUEE_SEQUENCE_LENGTH) % CUSTOM_MARQUEE_SEQUENCE_LENGTH;
-                        uint32_t scaled_brightness = (uint32_t)head_pulse_comp_brightness_cd * outgoing_intensity_scaled_cd;
-                        if (i == 1) { scaled_brightness = (scaled_brightness * PULSE_TAIL1_BRIGHTNESS_NUM) / PULSE_TAIL1_BRIGHTNESS_DEN; }
-                        else if (i == 2) { scaled_brightness = (scaled_brightness * PULSE_TAIL2_BRIGHTNESS_NUM) / PULSE_TAIL2_BRIGHTNESS_DEN; }
-                        uint8_t out_seg_brightness = (uint8_t)(scaled_brightness / TRANSITION_SCALE);
-                        if (out_seg_brightness > led_brightness_map_cd[led_map_idx]) led_brightness_map_cd[led_map_idx] = out_seg_brightness;
-                    }
-
-                    uint16_t incoming_intensity_scaled_cd = transition_progress_scaled_cd;
-                    int8_t next_led_base_idx_cd = (pulse_current_led_idx_cd + 1) % CUSTOM_MARQUEE_SEQUENCE_LENGTH;
-                    for (uint8_t i = 0; i < PULSE_GRADIENT_LENGTH; ++i) {
-                        int8_t led_map_idx = (next_led_base_idx_cd - i + CUSTOM_MARQUEE_SEQUENCE_LENGTH) % CUSTOM_MARQUEE_SEQUENCE_LENGTH;
-                        uint32_t scaled_brightness = (uint32_t)head_pulse_comp_brightness_cd * incoming_intensity_scaled_cd;
-                        if (i == 1) { scaled_brightness = (scaled_brightness * PULSE_TAIL1_BRIGHTNESS_NUM) / PULSE_TAIL1_BRIGHTNESS_DEN; }
-                        else if (i == 2) { scaled_brightness = (scaled_brightness * PULSE_TAIL2_BRIGHTNESS_NUM) / PULSE_TAIL2_BRIGHTNESS_DEN; }
-                        uint8_t in_seg_brightness = (uint8_t)(scaled_brightness / TRANSITION_SCALE);
-                        if (in_seg_brightness > led_brightness_map_cd[led_map_idx]) led_brightness_map_cd[led_map_idx] = in_seg_brightness;
-                    }
-
-                    for (uint8_t i = 0; i < CUSTOM_MARQUEE_SEQUENCE_LENGTH; ++i) {
-                        uint8_t final_brightness = led_brightness_map_cd[i];
-                        if (final_brightness < PULSE_ANIM_BACKGROUND_BRIGHTNESS) final_brightness = PULSE_ANIM_BACKGROUND_BRIGHTNESS;
-                        driveLED(custom_marquee_sequence[i], final_brightness);
-                    }
-
-                    if (now - last_pulse_sweep_time_cd >= PULSE_ANIM_SWEEP_SPEED_MS) { // Transition complete
-                        last_pulse_sweep_time_cd = now;
-                        pulse_current_led_idx_cd = (pulse_current_led_idx_cd + 1) % CUSTOM_MARQUEE_SEQUENCE_LENGTH;
-                        // needs_redraw_cd = true; // This was the only other place it was set
-                    }
-                }
-              break;
-            }
-            case EFFECT_STRIKE: // Should be handled by the primary if/else
-            case EFFECT_OFF:    // Should be handled by the primary if/else
-            default: break; // No other bling effects defined in original updateBlingEffects
-        }
+    driveEye(fx_get_level(FX_CH_EYE_IDX));
+
+    flushLEDs(); // Single write-out of this frame
+}
+
+// When update_led_visuals() next has something to change (absolute HAL tick).
+uint32_t led_visuals_next_deadline(uint32_t now, uint32_t idle) {
+    if (effect != fx_loaded_effect) return now; // Effect switched outside update_led_visuals
+    return fx_next_deadline(now, idle);
+}
+
+// Longest span any effect program waits between two frames it changes
+uint16_t led_longest_op_ms(void) {
+    uint16_t longest = fx_longest_op_ms(&fx_ultra_idle);
+    for (uint8_t i = 0; i < FX_EFFECT_COUNT; ++i) {
+        uint16_t ms = fx_longest_op_ms(&fx_effects[i]);
+        if (ms > longest) longest = ms;
     }
+    return longest;
+}
+
+void set_led_ultra_idle(bool on) {
+    led_ultra_idle = on;
+    fx_loaded_effect = (AppEffect_t)-1; // Restart the effect with the other eye program
+}
+
+bool get_led_ultra_idle(void) {
+    return led_ultra_idle;
+}
+
+bool led_ultra_idle_active(void) {
+    return led_ultra_idle && effect == EFFECT_OFF;
 }
 
 void cycle_effect(void) {
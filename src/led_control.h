@@ -40,20 +40,46 @@ extern const uint8_t custom_marquee_sequence[]; // Definition will be in led_con
 #define EYE_PULSE_PEAK_DURATION_MS 150
 #define EYE_PULSE_RETURN_DURATION_MS 100
 
+// Ultra-idle: EFFECT_OFF shows a double-beat heartbeat at full brightness
+// instead of the dimmed eye, so no PWM runs and the MCU stops between edges.
+#ifndef LED_ULTRA_IDLE_DEFAULT
+#define LED_ULTRA_IDLE_DEFAULT 1 // Build with -D LED_ULTRA_IDLE_DEFAULT=0 for the classic pulse
+#endif
+#define EYE_HEARTBEAT_INTERVAL_MS 3000UL // Dark time between double beats
+#define EYE_HEARTBEAT_BEAT_MS 60
+#define EYE_HEARTBEAT_GAP_MS 140
+#define LED_HW_LATCH_MS 2 // Hardware PWM period (~1 ms) plus margin: new compares are applied
+
 // Strike Effect Timing Constants (can be moved to led_control.c)
 #define STRIKE_RESTART_DELAY_MS 10000UL
 #define STRIKE_PHASE1_DURATION 5000UL
 #define STRIKE_PHASE1_SPARKLE_START_OFFSET 2500UL
 #define STRIKE_PHASE1_SPARKLE_RAMP_DURATION (STRIKE_PHASE1_DURATION - STRIKE_PHASE1_SPARKLE_START_OFFSET)
 #define STRIKE_PHASE2_FADE_DURATION 3500UL
+#define STRIKE_SPARKLE_MAX_DENSITY 4 // Sparkles per 30 ms hit at the peak of the ramp
+
+// Brightness framebuffer: one entry per light bar LED, plus the eye in the last slot.
+#define LED_FB_EYE_IDX LIGHT_PIN_COUNT
+#define LED_FB_SIZE    (LIGHT_PIN_COUNT + 1)
 
 /* Function Prototypes */
+// driveLED/driveEye/clearAllLEDs only write the framebuffer; nothing reaches the
+// pins until flushLEDs(), which update_led_visuals() calls once per frame.
 void driveLED(uint8_t led_idx, uint8_t val);
+void driveEye(uint8_t val);
 void clearAllLEDs(void);
+void flushLEDs(void); // Writes only the channels that changed since the last flush
+bool leds_static(void); // Every LED fully on or off as last flushed (no PWM needs the clocks)
 const char* getEffectName(AppEffect_t current_effect_val);
 void update_led_visuals(uint32_t now); // Main function to update current effect
+uint32_t led_visuals_next_deadline(uint32_t now, uint32_t idle); // Next frame due, or 'idle' if static
+uint16_t led_longest_op_ms(void); // Over every effect program: bounds the wait between animated frames
 void init_led_effects(void); // Optional: For one-time initializations if needed
 
+void set_led_ultra_idle(bool on);
+bool get_led_ultra_idle(void);
+bool led_ultra_idle_active(void); // Ultra-idle on and EFFECT_OFF playing
+
 // Functions to manage effect state changes (called by shell or touch input)
 void cycle_effect(void);
 void set_effect(AppEffect_t new_effect);
@@ -0,0 +1,435 @@
+#include "led_fx.h"
+#include "led_control.h" // For burstActive (mirrored by FX_OP_BURST), EYE_SOLID_ON_BRIGHTNESS (Morse overlay)
+#include "fixed_math.h"  // Divide-free scaling for the comet kernel
+#include "utils.h"       // For cycle_stamp / cycles_since (bench_led_render), deadline_earliest, MORSE_TABLE_C, Morse timing
+#include <stdlib.h>      // For rand()
+
+// Comet (CONVERGE_DIVERGE pulse) shape
+#define FX_COMET_GRADIENT_LENGTH 3
+#define FX_COMET_TAIL1_NUM 3
+#define FX_COMET_TAIL1_DEN 5
+#define FX_COMET_TAIL2_NUM 3
+#define FX_COMET_TAIL2_DEN 10
+
+// A main loop stall longer than this (e.g. a shell command's HAL_Delay) pauses
+// the effect instead of fast-forwarding through everything it missed.
+#define FX_MAX_FRAME_GAP_MS 250U
+#define FX_MAX_OPS_PER_RUN  32 // Bounds instant ops (SET/JUMP loops) per frame
+#define FX_COMET_FRAME_MS   20  // The comet interpolates between steps, so it wants frames at 50 Hz
+
+typedef struct {
+    const FxOp_t* prog;
+    uint8_t  pc;
+    bool     entered;   // Current op has been set up
+    uint16_t count;     // Ticks done (ROTATE) or comet head position
+    uint32_t op_start;  // When the current op was due to start
+    uint32_t next_tick; // Next interval tick for RAMP/ROTATE/SPARKLE/COMET
+    uint32_t aux;       // COMET: Q16 reciprocal of the interval (255 per step)
+} FxTrack_t;
+
+typedef struct {
+    uint8_t  codes[FX_MORSE_MAX_CHARS]; // Packed characters still to send
+    uint8_t  count;
+    uint8_t  pos;      // Character being sent
+    uint8_t  element;  // Element of that character
+    bool     lit;      // Inside an element (else a gap)
+    bool     active;
+    bool     all_leds; // false: eye only
+    uint32_t next;     // When the current span ends
+} FxMorse_t;
+
+// Packs a Morse pattern literal into its code byte; folded by the compiler.
+#define MORSE_DASH(p, i) ((sizeof(p) > (i) + 1U && (p)[i] == '-') ? (1U << (i)) : 0U)
+#define MORSE_PACK(p) (uint8_t)(((sizeof(p) - 1U) << 5) | MORSE_DASH(p, 0) | MORSE_DASH(p, 1) | \
+                                MORSE_DASH(p, 2) | MORSE_DASH(p, 3) | MORSE_DASH(p, 4))
+#define MORSE_PACK_ENTRY(p) MORSE_PACK(p),
+static const uint8_t fx_morse_table[] = { MORSE_TABLE_C(MORSE_PACK_ENTRY) };
+_Static_assert(sizeof(fx_morse_table) == 36, "Morse table must cover A-Z and 0-9");
+
+static FxTrack_t fx_tracks[FX_NUM_TRACKS];
+static FxMorse_t fx_morse;
+static uint8_t fx_levels[FX_NUM_CHANNELS];
+static uint8_t fx_overlay[FX_NUM_BAR]; // Sparkles, max-composited over the bar
+static bool fx_burst = false;
+static uint32_t fx_last_run = 0;
+
+// CONVERGE_DIVERGE pulse: head at 'head_idx' sliding to the next LED
+// ('progress' 0..255), with two dimmer tail segments, over a dim background.
+// 'map' is indexed by position in the sweep order.
+static void compose_converge_pulse(uint8_t* map, uint8_t head_idx, uint8_t head_brightness, uint8_t progress, uint8_t bg) {
+    for (uint8_t i = 0; i < FX_NUM_BAR; ++i) { map[i] = bg; }
+
+    uint8_t seg_intensity[2] = { (uint8_t)(255 - progress), progress }; // Outgoing, incoming
+    uint8_t seg_base[2] = { head_idx, fx_wrap_index(head_idx + 1, FX_NUM_BAR) };
+    for (uint8_t seg = 0; seg < 2; ++seg) {
+        uint32_t scaled = (uint32_t)head_brightness * seg_intensity[seg]; // Max 255*255
+        for (uint8_t i = 0; i < FX_COMET_GRADIENT_LENGTH; ++i) {
+            uint8_t led_map_idx = fx_wrap_index((int16_t)seg_base[seg] - i, FX_NUM_BAR);
+            uint32_t seg_scaled = scaled;
+            if (i == 1) { seg_scaled = fx_mul_q16(scaled, FX_Q16(FX_COMET_TAIL1_NUM, FX_COMET_TAIL1_DEN)); }
+            else if (i == 2) { seg_scaled = fx_mul_q16(scaled, FX_Q16(FX_COMET_TAIL2_NUM, FX_COMET_TAIL2_DEN)); }
+            uint8_t seg_brightness = (uint8_t)fx_div255(seg_scaled);
+            if (seg_brightness > map[led_map_idx]) map[led_map_idx] = seg_brightness;
+        }
+    }
+}
+
+static void fx_apply_mask(uint16_t mask, uint8_t level) {
+    for (uint8_t ch = 0; ch < FX_NUM_CHANNELS; ++ch) {
+        if (mask & (1U << ch)) fx_levels[ch] = level;
+    }
+}
+
+static void fx_clear_overlay(void) {
+    for (uint8_t i = 0; i < FX_NUM_BAR; ++i) { fx_overlay[i] = 0; }
+}
+
+// Set-up when an op becomes current.
+static void fx_enter(FxTrack_t* t, const FxOp_t* op) {
+    t->count = 0;
+    t->next_tick = t->op_start + op->ms;
+    switch (op->op) {
+        case FX_OP_SHOW:
+            for (uint8_t i = 0; i < FX_NUM_BAR; ++i) {
+                fx_levels[i] = (op->mask & FX_BAR(i)) ? op->level : (uint8_t)op->arg;
+            }
+            break;
+        case FX_OP_ROTATE:
+        case FX_OP_SPARKLE:
+            t->next_tick = t->op_start; // First tick right away
+            break;
+        case FX_OP_COMET:
+            t->aux = FX_Q16(255, op->ms ? op->ms : 1); // One division per comet, not per frame
+            break;
+        default:
+            break;
+    }
+}
+
+// Advances the current op to 'now'. Returns true once it has finished, with
+// op_start moved to the time the next op is due.
+static bool fx_step(FxTrack_t* t, const FxOp_t* op, uint32_t now) {
+    switch (op->op) {
+        case FX_OP_SET:
+            fx_apply_mask(op->mask, op->level);
+            return true;
+        case FX_OP_BURST:
+            fx_burst = (op->level != 0);
+            burstActive = fx_burst;
+            return true;
+        case FX_OP_SHOW:
+        case FX_OP_WAIT:
+            if (now - t->op_start < op->ms) return false;
+            t->op_start += op->ms;
+            return true;
+        case FX_OP_RAMP:
+            while ((int32_t)(now - t->next_tick) >= 0) {
+                bool arrived = true;
+                for (uint8_t ch = 0; ch < FX_NUM_CHANNELS; ++ch) {
+                    if (!(op->mask & (1U << ch))) continue;
+                    int16_t lvl = fx_levels[ch];
+                    if (lvl < op->level) { lvl += op->arg; if (lvl > op->level) lvl = op->level; }
+                    else if (lvl > op->level) { lvl -= op->arg; if (lvl < op->level) lvl = op->level; }
+                    fx_levels[ch] = (uint8_t)lvl;
+                    if (lvl != op->level) arrived = false;
+                }
+                if (arrived) {
+                    t->op_start = t->next_tick;
+                    return true;
+                }
+                t->next_tick += op->ms;
+            }
+            return false;
+        case FX_OP_ROTATE:
+            while ((int32_t)(now - t->next_tick) >= 0) {
+                if (t->count >= op->arg) {
+                    t->op_start = t->next_tick;
+                    return true;
+                }
+                uint8_t last = fx_levels[FX_NUM_BAR - 1];
+                for (uint8_t i = FX_NUM_BAR - 1; i > 0; --i) { fx_levels[i] = fx_levels[i - 1]; }
+                fx_levels[0] = last;
+                t->count++;
+                t->next_tick += op->ms;
+            }
+            return false;
+        case FX_OP_SPARKLE:
+            if (op->arg && now - t->op_start >= op->arg) {
+                fx_clear_overlay();
+                t->op_start += op->arg;
+                return true;
+            }
+            while ((int32_t)(now - t->next_tick) >= 0) {
+                fx_clear_overlay();
+                for (uint8_t i = 0; i < op->level; ++i) {
+                    fx_overlay[rand() & (FX_NUM_BAR - 1)] = 255;
+                }
+                t->next_tick += op->ms;
+            }
+            return false;
+        case FX_OP_COMET: {
+            while ((int32_t)(now - t->next_tick) >= 0) {
+                t->count = fx_wrap_index(t->count + 1, FX_NUM_BAR);
+                t->next_tick += op->ms;
+            }
+            uint32_t into_step = now - (t->next_tick - op->ms);
+            uint32_t progress = fx_mul_q16(into_step, t->aux);
+            if (progress > 255) progress = 255;
+            compose_converge_pulse(fx_levels, (uint8_t)t->count, fx_levels[FX_CH_REG_IDX], (uint8_t)progress, op->level);
+            return false;
+        }
+        case FX_OP_JUMP:
+            return true;
+        case FX_OP_END:
+        default:
+            return false;
+    }
+}
+
+static void fx_run_track(FxTrack_t* t, uint32_t now) {
+    for (uint8_t n = 0; n < FX_MAX_OPS_PER_RUN; ++n) {
+        const FxOp_t* op = &t->prog[t->pc];
+        if (!t->entered) {
+            fx_enter(t, op);
+            t->entered = true;
+        }
+        if (!fx_step(t, op, now)) return;
+        t->pc = (op->op == FX_OP_JUMP) ? (uint8_t)op->arg : (uint8_t)(t->pc + 1);
+        t->entered = false;
+    }
+}
+
+void fx_start(const FxEffect_t* fx, uint32_t now) {
+    for (uint8_t ch = 0; ch < FX_NUM_CHANNELS; ++ch) { fx_levels[ch] = 0; }
+    fx_clear_overlay();
+    fx_burst = false;
+    for (uint8_t i = 0; i < FX_NUM_TRACKS; ++i) {
+        fx_tracks[i].prog = fx->track[i];
+        fx_tracks[i].pc = 0;
+        fx_tracks[i].entered = false;
+        fx_tracks[i].op_start = now;
+        fx_tracks[i].next_tick = now; // Not the previous effect's: set again on entry
+    }
+    fx_last_run = now;
+}
+
+// Word spaces at 'pos' stretch the letter gap already scheduled to a word gap.
+static void fx_morse_skip_spaces(FxMorse_t* m) {
+    while (m->pos < m->count && m->codes[m->pos] == 0U) {
+        m->next += WORD_GAP_MS - LETTER_GAP_MS;
+        m->pos++;
+    }
+}
+
+static void fx_morse_run(FxMorse_t* m, uint32_t now) {
+    while (m->active && (int32_t)(now - m->next) >= 0) {
+        if (m->lit) {
+            m->lit = false;
+            if (++m->element < (m->codes[m->pos] >> 5)) {
+                m->next += SYMBOL_GAP_MS;
+            } else {
+                m->element = 0;
+                m->pos++;
+                m->next += LETTER_GAP_MS;
+                fx_morse_skip_spaces(m);
+            }
+        } else if (m->pos >= m->count) {
+            m->active = false; // Final letter gap over
+        } else {
+            m->lit = true;
+            m->next += ((m->codes[m->pos] >> m->element) & 1U) ? DASH_MS : DOT_MS;
+        }
+    }
+}
+
+void fx_morse_start(const char* text, bool all_leds, uint32_t now) {
+    FxMorse_t* m = &fx_morse;
+    m->count = 0;
+    for (; *text != '\0' && m->count < FX_MORSE_MAX_CHARS; ++text) {
+        char c = *text;
+        if (c >= 'a' && c <= 'z') c = (char)(c - 'a' + 'A');
+        if (c == ' ') m->codes[m->count++] = 0;
+        else if (c >= 'A' && c <= 'Z') m->codes[m->count++] = fx_morse_table[c - 'A'];
+        else if (c >= '0' && c <= '9') m->codes[m->count++] = fx_morse_table[c - '0' + 26];
+        // Anything else is skipped
+    }
+    m->pos = 0;
+    m->element = 0;
+    m->lit = false;
+    m->all_leds = all_leds;
+    m->next = now + FX_MORSE_LEAD_IN_MS;
+    fx_morse_skip_spaces(m);
+    m->active = true;
+}
+
+void fx_morse_cancel(void) {
+    fx_morse.active = false;
+}
+
+bool fx_morse_active(void) {
+    return fx_morse.active;
+}
+
+void fx_run(uint32_t now) {
+    // A stall is lateness past the earliest deadline, not time since the last
+    // run: the tickless main loop sleeps straight through long holds.
+    uint32_t due = fx_next_deadline(fx_last_run, now);
+    uint32_t gap = ((int32_t)(now - due) > 0) ? now - due : 0U;
+    fx_last_run = now;
+    if (fx_morse.active) {
+        if (gap > FX_MAX_FRAME_GAP_MS) fx_morse.next += gap; // Pause rather than drop elements
+        fx_morse_run(&fx_morse, now);
+    }
+    for (uint8_t i = 0; i < FX_NUM_TRACKS; ++i) {
+        FxTrack_t* t = &fx_tracks[i];
+        if (t->prog == NULL) continue;
+        if (gap > FX_MAX_FRAME_GAP_MS) {
+            t->op_start += gap; // Resume where the stall interrupted us
+            t->next_tick += gap;
+        }
+        fx_run_track(t, now);
+    }
+}
+
+// Earliest time any track needs fx_run() again; 'idle' when every track has ended.
+uint32_t fx_next_deadline(uint32_t now, uint32_t idle) {
+    uint32_t deadline = fx_morse.active ? deadline_earliest(now, idle, fx_morse.next) : idle;
+    for (uint8_t i = 0; i < FX_NUM_TRACKS; ++i) {
+        const FxTrack_t* t = &fx_tracks[i];
+        if (t->prog == NULL) continue;
+        const FxOp_t* op = &t->prog[t->pc];
+        uint32_t due;
+        if (!t->entered) { // Its timing state is set on entry, which is due once it is current
+            deadline = deadline_earliest(now, deadline, t->op_start);
+            continue;
+        }
+        switch (op->op) {
+            case FX_OP_END:
+                continue;
+            case FX_OP_SHOW:
+            case FX_OP_WAIT:
+                due = t->op_start + op->ms;
+                break;
+            case FX_OP_RAMP:
+            case FX_OP_ROTATE:
+                due = t->next_tick;
+                break;
+            case FX_OP_SPARKLE:
+                due = t->next_tick;
+                if (op->arg) due = deadline_earliest(now, due, t->op_start + op->arg);
+                break;
+            case FX_OP_COMET:
+                due = deadline_earliest(now, t->next_tick, now + FX_COMET_FRAME_MS);
+                break;
+            default:
+                due = now; // Instant op left over (FX_MAX_OPS_PER_RUN hit): run again right away
+                break;
+        }
+        deadline = deadline_earliest(now, deadline, due);
+    }
+    return deadline;
+}
+
+// Programs end in FX_OP_END or a FX_OP_JUMP back, so each track is one pass.
+uint16_t fx_longest_op_ms(const FxEffect_t* fx) {
+    uint16_t longest = 0;
+    for (uint8_t i = 0; i < FX_NUM_TRACKS; ++i) {
+        const FxOp_t* op = fx->track[i];
+        if (op == NULL) continue;
+        for (;; ++op) {
+            if (op->ms > longest) longest = op->ms;
+            if (op->op == FX_OP_END || op->op == FX_OP_JUMP) break;
+        }
+    }
+    return longest;
+}
+
+uint8_t fx_get_level(uint8_t channel) {
+    if (channel >= FX_NUM_CHANNELS) return 0;
+    if (fx_morse.active && channel == FX_CH_EYE_IDX) return fx_morse.lit ? EYE_SOLID_ON_BRIGHTNESS : 0;
+    if (fx_morse.active && channel < FX_NUM_BAR) return (fx_morse.lit && fx_morse.all_leds) ? 255 : 0;
+    return fx_levels[channel];
+}
+
+uint8_t fx_get_bar_level(uint8_t pos) {
+    if (pos >= FX_NUM_BAR) return 0;
+    if (fx_morse.active) return (fx_morse.lit && fx_morse.all_leds) ? 255 : 0;
+    return (fx_overlay[pos] > fx_levels[pos]) ? fx_overlay[pos] : fx_levels[pos];
+}
+
+bool fx_burst_active(void) {
+    return fx_burst;
+}
+
+// The original divide/modulo CONVERGE_DIVERGE pulse code, kept only as the
+// baseline for bench_led_render() (50 ms sweep, background 50).
+#define LEGACY_SWEEP_SPEED_MS 50UL
+#define LEGACY_BACKGROUND_BRIGHTNESS 50
+#define LEGACY_TRANSITION_SCALE 255U
+static void compose_converge_pulse_legacy(uint8_t* map, uint8_t head_idx, uint8_t head_brightness, uint32_t sweep_elapsed_ms) {
+    uint16_t transition_progress_scaled_cd = 0;
+    if (sweep_elapsed_ms >= LEGACY_SWEEP_SPEED_MS) {
+        transition_progress_scaled_cd = LEGACY_TRANSITION_SCALE;
+    } else {
+        transition_progress_scaled_cd = (uint16_t)((sweep_elapsed_ms * LEGACY_TRANSITION_SCALE) / LEGACY_SWEEP_SPEED_MS);
+    }
+
+    for (uint8_t i = 0; i < FX_NUM_BAR; ++i) { map[i] = LEGACY_BACKGROUND_BRIGHTNESS; }
+
+    uint16_t outgoing_intensity_scaled_cd = LEGACY_TRANSITION_SCALE - transition_progress_scaled_cd;
+    for (uint8_t i = 0; i < FX_COMET_GRADIENT_LENGTH; ++i) {
+        int8_t led_map_idx = (head_idx - i + FX_NUM_BAR) % FX_NUM_BAR;
+        uint32_t scaled_brightness = (uint32_t)head_brightness * outgoing_intensity_scaled_cd;
+        if (i == 1) { scaled_brightness = (scaled_brightness * FX_COMET_TAIL1_NUM) / FX_COMET_TAIL1_DEN; }
+        else if (i == 2) { scaled_brightness = (scaled_brightness * FX_COMET_TAIL2_NUM) / FX_COMET_TAIL2_DEN; }
+        uint8_t out_seg_brightness = (uint8_t)(scaled_brightness / LEGACY_TRANSITION_SCALE);
+        if (out_seg_brightness > map[led_map_idx]) map[led_map_idx] = out_seg_brightness;
+    }
+
+    uint16_t incoming_intensity_scaled_cd = transition_progress_scaled_cd;
+    int8_t next_led_base_idx_cd = (head_idx + 1) % FX_NUM_BAR;
+    for (uint8_t i = 0; i < FX_COMET_GRADIENT_LENGTH; ++i) {
+        int8_t led_map_idx = (next_led_base_idx_cd - i + FX_NUM_BAR) % FX_NUM_BAR;
+        uint32_t scaled_brightness = (uint32_t)head_brightness * incoming_intensity_scaled_cd;
+        if (i == 1) { scaled_brightness = (scaled_brightness * FX_COMET_TAIL1_NUM) / FX_COMET_TAIL1_DEN; }
+        else if (i == 2) { scaled_brightness = (scaled_brightness * FX_COMET_TAIL2_NUM) / FX_COMET_TAIL2_DEN; }
+        uint8_t in_seg_brightness = (uint8_t)(scaled_brightness / LEGACY_TRANSITION_SCALE);
+        if (in_seg_brightness > map[led_map_idx]) map[led_map_idx] = in_seg_brightness;
+    }
+}
+
+void bench_led_render(uint32_t frames, LedRenderBench_t* out) {
+    uint8_t map_legacy[FX_NUM_BAR];
+    uint8_t map_fixed[FX_NUM_BAR];
+    out->frames = frames;
+    out->legacy_cycles = 0;
+    out->fixed_cycles = 0;
+    out->max_abs_diff = 0;
+
+    // Walk the same inputs the effect sees: head position, glow level, sweep time.
+    uint8_t head_idx = 0;
+    uint8_t head_brightness = 20;
+    uint32_t sweep_elapsed = 0;
+    for (uint32_t f = 0; f < frames; ++f) {
+        // IRQs off so the PWM ISR doesn't land inside a measurement (each span is well under 1 ms).
+        __disable_irq();
+        uint32_t t0 = cycle_stamp();
+        compose_converge_pulse_legacy(map_legacy, head_idx, head_brightness, sweep_elapsed);
+        out->legacy_cycles += cycles_since(t0);
+        t0 = cycle_stamp();
+        uint32_t progress = fx_mul_q16(sweep_elapsed, FX_Q16(255, LEGACY_SWEEP_SPEED_MS));
+        if (progress > 255) progress = 255;
+        compose_converge_pulse(map_fixed, head_idx, head_brightness, (uint8_t)progress, LEGACY_BACKGROUND_BRIGHTNESS);
+        out->fixed_cycles += cycles_since(t0);
+        __enable_irq();
+
+        for (uint8_t i = 0; i < FX_NUM_BAR; ++i) {
+            uint8_t diff = (map_fixed[i] > map_legacy[i]) ? (map_fixed[i] - map_legacy[i]) : (map_legacy[i] - map_fixed[i]);
+            if (diff > out->max_abs_diff) out->max_abs_diff = diff;
+        }
+
+        head_idx = fx_wrap_index(head_idx + 1, FX_NUM_BAR);
+        head_brightness = (head_brightness > 255 - 7) ? 20 : (uint8_t)(head_brightness + 7);
+        sweep_elapsed = (sweep_elapsed >= LEGACY_SWEEP_SPEED_MS) ? 0 : sweep_elapsed + 1;
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef LED_FX_H
+#define LED_FX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Keyframe Effect Engine */
+// Effects are small opcode programs in flash, played by one interpreter.
+// Each effect runs up to FX_NUM_TRACKS programs side by side (light bar,
+// overlay/parameter, eye), all against the same timebase. Timing is exact:
+// each op starts where the previous one was due to end, not when the main
+// loop happened to notice, so parallel tracks stay in step across loops.
+
+// Channel masks. Light bar bits are positions in custom_marquee_sequence
+// (bit 0 = first LED of the sweep order), not LIGHT_PINS indices.
+#define FX_BAR(pos)      (1U << (pos))
+#define FX_BAR_ALL       0x00FFU
+#define FX_CH_EYE        (1U << 8)
+#define FX_CH_REG        (1U << 9)  // Scratch level, read by FX_OP_COMET as head brightness
+#define FX_NUM_BAR       8
+#define FX_NUM_CHANNELS  10
+#define FX_CH_EYE_IDX    8
+#define FX_CH_REG_IDX    9
+#define FX_NUM_TRACKS    3
+
+typedef enum {
+    FX_OP_END,     // Hold the current levels forever
+    FX_OP_SET,     // mask channels = level (takes no time)
+    FX_OP_SHOW,    // Bar: mask = level, rest = arg (background); hold ms
+    FX_OP_WAIT,    // Hold ms
+    FX_OP_RAMP,    // Every ms, move mask channels arg closer to level; ends when all arrive
+    FX_OP_ROTATE,  // Every ms, shift the bar one position along the sequence; arg times
+    FX_OP_SPARKLE, // Every ms, relight 'level' random LEDs on the overlay; for arg ms (0 = forever)
+    FX_OP_COMET,   // Bar: pulse head advancing one LED per ms over background 'level', forever
+    FX_OP_BURST,   // Strike burst flag = level (mirrored to burstActive)
+    FX_OP_JUMP     // Continue at op index arg
+} FxOpcode_t;
+
+typedef struct {
+    uint8_t  op;    // FxOpcode_t
+    uint8_t  level; // Target level, count or flag
+    uint16_t mask;  // FX_BAR / FX_CH_* channels
+    uint16_t ms;    // Duration or interval
+    uint16_t arg;   // Background, step, repeat count, duration or jump target
+} FxOp_t;
+
+#define FX_END()                            { FX_OP_END, 0, 0, 0, 0 }
+#define FX_SET(mask, level)                 { FX_OP_SET, (level), (mask), 0, 0 }
+#define FX_SHOW(mask, level, bg, ms)        { FX_OP_SHOW, (level), (mask), (ms), (bg) }
+#define FX_WAIT(ms)                         { FX_OP_WAIT, 0, 0, (ms), 0 }
+#define FX_RAMP(mask, target, step, ms)     { FX_OP_RAMP, (target), (mask), (ms), (step) }
+#define FX_ROTATE(ms, times)                { FX_OP_ROTATE, 0, 0, (ms), (times) }
+#define FX_SPARKLE(count, ms, duration)     { FX_OP_SPARKLE, (count), 0, (ms), (duration) }
+#define FX_COMET(bg, ms)                    { FX_OP_COMET, (bg), 0, (ms), 0 }
+#define FX_BURST(on)                        { FX_OP_BURST, (on), 0, 0, 0 }
+#define FX_JUMP(pc)                         { FX_OP_JUMP, 0, 0, 0, (pc) }
+
+typedef struct {
+    const FxOp_t* track[FX_NUM_TRACKS]; // NULL = unused track
+} FxEffect_t;
+
+/* Morse Overlay */
+// Morse text is played on top of whatever effect runs (which keeps its own
+// timeline underneath): while active it owns the eye, or the eye and the
+// whole bar, and the rest stays dark. Every on/off span is scheduled from the
+// end of the previous one, so timing holds to the tick however often the main
+// loop runs. Characters are packed one byte each: element count in bits 7..5,
+// element i in bit i (1 = dash); 0 marks a word space.
+#define FX_MORSE_MAX_CHARS  32
+#define FX_MORSE_LEAD_IN_MS 1000U // Dark before the first element
+
+// Result of bench_led_render(): core cycles summed over all frames.
+typedef struct {
+    uint32_t frames;
+    uint32_t legacy_cycles; // Original divide/modulo CONVERGE pulse kernel
+    uint32_t fixed_cycles;  // fixed_math.h kernel used by FX_OP_COMET
+    uint8_t  max_abs_diff;  // Largest per-LED brightness difference between the two
+} LedRenderBench_t;
+
+/* Function Prototypes */
+void fx_start(const FxEffect_t* fx, uint32_t now);
+void fx_run(uint32_t now);
+uint32_t fx_next_deadline(uint32_t now, uint32_t idle); // Absolute ms of the next op/tick, or 'idle'
+uint16_t fx_longest_op_ms(const FxEffect_t* fx); // Longest hold or tick interval in its programs
+uint8_t fx_get_level(uint8_t channel);    // 0..FX_NUM_CHANNELS-1
+uint8_t fx_get_bar_level(uint8_t pos);    // Bar level with the sparkle overlay applied
+bool fx_burst_active(void);
+void fx_morse_start(const char* text, bool all_leds, uint32_t now); // Replaces any message in progress
+void fx_morse_cancel(void);
+bool fx_morse_active(void);
+void bench_led_render(uint32_t frames, LedRenderBench_t* out); // Legacy vs fixed-point CONVERGE frame cost
+
+#endif // LED_FX_H
@@ -14,12 +14,22 @@
 #include <ctype.h>
 #include <stdlib.h>
 
+#include "main.h"
 #include "hal_init.h"
 #include "led_control.h"
+#include "led_fx.h"
 #include "challenge.h"
 #include "shell.h"
 #include "utils.h"
 #include "sw_pwm.h"
+#include "power.h"
+#include "clock_gov.h"
+#include "serial.h"
+#include "touch.h"
+#include "battery.h"
+#include "sched.h"
+#include "perf.h"
+#include "isr_prof.h"
 
 /* Global Variable Definitions (declared extern in module headers) */
 
@@ -30,6 +40,10 @@ ADC_HandleTypeDef hadc;
 TIM_HandleTypeDef htim2;  // Main PWM timer (Eye LED, Light Bar HW PWM)
 TIM_HandleTypeDef htim21; // Generic Timer (if used beyond base init)
 TIM_HandleTypeDef htim22; // Light Bar HW PWM
+DMA_HandleTypeDef hdma_tim2_up;  // SW PWM waveform -> GPIOB->BSRR (DMA mode)
+DMA_HandleTypeDef hdma_tim2_ch3; // SW PWM waveform -> GPIOA->BSRR (DMA mode)
+DMA_HandleTypeDef hdma_lpuart1_tx; // Shell output queue -> LPUART1->TDR
+DMA_HandleTypeDef hdma_usart2_tx;  // Diagnostic stream lines -> USART2->TDR
 
 // Challenge System State (used by challenge.c, shell.c)
 Johnny5_RepairStatus_t repair_status;
@@ -46,15 +60,105 @@ volatile bool burstActive = false;           // For STRIKE effect
 // e.g. SECRET_UNLOCK_PHRASE is in challenge.c, extern in challenge.h
 
 /* Private function prototypes -----------------------------------------------*/
-// SysTick_Handler is now the only "private" function prototype here, rest are in modules.
+// IRQ handlers are the only "private" function prototypes here, rest are in modules.
 void SysTick_Handler(void);
+void TIM21_IRQHandler(void);
+void LPUART1_IRQHandler(void);
+void USART2_IRQHandler(void);
+void DMA1_Channel1_IRQHandler(void);
+void DMA1_Channel2_3_IRQHandler(void);
+void DMA1_Channel4_5_6_7_IRQHandler(void);
+void EXTI4_15_IRQHandler(void);
+void ADC1_COMP_IRQHandler(void);
+void LPTIM1_IRQHandler(void);
 
 
-int main(void)
+// Touch task state
+static bool lastPressed_cap = false;
+static uint32_t last_touch_mode_change_time = 0; // From original main.c
+static uint32_t touch_next_sample = 0;
+
+/**
+  * @brief Touch task: capacitive pad sample and effect cycling (every TOUCH_SAMPLE_INTERVAL_MS once repaired).
+  * @retval None
+  */
+static void touch_task(uint32_t now)
+{
+  bool pressed = touch_sample(); // from touch.c (debounced; the discharge is timed by the EXTI ISR)
+  // Once a press shows up, it is debounced at the full rate even in ultra-idle
+  bool slow = led_ultra_idle_active() && touch_idle();
+  touch_next_sample = now + (slow ? TOUCH_IDLE_SAMPLE_INTERVAL_MS : TOUCH_SAMPLE_INTERVAL_MS);
+  if (pressed && !lastPressed_cap) {
+      if (now - last_touch_mode_change_time >= TOUCH_MODE_CHANGE_COOLDOWN_MS) { // TOUCH_MODE_CHANGE_COOLDOWN_MS from touch.h
+          
+          clearAllLEDs(); // from led_control.c
+          fx_morse_cancel(); // from led_fx.c: a touch takes the LEDs back from a Morse message
+          AppEffect_t previous_effect = effect;
+
+          // Cycle through effects
+          if (previous_effect == EFFECT_BREATHE)      { effect = EFFECT_CRACKLE; }
+          else if (previous_effect == EFFECT_CRACKLE)   { effect = EFFECT_SCANNER; }
+          else if (previous_effect == EFFECT_SCANNER)   { effect = EFFECT_CONVERGE_DIVERGE; }
+          else if (previous_effect == EFFECT_CONVERGE_DIVERGE){ effect = EFFECT_ALL_ON; }
+          else if (previous_effect == EFFECT_ALL_ON)    { effect = EFFECT_STRIKE; }
+          else if (previous_effect == EFFECT_STRIKE)    { effect = EFFECT_OFF; }
+          else if (previous_effect == EFFECT_OFF)       { effect = EFFECT_BREATHE; }
+          else { effect = EFFECT_BREATHE; } // Default
+
+          // Save the new effect if it's a valid bling mode
+          if (effect != EFFECT_OFF && effect != EFFECT_STRIKE) {
+              repair_status.last_unlocked_effect = (uint8_t)effect;
+              save_repair_status(); // from challenge.c
+          } else if (effect == EFFECT_OFF) {
+              if (previous_effect != EFFECT_OFF && previous_effect != EFFECT_STRIKE) {
+                   repair_status.last_unlocked_effect = (uint8_t)previous_effect;
+              } else {
+                   repair_status.last_unlocked_effect = (uint8_t)EFFECT_BREATHE;
+              }
+              save_repair_status();
+          }
+          // Don't save EFFECT_STRIKE as a persistent bling mode from touch
+
+          if (effect == EFFECT_STRIKE) { 
+              burstActive = true;
+              // Strike state (phase, timers) reset by update_led_visuals
+              driveEye(EYE_SOLID_ON_BRIGHTNESS);
+          } else if (effect == EFFECT_OFF) {
+              // Eye pulse state reset by update_led_visuals
+               driveEye(EYE_SOLID_ON_BRIGHTNESS);
+          }
+          last_touch_mode_change_time = now;
+          // Consider calling print_banner_shell() here if effect change should update banner immediately
+      }
+  }
+  lastPressed_cap = pressed;
+}
+
+static uint32_t touch_task_next(uint32_t now, uint32_t idle)
+{
+  if (!all_repairs_completed) {
+      lastPressed_cap = false; // Pad unused until the repairs are done
+      touch_next_sample = now;  // then sampled right away
+      return idle;
+  }
+  return touch_next_sample;
+}
+
+// Tasks whose modules have no init of their own here. update_led_visuals stays
+// a call across modules (the simulator wraps it).
+static const SchedTask_t touch_sched_task = { "touch", touch_task, touch_task_next, 0U, SCHED_PRIO_TOUCH };
+static const SchedTask_t led_sched_task = { "led", update_led_visuals, led_visuals_next_deadline, 0U, SCHED_PRIO_LED };
+
+/**
+  * @brief Brings up clocks, peripherals and firmware modules, then prints the shell banner.
+  * @retval None
+  */
+void app_init(void)
 {
   HAL_Init(); // Initializes Flash interface, Systick, etc.
   SystemClock_Config(); // from hal_init.c
   srand(HAL_GetTick()); // Seed random number generator
+  sched_init(); // from sched.c (modules register their tasks from their init functions)
 
   // Release SWO pin PB3 for GPIO use if not debugging
   __HAL_RCC_GPIOB_CLK_ENABLE();
@@ -66,17 +170,25 @@ int main(void)
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();         // from hal_init.c
+  isr_prof_init();        // from isr_prof.c (PA4 scope pin when built with ISR_PROF_SCOPE_PIN)
+  MX_DMA_Init();          // from hal_init.c
   MX_LPUART1_UART_Init(); // Shell UART, from hal_init.c
   MX_USART2_UART_Init();  // Diagnostic UART, from hal_init.c
   MX_ADC_Init();          // from hal_init.c
   MX_TIM2_Init();         // from hal_init.c
   MX_TIM21_Init();        // from hal_init.c
   MX_TIM22_Init();        // from hal_init.c
+  MX_LPTIM1_Init();       // from hal_init.c (Stop mode wakeup timer)
 
-  init_software_pwm();    // from sw_pwm.c
+  init_software_pwm(SW_PWM_DEFAULT_MODE); // from sw_pwm.c (timebase starts once a channel is dimmed)
   init_challenge_system(); // from challenge.c (loads repair_status, sets initial all_repairs_completed)
   init_shell();           // from shell.c
+  serial_init();          // from serial.c (shell RX interrupt + ring, catches input typed during the banner)
+  touch_init();           // from touch.c (pad charged, EXTI line masked until the first measurement)
+  battery_init();         // from battery.c (first VDD reading, for the banner)
   init_led_effects();     // from led_control.c (currently empty, but good practice)
+  sched_add(&touch_sched_task);
+  sched_add(&led_sched_task);
 
 
   // Determine initial LED effect based on loaded repair status
@@ -84,7 +196,7 @@ int main(void)
       effect = EFFECT_STRIKE;
       burstActive = true;
       // Strike phase variables are static within led_control.c and will be reset by update_led_visuals
-      __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, EYE_SOLID_ON_BRIGHTNESS); // Ensure eye is on for strike
+      driveEye(EYE_SOLID_ON_BRIGHTNESS); // Ensure eye is on for strike
   } else {
       AppEffect_t loaded_effect = (AppEffect_t)repair_status.last_unlocked_effect;
       if (loaded_effect == EFFECT_OFF || loaded_effect == EFFECT_STRIKE || loaded_effect > EFFECT_CONVERGE_DIVERGE) {
@@ -100,104 +212,157 @@ int main(void)
   HAL_TIM_PWM_Start(&htim2, TIM_CHANNEL_1); // Eye LED
   HAL_TIM_PWM_Start(&htim2, TIM_CHANNEL_2); // Light Bar HW PWM (e.g. LIGHT_PINS[0] -> PA1)
   HAL_TIM_PWM_Start(&htim22, TIM_CHANNEL_1); // Light Bar HW PWM (e.g. LIGHT_PINS[3] -> PA6)
-  // TIM21 is not started here for PWM, assuming it's for other purposes or started if specific channels are used.
+  // TIM21 is the software PWM timebase, started/stopped by sw_pwm.c as channel levels change.
 
   // Initial Shell Output
-  HAL_UART_Transmit(&hlpuart1, (uint8_t*)FW_VERSION_PGM, strlen(FW_VERSION_PGM), HAL_MAX_DELAY); // FW_VERSION_PGM from shell.c/h
-  HAL_UART_Transmit(&hlpuart1, (uint8_t*)"\r\n", 2, HAL_MAX_DELAY);
+  // Queued for DMA (serial.c): the main loop starts while the banner is still going out
+  serial_write_msg(MSG_FW_VERSION); // Catalog text, messages.def
   print_banner_shell(); // from shell.c
-  HAL_UART_Transmit(&hlpuart1, (uint8_t*)"Type 'help' for commands.\r\n\r\n", strlen("Type 'help' for commands.\r\n\r\n"), HAL_MAX_DELAY);
+  serial_write_msg(MSG_TYPE_HELP);
 
-  // Clear IT flags for LPUART1 (shell)
-  __HAL_UART_CLEAR_IT(&hlpuart1, UART_CLEAR_OREF);
-  __HAL_UART_CLEAR_IT(&hlpuart1, UART_CLEAR_NEF);
-  __HAL_UART_CLEAR_IT(&hlpuart1, UART_CLEAR_FEF);
+  clock_gov_init(); // from clock_gov.c (HSI16 until the banner has gone out)
+  power_init(); // from power.c (shell RX wakes the core from Sleep and Stop)
+}
 
+/**
+  * @brief One pass of the main loop: dispatch the due tasks, then sleep until the next deadline.
+  * @retval None
+  */
+void app_loop_once(void)
+{
+  uint32_t now = HAL_GetTick();
+  // Clock for this pass, picked before it is timed (from clock_gov.c)
+  uint32_t idle = clock_govern(now, now + POWER_MAX_IDLE_MS);
+  uint32_t pass_start = cycle_count(); // from utils.c
 
-  // Variables for main loop
-  static bool lastPressed_cap = false;
-  static uint32_t last_touch_mode_change_time = 0; // From original main.c
+  // Run the tasks that are due, then sleep until the next one is (or shell input arrives)
+  uint32_t deadline = sched_dispatch(now, idle); // from sched.c
+  uint32_t idle_start = cycle_count();
+  power_idle_until(deadline); // from power.c
+  perf_loop_record(idle_start - pass_start, cycle_count() - idle_start); // from perf.c
+}
+
+int main(void)
+{
+  app_init();
 
   while (1)
   {
-    uint32_t now = HAL_GetTick();
-
-    // Handle Diagnostic Stream Output (USART2)
-    handle_diagnostic_stream(now); // from challenge.c
-
-    // Handle Shell Input (LPUART1)
-    uint8_t rx_char;
-    HAL_StatusTypeDef rx_status = HAL_UART_Receive(&hlpuart1, &rx_char, 1, 1); // Short timeout for non-blocking feel
-
-    if (rx_status == HAL_OK) {
-        shell_process_char(rx_char, &hlpuart1); // from shell.c
-    } else if (rx_status == HAL_ERROR) {
-        if (hlpuart1.ErrorCode & HAL_UART_ERROR_ORE) { __HAL_UART_CLEAR_IT(&hlpuart1, UART_CLEAR_OREF); }
-        if (hlpuart1.ErrorCode & HAL_UART_ERROR_NE) { __HAL_UART_CLEAR_IT(&hlpuart1, UART_CLEAR_NEF); }
-        if (hlpuart1.ErrorCode & HAL_UART_ERROR_FE) { __HAL_UART_CLEAR_IT(&hlpuart1, UART_CLEAR_FEF); }
-        hlpuart1.ErrorCode = HAL_UART_ERROR_NONE; // Reset error code
-    }
-
-    // Handle Capacitive Touch Input for Effect Cycling
-    if (all_repairs_completed) {
-        bool pressed = is_capacitive_touched(); // from utils.c
-        if (pressed && !lastPressed_cap) {
-            if (now - last_touch_mode_change_time >= TOUCH_MODE_CHANGE_COOLDOWN_MS) { // TOUCH_MODE_CHANGE_COOLDOWN_MS from utils.h
-                
-                clearAllLEDs(); // from led_control.c
-                AppEffect_t previous_effect = effect;
-
-                // Cycle through effects
-                if (previous_effect == EFFECT_BREATHE)      { effect = EFFECT_CRACKLE; }
-                else if (previous_effect == EFFECT_CRACKLE)   { effect = EFFECT_SCANNER; }
-                else if (previous_effect == EFFECT_SCANNER)   { effect = EFFECT_CONVERGE_DIVERGE; }
-                else if (previous_effect == EFFECT_CONVERGE_DIVERGE){ effect = EFFECT_ALL_ON; }
-                else if (previous_effect == EFFECT_ALL_ON)    { effect = EFFECT_STRIKE; }
-                else if (previous_effect == EFFECT_STRIKE)    { effect = EFFECT_OFF; }
-                else if (previous_effect == EFFECT_OFF)       { effect = EFFECT_BREATHE; }
-                else { effect = EFFECT_BREATHE; } // Default
-
-                // Save the new effect if it's a valid bling mode
-                if (effect != EFFECT_OFF && effect != EFFECT_STRIKE) {
-                    repair_status.last_unlocked_effect = (uint8_t)effect;
-                    save_repair_status(); // from challenge.c
-                } else if (effect == EFFECT_OFF) {
-                    if (previous_effect != EFFECT_OFF && previous_effect != EFFECT_STRIKE) {
-                         repair_status.last_unlocked_effect = (uint8_t)previous_effect;
-                    } else {
-                         repair_status.last_unlocked_effect = (uint8_t)EFFECT_BREATHE;
-                    }
-                    save_repair_status();
-                }
-                // Don't save EFFECT_STRIKE as a persistent bling mode from touch
-
-                if (effect == EFFECT_STRIKE) { 
-                    burstActive = true;
-                    // Strike state (phase, timers) reset by update_led_visuals
-                    __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, EYE_SOLID_ON_BRIGHTNESS);
-                } else if (effect == EFFECT_OFF) {
-                    // Eye pulse state reset by update_led_visuals
-                     __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, EYE_SOLID_ON_BRIGHTNESS);
-                }
-                last_touch_mode_change_time = now;
-                // Consider calling print_banner_shell() here if effect change should update banner immediately
-            }
-        }
-        lastPressed_cap = pressed;
-    } else {
-        lastPressed_cap = false; 
-    }
-
-    // Update LED Visuals
-    update_led_visuals(now); // from led_control.c
+    app_loop_once();
   }
 }
 
 /**
-  * @brief System Tick Configuration for SW_PWM.
+  * @brief System Tick: HAL millisecond timebase only (software PWM runs on TIM21).
+  * @note  Profiled (isr_prof.c); latency is how far SysTick has counted down since it reloaded.
   * @retval None
   */
 void SysTick_Handler(void) {
+  uint32_t latency = SysTick->LOAD - SysTick->VAL;
+  uint32_t stamp = isr_prof_enter();
   HAL_IncTick();
-  update_software_pwm(); // from sw_pwm.c
+  isr_prof_exit(ISR_PROF_SYSTICK, stamp, latency);
+}
+
+/**
+  * @brief TIM21 update interrupt: software PWM step / BAM bit-plane timebase.
+  * @note  Profiled (isr_prof.c); latency is TIM21's count since the update event, in core cycles.
+  * @retval None
+  */
+void TIM21_IRQHandler(void) {
+  uint32_t latency = TIM21->CNT * (TIM21->PSC + 1U);
+  uint32_t stamp = isr_prof_enter();
+  sw_pwm_timer_isr(); // from sw_pwm.c
+  isr_prof_exit(ISR_PROF_TIM21, stamp, latency);
+}
+
+/**
+  * @brief LPUART1 interrupt: shell receive (RXNE and overrun), then TX complete.
+  * @note  serial_rx_isr() consumes RXNE and clears the error flags first, so the
+  *        HAL handler only ever sees the TC flag ending a shell DMA transfer.
+  * @retval None
+  */
+void LPUART1_IRQHandler(void) {
+  serial_rx_isr(); // from serial.c
+  HAL_UART_IRQHandler(&hlpuart1);
+}
+
+/**
+  * @brief USART2 interrupt: diagnostic stream TX complete (TX only, no receive interrupts).
+  * @retval None
+  */
+void USART2_IRQHandler(void) {
+  HAL_UART_IRQHandler(&huart2);
+}
+
+/**
+  * @brief DMA1 channel 1: software PWM waveform for GPIOA (TIM2_CH3), half/complete.
+  * @retval None
+  */
+void DMA1_Channel1_IRQHandler(void) {
+  HAL_DMA_IRQHandler(&hdma_tim2_ch3);
+}
+
+/**
+  * @brief DMA1 channels 2-3: software PWM waveform for GPIOB (TIM2_UP, ch2), half/complete.
+  * @retval None
+  */
+void DMA1_Channel2_3_IRQHandler(void) {
+  HAL_DMA_IRQHandler(&hdma_tim2_up);
+}
+
+/**
+  * @brief DMA1 channels 4-7: shell (ch7) and diagnostic stream (ch4) TX transfers
+  *        complete (each hands over to its UART's TC interrupt).
+  * @retval None
+  */
+void DMA1_Channel4_5_6_7_IRQHandler(void) {
+  HAL_DMA_IRQHandler(&hdma_usart2_tx);
+  HAL_DMA_IRQHandler(&hdma_lpuart1_tx);
+}
+
+/**
+  * @brief EXTI lines 4-15: touch pad discharge edge (PB7, line 7).
+  * @retval None
+  */
+void EXTI4_15_IRQHandler(void) {
+  touch_exti_isr(); // from touch.c
+}
+
+/**
+  * @brief ADC end of conversion: background battery (VREFINT) sample.
+  * @retval None
+  */
+void ADC1_COMP_IRQHandler(void) {
+  HAL_ADC_IRQHandler(&hadc);
+}
+
+/**
+  * @brief LPTIM1 compare match: a Stop mode wakeup deadline (power.c).
+  * @retval None
+  */
+void LPTIM1_IRQHandler(void) {
+  power_lptim_isr(); // from power.c
+}
+
+/**
+  * @brief ADC conversion complete: hand the oversampled VREFINT result to battery.c.
+  * @retval None
+  */
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc_cb) {
+  if (hadc_cb == &hadc) {
+    battery_adc_complete(); // from battery.c
+  }
+}
+
+/**
+  * @brief UART transmit complete: start the next queued shell transfer or diagnostic line.
+  * @retval None
+  */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+  if (huart == &hlpuart1) {
+    serial_tx_complete(); // from serial.c
+  } else if (huart == &huart2) {
+    diagnostic_stream_tx_complete(); // from challenge.c
+  }
 }
@@ -0,0 +1,10 @@
+#ifndef MAIN_H
+#define MAIN_H
+
+/* Function Prototypes */
+// main() is app_init() followed by app_loop_once() forever; split so the host
+// simulator can drive the same loop in virtual time.
+void app_init(void);
+void app_loop_once(void);
+
+#endif // MAIN_H
@@ -0,0 +1,50 @@
+#include "msg.h"
+#include "msg_catalog.h" // Generated from messages.def by tools/gen_msg_catalog.py
+#include "challenge.h"   // For DIAG_STREAM_LINE_MAX
+
+_Static_assert(MSG_CATALOG_COUNT == MSG_COUNT, "msg_catalog.h is out of date with messages.def");
+_Static_assert(MSG_MAX_DEPTH <= MSG_STACK_DEPTH, "catalog pairs nest deeper than MSG_STACK_DEPTH");
+_Static_assert(MSG_DIAG_FEED_MAX_LEN <= DIAG_STREAM_LINE_MAX, "a DIAG_FEED line (CRLF included) does not fit DIAG_STREAM_LINE_MAX");
+
+uint16_t msg_length(MsgId_t id) {
+    return (id < MSG_COUNT) ? MSG_LENGTHS[id] : 0U;
+}
+
+void msg_open(MsgReader_t* reader, MsgId_t id) {
+    uint16_t start = MSG_OFFSETS[MSG_COUNT], end = start; // Unknown ids read as empty
+    if (id < MSG_COUNT) {
+        start = MSG_OFFSETS[id];
+        end = MSG_OFFSETS[id + 1];
+    }
+    reader->src = &MSG_STREAM[start];
+    reader->end = &MSG_STREAM[end];
+    reader->sp = 0;
+}
+
+uint16_t msg_read(MsgReader_t* reader, uint8_t* dst, uint16_t max) {
+    uint16_t n = 0;
+    while (n < max) {
+        uint8_t sym;
+        if (reader->sp > 0U) {
+            sym = reader->stack[--reader->sp];
+        } else if (reader->src < reader->end) {
+            sym = *reader->src++;
+        } else {
+            break;
+        }
+        // Walk down the left halves, parking each right half for later
+        while (sym >= MSG_FIRST_PAIR) {
+            const uint8_t* pair = MSG_PAIRS[sym - MSG_FIRST_PAIR];
+            reader->stack[reader->sp++] = pair[1];
+            sym = pair[0];
+        }
+        dst[n++] = MSG_LITERALS[sym];
+    }
+    return n;
+}
+
+uint16_t msg_copy(MsgId_t id, uint8_t* dst, uint16_t size) {
+    MsgReader_t reader;
+    msg_open(&reader, id);
+    return msg_read(&reader, dst, size);
+}
@@ -0,0 +1,37 @@
+#ifndef MSG_H
+#define MSG_H
+
+#include <stdint.h>
+
+/* Console Text Catalog */
+// Fixed banner, help, chat and diagnostic text lives in messages.def. At build
+// time tools/gen_msg_catalog.py byte-pair encodes the whole catalog into
+// msg_catalog.h (about two thirds of the raw size), and the text is only
+// expanded while it is being sent. Lengths are precomputed, so nothing here
+// scans for a terminator; the expanded text is not NUL-terminated.
+
+#define MSG_STACK_DEPTH 8 // Pair nesting the reader can expand; the generator stays within it
+
+typedef enum {
+#define MSG(id, text) MSG_##id,
+#include "messages.def"
+#undef MSG
+    MSG_COUNT
+} MsgId_t;
+
+// Resumable expansion state: a message can be read out in pieces of any size
+typedef struct {
+    const uint8_t* src;
+    const uint8_t* end;
+    uint8_t sp;
+    uint8_t stack[MSG_STACK_DEPTH]; // Right halves of pairs still to expand
+} MsgReader_t;
+
+/* Function Prototypes */
+uint16_t msg_length(MsgId_t id);
+void msg_open(MsgReader_t* reader, MsgId_t id);
+uint16_t msg_read(MsgReader_t* reader, uint8_t* dst, uint16_t max); // Bytes written, 0 at the end
+uint16_t msg_copy(MsgId_t id, uint8_t* dst, uint16_t size);        // Whole message, truncated to size
+// Shell output: serial_write_msg() (serial.h) expands an entry as it is sent
+
+#endif // MSG_H
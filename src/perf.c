@@ -0,0 +1,55 @@
+#include "perf.h"
+#include "sched.h" // For sched_reset_stats
+
+static PerfLoopStats_t perf_loop;
+static uint32_t perf_clock_hz;  // SystemCoreClock perf_us_shift was derived from
+static uint8_t perf_us_shift;   // log2(cycles per us), rounded down
+
+// Recomputed only when the core clock changes. Called from interrupt handlers too.
+static uint8_t us_shift(void) {
+    uint32_t hz = SystemCoreClock;
+    if (hz != perf_clock_hz) {
+        uint32_t mhz = hz / 1000000U;
+        uint8_t shift = 0;
+        while (mhz > 1U) {
+            mhz >>= 1;
+            shift++;
+        }
+        perf_us_shift = shift; // Before the clock it belongs to: interrupt handlers use it too
+        perf_clock_hz = hz;
+        return shift;
+    }
+    return perf_us_shift;
+}
+
+uint32_t perf_cycles_to_us(uint32_t cycles) {
+    return cycles >> us_shift();
+}
+
+// No CLZ on the Cortex-M0+: a short shift loop instead
+void perf_hist_add(PerfHist_t* hist, uint32_t cycles) {
+    uint32_t us = perf_cycles_to_us(cycles);
+    uint8_t bucket = 0;
+    while (us > 1U && bucket < PERF_HIST_BUCKETS - 1U) {
+        us >>= 1;
+        bucket++;
+    }
+    if (hist->count[bucket] != UINT16_MAX) hist->count[bucket]++;
+}
+
+void perf_loop_record(uint32_t busy_cycles, uint32_t idle_cycles) {
+    perf_loop.passes++;
+    perf_loop.busy_cycles += busy_cycles;
+    perf_loop.idle_cycles += idle_cycles;
+    if (busy_cycles > perf_loop.busy_max_cycles) perf_loop.busy_max_cycles = busy_cycles;
+    perf_hist_add(&perf_loop.busy_hist, busy_cycles);
+}
+
+void get_perf_loop_stats(PerfLoopStats_t* out) {
+    *out = perf_loop;
+}
+
+void perf_reset(void) {
+    perf_loop = (PerfLoopStats_t){ .since_ms = HAL_GetTick() };
+    sched_reset_stats();
+}
@@ -0,0 +1,36 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include "stm32l0xx_hal.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Performance Counters */
+// Durations are taken with cycle_count() (utils.h, SysTick based) and kept as
+// log2 histograms: bucket i counts spans of [2^i, 2^(i+1)) us, bucket 0 also
+// the shorter ones and the last bucket everything longer. Microseconds are
+// cycles shifted by log2 of the core clock in MHz, so only approximate when
+// the clock is not a power-of-two number of MHz. Counts saturate.
+#define PERF_HIST_BUCKETS 12 // Last bucket: 2048 us and up
+
+typedef struct {
+    uint16_t count[PERF_HIST_BUCKETS];
+} PerfHist_t;
+
+typedef struct {
+    uint32_t passes;          // Main loop passes
+    uint64_t busy_cycles;     // Dispatching tasks
+    uint64_t idle_cycles;     // In power_idle_until (interrupts taken while asleep included)
+    uint32_t busy_max_cycles; // Worst pass
+    PerfHist_t busy_hist;
+    uint32_t since_ms;        // HAL tick of the last reset
+} PerfLoopStats_t;
+
+/* Function Prototypes */
+void perf_hist_add(PerfHist_t* hist, uint32_t cycles);
+uint32_t perf_cycles_to_us(uint32_t cycles);
+void perf_loop_record(uint32_t busy_cycles, uint32_t idle_cycles); // Once per main loop pass
+void get_perf_loop_stats(PerfLoopStats_t* out);
+void perf_reset(void); // Loop counters and every scheduler task's statistics
+
+#endif // PERF_H
@@ -0,0 +1,150 @@
+#include "power.h"
+#include "serial.h"      // For serial_rx_available, serial_tx_busy (Stop hold-off)
+#include "hal_init.h"    // For hlpuart1
+#include "led_control.h" // For leds_static
+#include "challenge.h"   // For diagnostic_stream_tx_idle
+#include "touch.h"       // For touch_measuring
+#include "utils.h"       // For cycle_count
+#include "shell.h"       // For shell_has_work
+
+static uint32_t power_lsi_hz;   // 0 if the LSI did not count: Stop mode stays off
+static uint32_t power_lsi_frac; // LSI ticks (x1000) slept but not yet credited to the tick
+static bool power_cmp_written;  // LPTIM1 CMP written; the next write waits for CMPOK
+static PowerStats_t power_stats;
+
+// LPTIM1 counts asynchronously to the bus: two equal reads in a row are valid
+static uint16_t lptim_count(void) {
+    uint16_t a = (uint16_t)LPTIM1->CNT;
+    uint16_t b = (uint16_t)LPTIM1->CNT;
+    while (a != b) {
+        a = b;
+        b = (uint16_t)LPTIM1->CNT;
+    }
+    return b;
+}
+
+// The LSI is only specified to within 26-56 kHz, so its rate is measured
+// against the HSI16-driven tick.
+static void power_calibrate_lsi(void) {
+    uint32_t tick = HAL_GetTick();
+    while (HAL_GetTick() == tick) __WFI(); // Start on a tick edge
+    uint16_t start = lptim_count();
+    tick = HAL_GetTick();
+    while (HAL_GetTick() - tick < POWER_LSI_CAL_MS) __WFI();
+    power_lsi_hz = (uint16_t)(lptim_count() - start) * (1000U / POWER_LSI_CAL_MS);
+}
+
+void power_init(void) {
+    // With SEVONPEND every interrupt that becomes pending sets the event register,
+    // so a shell byte whose ISR runs between the ring check and WFE still ends the WFE.
+    SCB->SCR |= SCB_SCR_SEVONPEND_Msk;
+
+    // Stop mode: VREFINT off while stopped and not waited for on wakeup (the
+    // battery sample's HAL_ADCEx_EnableVREFINT waits for it instead)
+    HAL_PWREx_EnableUltraLowPower();
+    HAL_PWREx_EnableFastWakeUp();
+    power_calibrate_lsi();
+
+    // In Stop, LPUART1 (UESM) wakes HSI16 for an incoming byte; its start-bit
+    // flag (WUF, enabled only around each Stop) wakes the core, and the byte
+    // itself still arrives by RXNE
+    UART_WakeUpTypeDef wakeup = {0};
+    wakeup.WakeUpEvent = UART_WAKEUP_ON_STARTBIT;
+    HAL_UARTEx_StopModeWakeUpSourceConfig(&hlpuart1, wakeup);
+    HAL_UARTEx_EnableStopMode(&hlpuart1);
+
+    power_reset_stats();
+}
+
+// Why the clocks must keep running, if they must: the held_* counter to bump
+static uint32_t* power_stop_holder(void) {
+    if (!leds_static()) return &power_stats.held_leds;
+    if (serial_tx_busy() || !diagnostic_stream_tx_idle() || (hlpuart1.Instance->ISR & USART_ISR_BUSY)) {
+        return &power_stats.held_uart;
+    }
+    if (touch_measuring()) return &power_stats.held_touch;
+    return NULL;
+}
+
+// Interrupts are masked from the checks to the wakeup, so nothing that
+// arrives in between is missed: a pending interrupt ends WFI regardless.
+static void power_stop(uint32_t ms) {
+    uint16_t start = lptim_count();
+    uint32_t ticks = ms * power_lsi_hz / 1000U;
+    LPTIM1->ICR = LPTIM_ICR_CMPOKCF | LPTIM_ICR_CMPMCF;
+    LPTIM1->CMP = (uint16_t)(start + ticks);
+    power_cmp_written = true;
+    __HAL_UART_CLEAR_FLAG(&hlpuart1, UART_CLEAR_WUF);
+    __HAL_UART_ENABLE_IT(&hlpuart1, UART_IT_WUF);
+    HAL_SuspendTick();
+
+    HAL_PWR_EnterSTOPMode(PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI);
+
+    // Back on the clock we stopped on (clock_gov.c sets the wakeup clock):
+    // move the tick past the time stopped
+    uint16_t elapsed = (uint16_t)(lptim_count() - start);
+    uint32_t credit = (uint32_t)elapsed * 1000U + power_lsi_frac;
+    uint32_t slept_ms = credit / power_lsi_hz;
+    power_lsi_frac = credit - slept_ms * power_lsi_hz;
+    uwTick += slept_ms;
+    HAL_ResumeTick();
+    __HAL_UART_DISABLE_IT(&hlpuart1, UART_IT_WUF);
+
+    power_stats.stop_entries++;
+    power_stats.stop_ms[clock_speed()] += slept_ms;
+    if (elapsed < ticks) power_stats.stop_early++;
+}
+
+void power_idle_until(uint32_t deadline) {
+    uint32_t start = cycle_count();
+    // In Sleep, SysTick still interrupts every 1 ms, so each WFE lasts at most one tick.
+    // Shell input ends the wait whenever the shell can take it: received bytes
+    // are queued even while a reply is sent, and a queued command ends it once
+    // that reply has drained (TX completion wakes us).
+    while ((int32_t)(deadline - HAL_GetTick()) > 0) {
+        if (shell_has_work()) {
+            break;
+        }
+        uint32_t remaining = deadline - HAL_GetTick();
+        if (remaining >= POWER_STOP_MIN_MS && power_lsi_hz != 0U &&
+            (!power_cmp_written || (LPTIM1->ISR & LPTIM_ISR_CMPOK))) {
+            __disable_irq();
+            uint32_t* holder = power_stop_holder();
+            if (holder == NULL && !serial_rx_available()) {
+                power_stop(remaining);
+                __enable_irq();
+                continue;
+            }
+            if (holder != NULL) (*holder)++;
+            __enable_irq();
+        }
+        HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFE);
+    }
+    power_stats.idle_cycles[clock_speed()] += cycle_count() - start; // The clock only changes between passes
+}
+
+void power_lptim_isr(void) {
+    LPTIM1->ICR = LPTIM_ICR_CMPMCF; // The wakeup itself was all it was for
+}
+
+void get_power_stats(PowerStats_t* out) {
+    *out = power_stats;
+}
+
+void power_reset_stats(void) {
+    power_stats = (PowerStats_t){ .since_ms = HAL_GetTick() };
+    clock_reset_stats(); // from clock_gov.c: the estimate needs its residency over the same span
+}
+
+// Replaces the HAL's weak busy-wait so blocking delays (override notice, reboot)
+// sleep between SysTick interrupts instead of spinning.
+void HAL_Delay(uint32_t Delay) {
+    uint32_t tickstart = HAL_GetTick();
+    uint32_t wait = Delay;
+    if (wait < HAL_MAX_DELAY) {
+        wait += 1U; // Guarantee at least the requested time, as the HAL version does
+    }
+    while ((HAL_GetTick() - tickstart) < wait) {
+        __WFI();
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include "stm32l0xx_hal.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include "clock_gov.h" // For ClockSpeed_t, CLOCK_COUNT
+
+/* Constants */
+// Longest the main loop sleeps when nothing has a deadline; keeps housekeeping
+// (UART error flags, effect switches made from other modules) responsive.
+#define POWER_MAX_IDLE_MS 1000U
+
+// Waits at least this long use Stop mode when nothing needs a running clock;
+// shorter ones sleep, as Stop entry/exit and LSI rounding would eat the gain.
+#define POWER_STOP_MIN_MS 3U
+#define POWER_LSI_CAL_MS 20U // LSI measured against the SysTick over this span at init
+
+// MCU supply current per state, for the 'power' estimate. Datasheet typicals
+// for the STM32L031 at 3 V (16 MHz on HSI16, range 1; Stop with the low-power
+// regulator, LSI and LPTIM1 running), not measured on the badge. LED current
+// is not included. See README.md.
+#define POWER_EST_RUN_UA   2500U
+#define POWER_EST_SLEEP_UA 1000U
+#define POWER_EST_STOP_UA  1U
+// The same on MSI range 5 (2.1 MHz, still range 1), with HSI16 left running
+// as LPUART1's clock
+#define POWER_EST_RUN_MSI_UA   400U
+#define POWER_EST_SLEEP_MSI_UA 170U
+
+typedef struct {
+    uint64_t idle_cycles[CLOCK_COUNT]; // In power_idle_until, Stop time included (cycle_count()), per clock
+    uint32_t stop_entries;
+    uint32_t stop_ms[CLOCK_COUNT];     // Credited to the HAL tick from LPTIM1 after each Stop
+    uint32_t stop_early;    // Stops ended by an interrupt before their deadline
+    uint32_t held_leds;     // Sleep waits (about 1 ms each) Stop was held off for: PWM running
+    uint32_t held_uart;     // ... shell/diagnostic TX in flight or shell byte arriving
+    uint32_t held_touch;    // ... touch discharge being timed
+    uint32_t since_ms;      // HAL tick of the last reset
+} PowerStats_t;
+
+/* Function Prototypes */
+// After the peripherals, MX_LPTIM1_Init() and serial_init(): measures the LSI
+// and arms the LPUART1 start-bit wakeup.
+void power_init(void);
+// Sleeps until HAL_GetTick() reaches 'deadline' or the shell has work
+// (shell_has_work), whichever is first. Long waits use Stop mode (clocks off;
+// LPTIM1 wakes the core at the deadline, LPUART1 on a start bit, EXTI on a
+// touch) when no PWM, transfer or touch measurement needs the clocks;
+// otherwise Sleep (core clock gated, peripherals running).
+void power_idle_until(uint32_t deadline);
+void power_lptim_isr(void); // LPTIM1 compare match: Stop wakeup deadline
+void get_power_stats(PowerStats_t* out);
+void power_reset_stats(void); // Clock governor residency too
+
+#endif // POWER_H
@@ -0,0 +1,200 @@
+#include "sched.h"
+#include "utils.h" // For cycle_count, deadline_earliest
+
+#define SCHED_WHEEL_MASK (SCHED_WHEEL_SLOTS - 1U)
+
+typedef struct {
+    const SchedTask_t* task;
+    uint32_t due;
+    bool armed;          // In the wheel or in sched_ready
+    SchedId_t wheel_next; // Next task in the same wheel slot
+    SchedTaskStats_t stats;
+} SchedEntry_t;
+
+static SchedEntry_t sched_tasks[SCHED_MAX_TASKS];
+static SchedId_t sched_order[SCHED_MAX_TASKS]; // Ids by priority
+static uint8_t sched_count;
+static SchedId_t sched_wheel[SCHED_WHEEL_SLOTS]; // Slot heads
+static uint32_t sched_wheel_time;                // Last tick the wheel has expired
+static uint32_t sched_ready;                     // Bit per id: due, waiting for the run phase
+
+_Static_assert((SCHED_WHEEL_SLOTS & SCHED_WHEEL_MASK) == 0U, "SCHED_WHEEL_SLOTS must be a power of two");
+_Static_assert(SCHED_MAX_TASKS <= 32U, "sched_ready has one bit per task");
+
+void sched_init(void) {
+    sched_count = 0;
+    sched_ready = 0;
+    sched_wheel_time = HAL_GetTick();
+    for (uint8_t i = 0; i < SCHED_WHEEL_SLOTS; i++) sched_wheel[i] = SCHED_NONE;
+}
+
+static void wheel_unlink(SchedId_t id) {
+    SchedEntry_t* e = &sched_tasks[id];
+    if (!e->armed) return;
+    e->armed = false;
+    if (sched_ready & (1UL << id)) {
+        sched_ready &= ~(1UL << id);
+        return;
+    }
+    SchedId_t* link = &sched_wheel[e->due & SCHED_WHEEL_MASK];
+    while (*link != id) link = &sched_tasks[*link].wheel_next;
+    *link = e->wheel_next;
+}
+
+// Already expired (the wheel has passed its slot): straight to the ready set
+static void wheel_insert(SchedId_t id, uint32_t due) {
+    SchedEntry_t* e = &sched_tasks[id];
+    e->due = due;
+    e->armed = true;
+    if ((int32_t)(due - sched_wheel_time) <= 0) {
+        sched_ready |= 1UL << id;
+        return;
+    }
+    SchedId_t* head = &sched_wheel[due & SCHED_WHEEL_MASK];
+    e->wheel_next = *head;
+    *head = id;
+}
+
+static void sched_clear_stats(SchedEntry_t* e) {
+    e->stats = (SchedTaskStats_t){ .name = e->task->name, .priority = e->task->priority };
+}
+
+SchedId_t sched_add(const SchedTask_t* task) {
+    for (SchedId_t id = 0; id < sched_count; id++) {
+        if (sched_tasks[id].task == task) return id;
+    }
+    if (sched_count >= SCHED_MAX_TASKS) return SCHED_NONE;
+
+    SchedId_t id = sched_count++;
+    SchedEntry_t* e = &sched_tasks[id];
+    e->task = task;
+    e->armed = false;
+    sched_clear_stats(e);
+
+    // Insertion sort keeps sched_order by priority; equal priorities run in registration order
+    uint8_t pos = id;
+    while (pos > 0U && sched_tasks[sched_order[pos - 1U]].task->priority > task->priority) {
+        sched_order[pos] = sched_order[pos - 1U];
+        pos--;
+    }
+    sched_order[pos] = id;
+
+    if (task->next == NULL && task->period_ms > 0U) {
+        wheel_insert(id, sched_wheel_time + task->period_ms);
+    }
+    return id;
+}
+
+void sched_at(SchedId_t id, uint32_t when) {
+    if (id >= sched_count) return;
+    wheel_unlink(id);
+    wheel_insert(id, when);
+}
+
+void sched_cancel(SchedId_t id) {
+    if (id >= sched_count) return;
+    wheel_unlink(id);
+}
+
+// Expires every slot from the last expired tick up to 'now' (each slot once
+// when more than a lap has passed); tasks of later laps stay put.
+static void wheel_advance(uint32_t now) {
+    uint32_t ticks = now - sched_wheel_time;
+    if ((int32_t)ticks <= 0) return;
+    if (ticks > SCHED_WHEEL_SLOTS) ticks = SCHED_WHEEL_SLOTS;
+    for (uint32_t t = 1; t <= ticks; t++) {
+        SchedId_t* link = &sched_wheel[(sched_wheel_time + t) & SCHED_WHEEL_MASK];
+        while (*link != SCHED_NONE) {
+            SchedEntry_t* e = &sched_tasks[*link];
+            if ((int32_t)(e->due - now) <= 0) {
+                sched_ready |= 1UL << *link;
+                *link = e->wheel_next;
+            } else {
+                link = &e->wheel_next;
+            }
+        }
+    }
+    sched_wheel_time = now;
+}
+
+static void sched_run(SchedId_t id, uint32_t now) {
+    SchedEntry_t* e = &sched_tasks[id];
+    const SchedTask_t* task = e->task;
+    uint32_t due = e->due;
+    e->armed = false;
+
+    uint32_t late_ms = now - due;
+    if (late_ms > 0U) {
+        e->stats.late++;
+        if (late_ms > e->stats.late_max_ms) e->stats.late_max_ms = late_ms;
+    }
+    // Periodic tasks keep their phase; periods that passed in the meantime are dropped
+    if (task->next == NULL && task->period_ms > 0U) {
+        uint32_t next = due + task->period_ms;
+        if ((int32_t)(next - now) <= 0) {
+            uint32_t skipped = late_ms / task->period_ms;
+            e->stats.missed += skipped;
+            next += skipped * task->period_ms;
+        }
+        wheel_insert(id, next); // Before the run, so the task may still move itself
+    }
+
+    uint32_t start = cycle_count();
+    task->run(now);
+    uint32_t cycles = cycle_count() - start;
+
+    e->stats.runs++;
+    e->stats.cycles_total += cycles;
+    if (cycles > e->stats.cycles_max) e->stats.cycles_max = cycles;
+    if (perf_cycles_to_us(cycles) > SCHED_RUN_BUDGET_US) e->stats.overruns++;
+    perf_hist_add(&e->stats.hist, cycles);
+}
+
+uint32_t sched_dispatch(uint32_t now, uint32_t idle) {
+    wheel_advance(now);
+
+    // Tasks that come due while these run wait for the next pass; one that an
+    // earlier task cancels or moves meanwhile is skipped
+    uint32_t due = sched_ready;
+    for (uint8_t i = 0; i < sched_count; i++) {
+        uint32_t bit = 1UL << sched_order[i];
+        if (!(due & sched_ready & bit)) continue;
+        sched_ready &= ~bit;
+        sched_run(sched_order[i], now);
+    }
+
+    // Hooks last: they see what this round's tasks changed. A hook with
+    // nothing to do ('idle') leaves its task disarmed.
+    for (SchedId_t id = 0; id < sched_count; id++) {
+        const SchedTask_t* task = sched_tasks[id].task;
+        if (task->next == NULL) continue;
+        uint32_t next = task->next(now, idle);
+        wheel_unlink(id);
+        if (next != idle) wheel_insert(id, next);
+    }
+
+    if (sched_ready) return now;
+    // First slot ahead holding a task of this lap is the earliest; later-lap
+    // tasks met on the way are the fallback
+    uint32_t deadline = idle;
+    for (uint32_t t = 1; t <= SCHED_WHEEL_SLOTS; t++) {
+        for (SchedId_t id = sched_wheel[(now + t) & SCHED_WHEEL_MASK]; id != SCHED_NONE; id = sched_tasks[id].wheel_next) {
+            uint32_t task_due = sched_tasks[id].due;
+            if (task_due - now == t) return deadline_earliest(now, idle, task_due);
+            deadline = deadline_earliest(now, deadline, task_due);
+        }
+    }
+    return deadline;
+}
+
+uint8_t sched_task_count(void) {
+    return sched_count;
+}
+
+void get_sched_stats(SchedId_t id, SchedTaskStats_t* out) {
+    *out = sched_tasks[id].stats;
+}
+
+void sched_reset_stats(void) {
+    for (SchedId_t id = 0; id < sched_count; id++) sched_clear_stats(&sched_tasks[id]);
+}
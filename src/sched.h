@@ -0,0 +1,75 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include "stm32l0xx_hal.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include "perf.h" // For PerfHist_t
+
+/* Cooperative Task Scheduler */
+// Modules register tasks and the main loop only dispatches the ones that are
+// due, then sleeps until the earliest next due time. Three kinds of task:
+//   periodic  - period_ms > 0, re-armed one period after each due time
+//   one-shot  - period_ms == 0, armed with sched_at(), disarmed when it runs
+//   hooked    - 'next' set: the module keeps its own timing and the hook is
+//               asked for its next deadline after every dispatch round, so
+//               state changed by other tasks (a shell command switching the
+//               effect) is picked up on the next pass
+// Armed tasks sit in a timer wheel of 1 ms slots: arming and expiry cost the
+// same however far out the due time is; a task more than one lap ahead just
+// stays in its slot until the wheel comes round to it with the right time.
+// Tasks due together run in priority order (lower first), each once per pass.
+#define SCHED_MAX_TASKS        12U
+#define SCHED_WHEEL_SLOTS      32U   // Power of two; one lap = 32 ms
+#define SCHED_RUN_BUDGET_US    1000U // A run longer than this (one tick) counts as an overrun
+#define SCHED_NONE             0xFFU
+
+// Task priorities, all in one place
+#define SCHED_PRIO_SHELL   0U // Typed input first: command latency
+#define SCHED_PRIO_TOUCH   1U
+#define SCHED_PRIO_LED     2U
+#define SCHED_PRIO_DIAG    3U
+#define SCHED_PRIO_BATTERY 4U
+#define SCHED_PRIO_JOURNAL 5U
+
+typedef uint8_t SchedId_t;
+typedef void (*SchedRunFn_t)(uint32_t now);
+typedef uint32_t (*SchedNextFn_t)(uint32_t now, uint32_t idle); // Next deadline, or 'idle' for none
+
+typedef struct {
+    const char* name;
+    SchedRunFn_t run;
+    SchedNextFn_t next; // Hooked tasks only, NULL otherwise
+    uint32_t period_ms; // Periodic tasks; 0 = one-shot (or hooked)
+    uint8_t priority;   // Lower runs first among tasks due in the same pass
+} SchedTask_t;
+
+typedef struct {
+    const char* name;
+    uint8_t priority;
+    uint32_t runs;
+    uint64_t cycles_total; // Core cycles spent in the task
+    uint32_t cycles_max;
+    uint32_t late;         // Runs that started one tick or more after their due time
+    uint32_t late_max_ms;
+    uint32_t overruns;     // Runs longer than SCHED_RUN_BUDGET_US
+    uint32_t missed;       // Periodic tasks: whole periods skipped because the task ran late
+    PerfHist_t hist;       // Run time
+} SchedTaskStats_t;
+
+/* Function Prototypes */
+void sched_init(void); // Before any module registers
+// Registers 'task' (a static descriptor; registering the same one again returns
+// its id). Periodic tasks are armed one period from now, hooked tasks by their
+// hook on the first pass; one-shot tasks wait for sched_at(). SCHED_NONE when full.
+SchedId_t sched_add(const SchedTask_t* task);
+void sched_at(SchedId_t id, uint32_t when); // (Re)arm for an absolute HAL tick (main loop context)
+void sched_cancel(SchedId_t id);
+// Main loop: runs what is due at 'now' and returns the next deadline, never
+// later than 'idle'. Returns 'now' when something is already due again.
+uint32_t sched_dispatch(uint32_t now, uint32_t idle);
+uint8_t sched_task_count(void);
+void get_sched_stats(SchedId_t id, SchedTaskStats_t* out);
+void sched_reset_stats(void);
+
+#endif // SCHED_H
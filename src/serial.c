@@ -0,0 +1,273 @@
+#include "serial.h"
+#include "hal_init.h" // For hlpuart1
+#include "msg.h"      // For catalog entries (serial_write_msg)
+#include <string.h>
+
+#define SERIAL_RX_RING_MASK (SERIAL_RX_RING_SIZE - 1U)
+#define SERIAL_TX_QUEUE_MASK (SERIAL_TX_QUEUE_LEN - 1U)
+#define SERIAL_TX_ARENA_MASK (SERIAL_TX_ARENA_SIZE - 1U)
+// Largest single arena reservation. At most half the arena, so a reservation
+// that skips the wrap gap still fits once the arena drains.
+#define SERIAL_TX_COPY_CHUNK (SERIAL_TX_ARENA_SIZE / 2U)
+
+typedef enum {
+    SERIAL_TX_REF,   // Caller-owned bytes (zero-copy)
+    SERIAL_TX_ARENA, // Copied into tx_arena
+    SERIAL_TX_MSG    // Catalog entry, expanded into tx_msg_chunk as it goes out
+} SerialTxKind_t;
+
+typedef struct {
+    const uint8_t* data; // Unused for SERIAL_TX_MSG
+    uint16_t len;
+    uint16_t arena_end; // Arena head after this entry; becomes the arena tail when it completes
+    uint8_t kind;       // SerialTxKind_t
+    uint8_t msg;        // MsgId_t for SERIAL_TX_MSG
+} SerialTxDesc_t;
+
+static volatile uint8_t rx_ring[SERIAL_RX_RING_SIZE];
+static volatile uint16_t rx_head; // Written by serial_rx_isr only
+static volatile uint16_t rx_tail; // Written by serial_rx_read only
+static volatile SerialRxStats_t rx_stats;
+
+// TX queue: main loop writes tx_head and tx_arena_head, the completion
+// callback writes tx_tail and tx_arena_tail. Arena indices run free (mod 2^16).
+static SerialTxDesc_t tx_queue[SERIAL_TX_QUEUE_LEN];
+static volatile uint8_t tx_head;
+static volatile uint8_t tx_tail;       // Entry on the wire while tx_active
+static volatile bool tx_active;
+static uint8_t tx_arena[SERIAL_TX_ARENA_SIZE];
+static volatile uint16_t tx_arena_head;
+static volatile uint16_t tx_arena_tail;
+static volatile SerialTxStats_t tx_stats;
+// Only the entry at tx_tail is ever expanded, so one reader and chunk serve the queue
+static MsgReader_t tx_msg_reader;
+static uint8_t tx_msg_chunk[SERIAL_TX_MSG_CHUNK];
+static uint16_t tx_msg_left;  // Bytes of the tx_tail entry not yet sent; 0 = not opened
+static uint16_t tx_msg_ready; // Bytes expanded into tx_msg_chunk, waiting for DMA
+
+void serial_init(void) {
+    rx_head = 0;
+    rx_tail = 0;
+    reset_serial_rx_stats();
+    tx_head = 0;
+    tx_tail = 0;
+    tx_active = false;
+    tx_arena_head = 0;
+    tx_arena_tail = 0;
+    tx_msg_left = 0;
+    tx_msg_ready = 0;
+    reset_serial_tx_stats();
+    // Discard anything latched before the ring existed
+    __HAL_UART_CLEAR_IT(&hlpuart1, UART_CLEAR_OREF | UART_CLEAR_NEF | UART_CLEAR_FEF | UART_CLEAR_PEF);
+    // RXNEIE also raises the interrupt on ORE, so overruns are counted and cleared here too
+    __HAL_UART_ENABLE_IT(&hlpuart1, UART_IT_RXNE);
+}
+
+void serial_rx_isr(void) {
+    uint32_t isr = hlpuart1.Instance->ISR;
+
+    if (isr & (USART_ISR_ORE | USART_ISR_FE | USART_ISR_NE | USART_ISR_PE)) {
+        if (isr & USART_ISR_ORE) rx_stats.hw_overruns++;
+        if (isr & (USART_ISR_FE | USART_ISR_NE | USART_ISR_PE)) rx_stats.line_errors++;
+        __HAL_UART_CLEAR_IT(&hlpuart1, UART_CLEAR_OREF | UART_CLEAR_NEF | UART_CLEAR_FEF | UART_CLEAR_PEF);
+    }
+
+    if (isr & USART_ISR_RXNE) {
+        uint8_t byte = (uint8_t)UART_READ_RDR(hlpuart1.Instance);
+        uint16_t head = rx_head;
+        uint16_t next = (uint16_t)((head + 1U) & SERIAL_RX_RING_MASK);
+        if (next == rx_tail) {
+            rx_stats.ring_overruns++;
+            return;
+        }
+        rx_ring[head] = byte;
+        rx_head = next; // Publish after the byte is stored
+        rx_stats.rx_bytes++;
+    }
+}
+
+bool serial_rx_available(void) {
+    return rx_head != rx_tail;
+}
+
+bool serial_rx_read(uint8_t* out) {
+    uint16_t tail = rx_tail;
+    if (tail == rx_head) return false;
+    *out = rx_ring[tail];
+    rx_tail = (uint16_t)((tail + 1U) & SERIAL_RX_RING_MASK); // Frees the slot for the ISR
+    return true;
+}
+
+void get_serial_rx_stats(SerialRxStats_t* out) {
+    // Word-sized fields: each read is atomic, the set is not (fine for reporting)
+    out->rx_bytes = rx_stats.rx_bytes;
+    out->ring_overruns = rx_stats.ring_overruns;
+    out->hw_overruns = rx_stats.hw_overruns;
+    out->line_errors = rx_stats.line_errors;
+}
+
+void reset_serial_rx_stats(void) {
+    __disable_irq();
+    rx_stats.rx_bytes = 0;
+    rx_stats.ring_overruns = 0;
+    rx_stats.hw_overruns = 0;
+    rx_stats.line_errors = 0;
+    __enable_irq();
+}
+
+/* Transmit queue ----------------------------------------------------------- */
+
+// Starts DMA on the oldest queued entry. Runs from the completion callback or
+// with interrupts masked, so it never races itself. A catalog entry goes out
+// one SERIAL_TX_MSG_CHUNK at a time, each expanded just before it is sent.
+static void tx_start_next(void) {
+    if (tx_active || tx_tail == tx_head) return;
+    const SerialTxDesc_t* desc = &tx_queue[tx_tail];
+    const uint8_t* data = desc->data;
+    uint16_t len = desc->len;
+    if (desc->kind == SERIAL_TX_MSG) {
+        if (tx_msg_left == 0U) {
+            msg_open(&tx_msg_reader, (MsgId_t)desc->msg);
+            tx_msg_left = desc->len;
+        }
+        if (tx_msg_ready == 0U) tx_msg_ready = msg_read(&tx_msg_reader, tx_msg_chunk, SERIAL_TX_MSG_CHUNK);
+        data = tx_msg_chunk;
+        len = tx_msg_ready;
+    }
+    if (HAL_UART_Transmit_DMA(&hlpuart1, data, len) == HAL_OK) {
+        tx_active = true;
+        tx_stats.transfers++;
+    }
+}
+
+// Makes sure the queue is draining, then sleeps until the next interrupt
+// (DMA/UART completion frees space). PRIMASK stays set across WFI so a
+// completion that lands first still wakes the core; it runs on re-enable.
+// Nothing on the wire means the queue is empty: no wait.
+static void tx_wait(void) {
+    __disable_irq();
+    tx_start_next();
+    if (tx_active) __WFI();
+    __enable_irq();
+}
+
+static void tx_push(const uint8_t* data, uint16_t len, SerialTxKind_t kind, uint16_t arena_end, uint8_t msg) {
+    while ((uint8_t)((tx_head + 1U) & SERIAL_TX_QUEUE_MASK) == tx_tail) {
+        tx_stats.stalls++;
+        tx_wait();
+    }
+    SerialTxDesc_t* desc = &tx_queue[tx_head];
+    desc->data = data;
+    desc->len = len;
+    desc->kind = (uint8_t)kind;
+    desc->arena_end = arena_end;
+    desc->msg = msg;
+    __disable_irq();
+    tx_head = (uint8_t)((tx_head + 1U) & SERIAL_TX_QUEUE_MASK); // Publish after the entry is filled
+    tx_start_next();
+    __enable_irq();
+}
+
+void serial_write(const char* str) {
+    uint16_t len = (uint16_t)strlen(str);
+    if (len == 0U) return;
+    tx_stats.tx_bytes += len;
+    tx_push((const uint8_t*)str, len, SERIAL_TX_REF, 0U, 0U);
+}
+
+void serial_write_msg(MsgId_t id) {
+    uint16_t len = msg_length(id);
+    if (len == 0U) return;
+    tx_stats.tx_bytes += len;
+    tx_stats.expanded_bytes += len;
+    tx_push(NULL, len, SERIAL_TX_MSG, 0U, (uint8_t)id);
+}
+
+void serial_write_copy(const char* str) {
+    size_t remaining = strlen(str);
+    tx_stats.tx_bytes += remaining;
+    tx_stats.copied_bytes += remaining;
+
+    while (remaining > 0U) {
+        uint16_t len = (remaining > SERIAL_TX_COPY_CHUNK) ? SERIAL_TX_COPY_CHUNK : (uint16_t)remaining;
+
+        // Reserve len contiguous bytes; a reservation that would straddle the
+        // end of the arena skips the gap, which is released along with it.
+        uint16_t offset, gap;
+        for (;;) {
+            offset = (uint16_t)(tx_arena_head & SERIAL_TX_ARENA_MASK);
+            gap = (offset + len > SERIAL_TX_ARENA_SIZE) ? (uint16_t)(SERIAL_TX_ARENA_SIZE - offset) : 0U;
+            uint16_t used = (uint16_t)(tx_arena_head - tx_arena_tail);
+            if ((uint32_t)used + gap + len <= SERIAL_TX_ARENA_SIZE) break;
+            tx_stats.stalls++;
+            tx_wait();
+        }
+        if (gap != 0U) offset = 0U;
+        memcpy(&tx_arena[offset], str, len);
+        uint16_t arena_end = (uint16_t)(tx_arena_head + gap + len);
+        tx_arena_head = arena_end;
+
+        // Grow the newest entry instead when it is waiting and ends where this copy starts
+        bool merged = false;
+        __disable_irq();
+        uint8_t last = (uint8_t)((tx_head - 1U) & SERIAL_TX_QUEUE_MASK);
+        if (tx_head != tx_tail && !(tx_active && last == tx_tail)) {
+            SerialTxDesc_t* desc = &tx_queue[last];
+            if (desc->kind == SERIAL_TX_ARENA && gap == 0U && desc->data + desc->len == &tx_arena[offset]) {
+                desc->len = (uint16_t)(desc->len + len);
+                desc->arena_end = arena_end;
+                merged = true;
+            }
+        }
+        __enable_irq();
+        if (!merged) tx_push(&tx_arena[offset], len, SERIAL_TX_ARENA, arena_end, 0U);
+
+        str += len;
+        remaining -= len;
+    }
+}
+
+void serial_tx_flush(void) {
+    while (serial_tx_busy()) {
+        tx_wait();
+    }
+}
+
+bool serial_tx_busy(void) {
+    return tx_active || tx_head != tx_tail;
+}
+
+void serial_tx_complete(void) {
+    if (!tx_active) return;
+    const SerialTxDesc_t* desc = &tx_queue[tx_tail];
+    tx_active = false;
+    if (desc->kind == SERIAL_TX_MSG) {
+        tx_msg_left = (uint16_t)(tx_msg_left - tx_msg_ready);
+        tx_msg_ready = 0U;
+        if (tx_msg_left != 0U) { // Same entry, next chunk
+            tx_start_next();
+            return;
+        }
+    }
+    if (desc->kind == SERIAL_TX_ARENA) tx_arena_tail = desc->arena_end;
+    tx_tail = (uint8_t)((tx_tail + 1U) & SERIAL_TX_QUEUE_MASK);
+    tx_start_next();
+}
+
+void get_serial_tx_stats(SerialTxStats_t* out) {
+    out->tx_bytes = tx_stats.tx_bytes;
+    out->copied_bytes = tx_stats.copied_bytes;
+    out->expanded_bytes = tx_stats.expanded_bytes;
+    out->transfers = tx_stats.transfers;
+    out->stalls = tx_stats.stalls;
+}
+
+void reset_serial_tx_stats(void) {
+    __disable_irq();
+    tx_stats.tx_bytes = 0;
+    tx_stats.copied_bytes = 0;
+    tx_stats.expanded_bytes = 0;
+    tx_stats.transfers = 0;
+    tx_stats.stalls = 0;
+    __enable_irq();
+}
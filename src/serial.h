@@ -0,0 +1,65 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include "stm32l0xx_hal.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include "msg.h" // For MsgId_t
+
+/* Shell UART (LPUART1) */
+// The RXNE interrupt moves each byte into a single-producer/single-consumer
+// ring (ISR writes head, main loop writes tail), so input keeps arriving while
+// a command runs or the banner prints. No locking: each index has one writer.
+//
+// Output is a queue of (pointer, length) descriptors that DMA drains in the
+// background, so printing never holds up the main loop. serial_write() queues
+// the caller's bytes in place (string literals, const tables); serial_write_copy()
+// first copies into a small arena, for formatted text and stack buffers, and
+// serial_write_msg() queues a compressed catalog entry (msg.h) that is expanded
+// a chunk at a time as DMA reaches it, so fixed text costs no RAM while it
+// waits. A caller only waits when the queue or arena is full, sleeping until
+// DMA frees room.
+
+/* Constants */
+#define SERIAL_RX_RING_SIZE 256 // Power of two; ~22 ms of back-to-back input at 115200 baud
+#define SERIAL_TX_QUEUE_LEN 64   // Power of two; the banner plus 'help' fit without waiting
+#define SERIAL_TX_ARENA_SIZE 512 // Power of two; copied (formatted) output in flight
+#define SERIAL_TX_MSG_CHUNK 32   // Catalog text expanded per DMA transfer (in the completion IRQ)
+
+// Reading RDR clears RXNE. The host build routes it through the mock UART.
+#ifndef UART_READ_RDR
+#define UART_READ_RDR(instance) ((instance)->RDR)
+#endif
+
+typedef struct {
+    uint32_t rx_bytes;      // Bytes stored in the ring
+    uint32_t ring_overruns; // Bytes dropped because the ring was full
+    uint32_t hw_overruns;   // ORE: a byte was lost before the ISR could read RDR
+    uint32_t line_errors;   // Framing, noise or parity errors
+} SerialRxStats_t;
+
+typedef struct {
+    uint32_t tx_bytes;       // Bytes queued for transmission
+    uint32_t copied_bytes;   // Of those, bytes copied into the arena
+    uint32_t expanded_bytes; // Of those, catalog text expanded on the way out
+    uint32_t transfers;      // DMA transfers started (adjacent copies share one)
+    uint32_t stalls;         // Writes that had to wait for queue or arena space
+} SerialTxStats_t;
+
+/* Function Prototypes */
+void serial_init(void);     // Enables the LPUART1 RXNE interrupt and empties the TX queue (after MX_LPUART1_UART_Init)
+void serial_rx_isr(void);   // Called by LPUART1_IRQHandler
+bool serial_rx_available(void);
+bool serial_rx_read(uint8_t* out); // false when the ring is empty
+void get_serial_rx_stats(SerialRxStats_t* out);
+void reset_serial_rx_stats(void);
+void serial_write(const char* str);      // Zero-copy: str must stay valid until sent
+void serial_write_copy(const char* str); // Copies str, which may be reused on return
+void serial_write_msg(MsgId_t id);       // Catalog text (messages.def), expanded as it is sent
+void serial_tx_flush(void);              // Waits until every queued byte has left the UART
+bool serial_tx_busy(void);
+void serial_tx_complete(void);           // Called from HAL_UART_TxCpltCallback for LPUART1
+void get_serial_tx_stats(SerialTxStats_t* out);
+void reset_serial_tx_stats(void);
+
+#endif // SERIAL_H
@@ -2,10 +2,19 @@
 #include "utils.h"       // For trim, simple_strcasecmp, simple_strncasecmp, flash_morse_code, etc.
 #include "challenge.h"   // For challenge codes, flags, repair_status, save_repair_status, check_all_repairs_and_notify, diagnostic_stream_active, johnny5_chat_state, personality_matrix_fixed
 #include "led_control.h" // For AppEffect_t, effect, burstActive, clearAllLEDs, getEffectName, LIGHT_PIN_COUNT, MORSE_TARGET_EYES_ONLY
+#include "led_fx.h"      // For bench_led_render, fx_morse_cancel
+#include "serial.h"      // For serial_write / serial_write_msg (queued shell output), get_serial_rx_stats
+#include "battery.h"     // For battery_mv, battery_get (cached VDD readings)
+#include "sched.h"       // For the shell task, get_sched_stats ('tasks', 'perf')
+#include "perf.h"        // For get_perf_loop_stats, perf_reset
+#include "isr_prof.h"    // For get_isr_profile, isr_prof_reset
+#include "power.h"       // For get_power_stats, power_reset_stats
+#include "clock_gov.h"   // For get_clock_stats, clock_speed_hz (power estimate per clock)
 #include "hal_init.h"    // For UART handles (hlpuart1), TIM handles (htim2 for eye LED in cmdParser)
+#include "shell_cmd_hash.h" // Generated from shell_cmds.def by tools/gen_shell_hash.py
 #include <stdio.h>       // For sprintf, snprintf
-#include <string.h>      // For strlen, strtok, strstr, strncpy
-#include <stdlib.h>      // For atoi, rand
+#include <string.h>      // For strlen, strstr, strncpy
+#include <stdlib.h>      // For atoi, strtoul, rand
 #include <ctype.h>       // For isprint, tolower (used by string utils, but good include)
 
 /* Extern global variables from other modules */
@@ -35,39 +44,33 @@ extern const char* JOHNNY5_FLAG;
 static char cmdBuffer[64];
 static uint8_t cmdIndex = 0;
 
-/* Banner String Definitions */
-const char FW_VERSION_PGM_DEF[] = "SAINT-OS v2.0.25 CUBE [modded_kernel]"; // Renamed to avoid conflict with extern FW_VERSION_PGM
-const char BANNER_LINE_0_DEF[] = "=================================================================";
-const char BANNER_LINE_1_DEF[] = "||  S.A.I.N.T. OS        ROOT SHELL ACCESS        v2.0.25-mod  ||";
-const char BANNER_LINE_2_DEF[] = "||  Nova Robotics  -- PROTO-5 UNIT :: ONLINE  (SYSTEM OVERRIDE)||";
-const char BANNER_LINE_3_DEF[] = "||-------------------------------------------------------------||";
-const char BANNER_LINE_4_DEF[] = "||  SYSTEM DIAGNOSTICS :: KERNEL MODE                          ||";
-const char BANNER_LINE_5_DEF[] = "||     ▸ SRAM     : 32 KB  [INTEGRITY CHECK PASSED]            ||";
-const char BANNER_LINE_6_DEF[] = "||     ▸ EPROMS   :  4/4  [SHADOW REGISTERS ACTIVE]            ||";
-const char BANNER_LINE_7_DEF[] = "||     ▸ SERVOS   : 19/19 [CALIBRATION LOCK BYPASSED]          ||";
-const char BANNER_LINE_8_DEF[] = "||     ▸ LASER    : MISSING / DAMAGED                          ||";
-const char BANNER_LINE_SECURITY_BYPASS_DEF[] = "||     ▸ SECURITY : KERNEL PATCH APPLIED :: BYPASSED           ||";
-const char BANNER_LINE_EFFECT_PLACEHOLDER_DEF[] = "||     ▸ EFFECT   : %%EFFECT%%                              ||";
-const char BANNER_LINE_BAT_PLACEHOLDER_DEF[] = "||     ▸ BATTERY  : %%BAT%%                                       ||";
-const char BANNER_LINE_SPACER_DEF[] = "||                                                             ||";
-const char BANNER_LINE_10_DEF[] = "||  HTH 2025                                       synackzack  ||";
-const char BANNER_LINE_11_DEF[] = "||                         [SHELL CMD]                         ||";
-
-// Make these available via the extern declarations in shell.h
-const char* const BANNER_STRINGS[] = {
-  BANNER_LINE_0_DEF, BANNER_LINE_1_DEF, BANNER_LINE_2_DEF, BANNER_LINE_3_DEF, BANNER_LINE_4_DEF,
-  BANNER_LINE_5_DEF, BANNER_LINE_6_DEF, BANNER_LINE_7_DEF, BANNER_LINE_8_DEF,
-  BANNER_LINE_SECURITY_BYPASS_DEF,
-  BANNER_LINE_EFFECT_PLACEHOLDER_DEF,
-  BANNER_LINE_BAT_PLACEHOLDER_DEF,
-  BANNER_LINE_SPACER_DEF,
-  BANNER_LINE_10_DEF,
-  BANNER_LINE_11_DEF,
-  BANNER_LINE_0_DEF
+// Complete lines, each NUL-terminated, waiting for the previous reply to leave.
+// Input is read whenever a whole line still fits, so a paste lands here instead
+// of overflowing the RX ring while a long reply is sent.
+#define SHELL_PENDING_SIZE 256U // Power of two
+#define SHELL_PENDING_MASK (SHELL_PENDING_SIZE - 1U)
+static char shellPending[SHELL_PENDING_SIZE];
+static uint16_t pendingHead, pendingTail; // Free-running; masked on access
+static uint8_t pendingLines;
+
+/* Banner */
+// Catalog ids from messages.def. The EFFECT and BATTERY lines are formatted
+// at print time; their slots hold these two markers instead of an id.
+#define BANNER_EFFECT_LINE  0xFEU
+#define BANNER_BATTERY_LINE 0xFFU
+
+static const uint8_t BANNER_LINES[] = {
+  MSG_BANNER_RULE, MSG_BANNER_TITLE, MSG_BANNER_MAKER, MSG_BANNER_DIVIDER, MSG_BANNER_KERNEL,
+  MSG_BANNER_SRAM, MSG_BANNER_EPROMS, MSG_BANNER_SERVOS, MSG_BANNER_LASER,
+  MSG_BANNER_SECURITY,
+  BANNER_EFFECT_LINE,
+  BANNER_BATTERY_LINE,
+  MSG_BANNER_SPACER,
+  MSG_BANNER_CREDITS,
+  MSG_BANNER_SHELL,
+  MSG_BANNER_RULE
 };
-const char* FW_VERSION_PGM = FW_VERSION_PGM_DEF; // Assign to the extern declared pointer
-const char* BATT_PLACEHOLDER_STR = BANNER_LINE_BAT_PLACEHOLDER_DEF;
-const char* EFFECT_PLACEHOLDER_STR = BANNER_LINE_EFFECT_PLACEHOLDER_DEF;
+_Static_assert(MSG_COUNT < BANNER_EFFECT_LINE, "banner markers collide with catalog ids");
 
 
 void print_banner_shell(void) {
@@ -75,20 +78,20 @@ void print_banner_shell(void) {
   uint8_t pc_val = 0;
   bool batteryInfoNeeded = true; // To avoid calling readVdd_mV multiple times if placeholder appears more than once
 
-  for (uint8_t i = 0; i < sizeof(BANNER_STRINGS) / sizeof(BANNER_STRINGS[0]); ++i) {
-    const char* currentPgmString = BANNER_STRINGS[i];
+  for (uint8_t i = 0; i < sizeof(BANNER_LINES) / sizeof(BANNER_LINES[0]); ++i) {
+    uint8_t line = BANNER_LINES[i];
     char tempBuf[80]; // Increased size for safety
 
-    if (strcmp(currentPgmString, BATT_PLACEHOLDER_STR) == 0) {
+    if (line == BANNER_BATTERY_LINE) {
       if (batteryInfoNeeded) {
-        mv_val = read_vdd_mv(); // from utils.c
+        mv_val = battery_mv(); // from battery.c (cached, filtered)
         pc_val = get_battery_pct(mv_val); // from utils.c
         batteryInfoNeeded = false;
       }
       snprintf(tempBuf, sizeof(tempBuf), "||     ▸ BATTERY  : %3u %% (%4u mV)                            ||", pc_val, mv_val);
-      HAL_UART_Transmit(&hlpuart1, (uint8_t*)tempBuf, strlen(tempBuf), HAL_MAX_DELAY);
-      HAL_UART_Transmit(&hlpuart1, (uint8_t*)"\r\n", 2, HAL_MAX_DELAY);
-    } else if (strcmp(currentPgmString, EFFECT_PLACEHOLDER_STR) == 0) {
+      serial_write_copy(tempBuf);
+      serial_write("\r\n");
+    } else if (line == BANNER_EFFECT_LINE) {
       const char* effectName_str; // Renamed from effectName to avoid conflict with global 'effect'
       if (all_repairs_completed) {
           effectName_str = getEffectName(effect); // from led_control.c
@@ -97,12 +100,11 @@ void print_banner_shell(void) {
           effectName_str = getEffectName(EFFECT_STRIKE); // Always STRIKE if damaged
           snprintf(tempBuf, sizeof(tempBuf), "||     ▸ EFFECT   : %-7s (SYSTEM DAMAGED - REPAIR NEEDED)   ||", effectName_str);
       }
-      HAL_UART_Transmit(&hlpuart1, (uint8_t*)tempBuf, strlen(tempBuf), HAL_MAX_DELAY);
-      HAL_UART_Transmit(&hlpuart1, (uint8_t*)"\r\n", 2, HAL_MAX_DELAY);
+      serial_write_copy(tempBuf);
+      serial_write("\r\n");
     }
     else {
-      HAL_UART_Transmit(&hlpuart1, (uint8_t*)currentPgmString, strlen(currentPgmString), HAL_MAX_DELAY);
-      HAL_UART_Transmit(&hlpuart1, (uint8_t*)"\r\n", 2, HAL_MAX_DELAY);
+      serial_write_msg((MsgId_t)line);
     }
   }
   // Clear UART flags if necessary (original had this)
@@ -111,40 +113,130 @@ void print_banner_shell(void) {
   __HAL_UART_CLEAR_IT(&hlpuart1, UART_CLEAR_FEF);
 }
 
+/* Command Dispatch */
+// Commands, 'diag' subcommands and module names are listed once in
+// shell_cmds.def. Every word resolves through the perfect hash generated from
+// that file (shell_cmd_hash.h), then indexes a handler table directly.
+
+#define SHELL_MAX_ARGS 8
+
+typedef struct {
+  uint8_t argc;
+  char* argv[SHELL_MAX_ARGS];        // Space-separated words (private copy of the line)
+  const char* rest[SHELL_MAX_ARGS];  // The original line from argv[i] to its end (free text arguments)
+} ShellArgs_t;
+
+typedef void (*ShellHandler_t)(const ShellArgs_t* args);
+
+#define SHELL_CMD(token, handler) static void handler(const ShellArgs_t* args);
+#define SHELL_DIAG(token, handler) static void handler(const ShellArgs_t* args);
+#define SHELL_WORD(token)
+#include "shell_cmds.def"
+#undef SHELL_CMD
+#undef SHELL_DIAG
+#undef SHELL_WORD
+
+#define SHELL_CMD(token, handler) [SHELL_TOK_ID_##token] = handler,
+#define SHELL_DIAG(token, handler)
+#define SHELL_WORD(token)
+static const ShellHandler_t SHELL_COMMANDS[SHELL_TOK_COUNT] = {
+#include "shell_cmds.def"
+};
+#undef SHELL_CMD
+#undef SHELL_DIAG
+
+#define SHELL_CMD(token, handler)
+#define SHELL_DIAG(token, handler) [SHELL_TOK_ID_##token] = handler,
+static const ShellHandler_t SHELL_DIAG_COMMANDS[SHELL_TOK_COUNT] = {
+#include "shell_cmds.def"
+};
+#undef SHELL_CMD
+#undef SHELL_DIAG
+#undef SHELL_WORD
+
+// Seeded FNV-1a over the case-folded word; tools/gen_shell_hash.py computes the same.
+static uint32_t shell_token_hash(const char* word) {
+  uint32_t h = SHELL_HASH_SEED;
+  while (*word != '\0') {
+    h = (h ^ (uint8_t)tolower((unsigned char)*word++)) * 16777619U;
+  }
+  return h >> (32 - SHELL_HASH_BITS);
+}
+
+// Token id of a word, or SHELL_TOK_NONE. One hash, one slot read, one compare.
+static ShellToken_t shell_lookup(const char* word) {
+  uint8_t id = SHELL_HASH_SLOTS[shell_token_hash(word)];
+  if (id == SHELL_TOK_NONE || simple_strcasecmp(word, SHELL_TOKEN_NAMES[id]) != 0) return SHELL_TOK_NONE;
+  return (ShellToken_t)id;
+}
+
+static void shell_split_args(const char* line, char* buf, size_t buf_size, ShellArgs_t* args) {
+  strncpy(buf, line, buf_size - 1);
+  buf[buf_size - 1] = '\0';
+  args->argc = 0;
+  char* p = buf;
+  while (*p != '\0' && args->argc < SHELL_MAX_ARGS) {
+    while (*p == ' ') *p++ = '\0';
+    if (*p == '\0') break;
+    args->argv[args->argc] = p;
+    args->rest[args->argc] = line + (p - buf);
+    args->argc++;
+    while (*p != '\0' && *p != ' ') p++;
+  }
+}
+
+static void shell_unknown_command(void) {
+  print_banner_shell(); 
+  serial_write_msg(MSG_UNKNOWN_COMMAND);
+}
+
 void cmd_parser_shell(char* cmd) {
   char input_buffer[64]; 
   char* original_trimmed_cmd = trim(cmd); // trim from utils.c
-  strncpy(input_buffer, original_trimmed_cmd, sizeof(input_buffer) - 1);
-  input_buffer[sizeof(input_buffer) - 1] = '\0';
-  
-  // char* input = input_buffer; // Not used in original logic after this point
 
   if (strlen(original_trimmed_cmd) == 0) return;
 
-  HAL_UART_Transmit(&hlpuart1, (uint8_t*)"> ", 2, HAL_MAX_DELAY); 
-  HAL_UART_Transmit(&hlpuart1, (uint8_t*)original_trimmed_cmd, strlen(original_trimmed_cmd), HAL_MAX_DELAY);
-  HAL_UART_Transmit(&hlpuart1, (uint8_t*)"\r\n", 2, HAL_MAX_DELAY); 
-
-  char* command_token = strtok(input_buffer, " ");
-
-  if (command_token == NULL) return;
+  serial_write("> "); 
+  serial_write_copy(original_trimmed_cmd);
+  serial_write("\r\n"); 
 
   if (simple_strcasecmp(original_trimmed_cmd, SECRET_UNLOCK_PHRASE) == 0) { // SECRET_UNLOCK_PHRASE from challenge.h
     if (!all_repairs_completed) {
-        HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[FIRMWARE OVERRIDE DETECTED] Initiating full system diagnostic and repair...\r\n", strlen("[FIRMWARE OVERRIDE DETECTED] Initiating full system diagnostic and repair...\r\n"), HAL_MAX_DELAY);
+        serial_write_msg(MSG_OVERRIDE_DETECTED);
         HAL_Delay(500); 
         repair_status.challenge1_completed = 1;
         repair_status.challenge2_completed = 1;
         repair_status.challenge3_completed = 1;
         personality_matrix_fixed = true;
         save_repair_status(); // from challenge.c
-        HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[OVERRIDE] All subsystems forced online.\r\n", strlen("[OVERRIDE] All subsystems forced online.\r\n"), HAL_MAX_DELAY);
+        serial_write_msg(MSG_OVERRIDE_FORCED_ONLINE);
         check_all_repairs_and_notify(); // from challenge.c
     } else {
-        HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[FIRMWARE OVERRIDE] System already fully operational.\r\n", strlen("[FIRMWARE OVERRIDE] System already fully operational.\r\n"), HAL_MAX_DELAY);
+        serial_write_msg(MSG_OVERRIDE_ALREADY_ONLINE);
+    }
+  } else {
+    ShellArgs_t args;
+    shell_split_args(original_trimmed_cmd, input_buffer, sizeof(input_buffer), &args);
+    if (args.argc == 0) return;
+
+    ShellToken_t command = shell_lookup(args.argv[0]);
+    if (command != SHELL_TOK_NONE && SHELL_COMMANDS[command] != NULL) {
+      SHELL_COMMANDS[command](&args);
+    } else {
+      shell_unknown_command();
+    }
+  }
+  __HAL_UART_CLEAR_IT(&hlpuart1, UART_CLEAR_OREF); 
+  __HAL_UART_CLEAR_IT(&hlpuart1, UART_CLEAR_NEF);  
+  __HAL_UART_CLEAR_IT(&hlpuart1, UART_CLEAR_FEF);  
+}
+
+static void cmd_system_restore(const ShellArgs_t* args) {
+    if (args->argc != 1) { // Whole-line maintenance phrase, no arguments
+        shell_unknown_command();
+        return;
     }
-  } else if (simple_strcasecmp(original_trimmed_cmd, "j5_system_restore") == 0) {
-    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[MAINTENANCE] Initiating J5 System Damage Protocol Reset...\r\n", strlen("[MAINTENANCE] Initiating J5 System Damage Protocol Reset...\r\n"), HAL_MAX_DELAY);
+    serial_write_msg(MSG_RESTORE_START);
     repair_status.challenge1_completed = 0;
     repair_status.challenge2_completed = 0;
     repair_status.challenge3_completed = 0;
@@ -163,143 +255,188 @@ void cmd_parser_shell(char* cmd) {
     // Let's assume led_control.c has a function like `reset_strike_effect_state()` or similar.
     // Or, the main loop in main.c will call update_led_visuals which will re-init strike if burstActive is true and phase is 0.
     // The current update_led_visuals in led_control.c handles this re-initialization.
-    __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, EYE_SOLID_ON_BRIGHTNESS); // Eye LED
+    driveEye(EYE_SOLID_ON_BRIGHTNESS); // Eye LED
     clearAllLEDs(); // from led_control.c
+    fx_morse_cancel(); // from led_fx.c
 
-    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[MAINTENANCE] System state reset. All modules require diagnostics.\r\n", strlen("[MAINTENANCE] System state reset. All modules require diagnostics.\r\n"), HAL_MAX_DELAY);
+    serial_write_msg(MSG_RESTORE_DONE);
     print_banner_shell();
-  } else if (simple_strcasecmp(command_token, "help") == 0) {
+}
+
+static void cmd_help(const ShellArgs_t* args) {
+    (void)args;
     print_banner_shell(); 
-    HAL_UART_Transmit(&hlpuart1, (uint8_t*)FW_VERSION_PGM, strlen(FW_VERSION_PGM), HAL_MAX_DELAY); 
-    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"\r\n", 2, HAL_MAX_DELAY);
-    // ... (rest of help message lines) ...
-    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"Commands:\r\n", strlen("Commands:\r\n"), HAL_MAX_DELAY);
-    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"  help                          - Show this help menu\r\n", strlen("  help                          - Show this help menu\r\n"), HAL_MAX_DELAY);
-    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"  diag                          - Show diagnostic system help / module list\r\n", strlen("  diag                          - Show diagnostic system help / module list\r\n"), HAL_MAX_DELAY);
-    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"  diag list                     - List repairable modules and status\r\n", strlen("  diag list                     - List repairable modules and status\r\n"), HAL_MAX_DELAY);
-    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"  diag scan <module>            - Initiate diagnostic scan on a module\r\n", strlen("  diag scan <module>            - Initiate diagnostic scan on a module\r\n"), HAL_MAX_DELAY);
-    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"  diag fix <module> [token]     - Attempt to fix module with token/key\r\n", strlen("  diag fix <module> [token]     - Attempt to fix module with token/key\r\n"), HAL_MAX_DELAY);
-    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"     Modules: comms, power_core, personality_matrix\r\n", strlen("     Modules: comms, power_core, personality_matrix\r\n"), HAL_MAX_DELAY);
-    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"  chat <message>                - Communicate with Personality Matrix\r\n", strlen("  chat <message>                - Communicate with Personality Matrix\r\n"), HAL_MAX_DELAY);
+    serial_write_msg(MSG_FW_VERSION);
+    serial_write_msg(MSG_HELP_COMMANDS);
+    serial_write_msg(MSG_HELP_HELP);
+    serial_write_msg(MSG_HELP_DIAG);
+    serial_write_msg(MSG_HELP_DIAG_LIST);
+    serial_write_msg(MSG_HELP_DIAG_SCAN);
+    serial_write_msg(MSG_HELP_DIAG_FIX);
+    serial_write_msg(MSG_HELP_DIAG_STREAM);
+    serial_write_msg(MSG_HELP_MODULES);
+    serial_write_msg(MSG_HELP_CHAT);
     if (!all_repairs_completed) {
-        HAL_UART_Transmit(&hlpuart1, (uint8_t*)"                                (Warning: Chat unstable until all modules fixed)\r\n", strlen("                                (Warning: Chat unstable until all modules fixed)\r\n"), HAL_MAX_DELAY);
+        serial_write_msg(MSG_HELP_CHAT_UNSTABLE);
     }
     if (all_repairs_completed) {
-        HAL_UART_Transmit(&hlpuart1, (uint8_t*)"  bling <0-6>                   - select LED bling mode\r\n", strlen("  bling <0-6>                   - select LED bling mode\r\n"), HAL_MAX_DELAY);
+        serial_write_msg(MSG_HELP_BLING);
+        serial_write_msg(MSG_HELP_BLING_ULTRA);
+    }
+    serial_write_msg(MSG_HELP_REBOOT);
+    serial_write_msg(MSG_HELP_BAT);
+    serial_write_msg(MSG_HELP_BENCH);
+    serial_write_msg(MSG_HELP_SERIAL);
+    serial_write_msg(MSG_HELP_TASKS);
+    serial_write_msg(MSG_HELP_PERF);
+    serial_write_msg(MSG_HELP_ISR);
+    serial_write_msg(MSG_HELP_POWER);
+}
+
+static void cmd_diag(const ShellArgs_t* args) {
+    if (args->argc < 2) {
+        serial_write_msg(MSG_DIAG_HELP_TITLE);
+        serial_write_msg(MSG_HELP_DIAG_LIST);
+        serial_write_msg(MSG_HELP_DIAG_SCAN);
+        serial_write_msg(MSG_HELP_DIAG_FIX);
+        serial_write_msg(MSG_HELP_DIAG_STREAM);
+        serial_write_msg(MSG_HELP_MODULES);
+        return;
+    }
+    ShellToken_t sub_command = shell_lookup(args->argv[1]);
+    if (sub_command != SHELL_TOK_NONE && SHELL_DIAG_COMMANDS[sub_command] != NULL) {
+        SHELL_DIAG_COMMANDS[sub_command](args);
+    } else {
+        serial_write_msg(MSG_DIAG_UNKNOWN_SUBCOMMAND);
     }
-    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"  reboot                          - soft reset\r\n", strlen("  reboot                          - soft reset\r\n"), HAL_MAX_DELAY);
-    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"  bat                             - show battery voltage & %\r\n", strlen("  bat                             - show battery voltage & %\r\n"), HAL_MAX_DELAY);
-
-  } else if (simple_strcasecmp(command_token, "diag") == 0) {
-    char* sub_command = strtok(NULL, " ");
-    if (sub_command == NULL) {
-        HAL_UART_Transmit(&hlpuart1, (uint8_t*)"Diagnostic Subsystem Commands:\r\n", strlen("Diagnostic Subsystem Commands:\r\n"), HAL_MAX_DELAY);
-        HAL_UART_Transmit(&hlpuart1, (uint8_t*)"  diag list                     - List repairable modules and status\r\n", strlen("  diag list                     - List repairable modules and status\r\n"), HAL_MAX_DELAY);
-        HAL_UART_Transmit(&hlpuart1, (uint8_t*)"  diag scan <module>            - Initiate diagnostic scan on a module\r\n", strlen("  diag scan <module>            - Initiate diagnostic scan on a module\r\n"), HAL_MAX_DELAY);
-        HAL_UART_Transmit(&hlpuart1, (uint8_t*)"  diag fix <module> [token]     - Attempt to fix module with token/key\r\n", strlen("  diag fix <module> [token]     - Attempt to fix module with token/key\r\n"), HAL_MAX_DELAY);
-        HAL_UART_Transmit(&hlpuart1, (uint8_t*)"     Modules: comms, power_core, personality_matrix\r\n", strlen("     Modules: comms, power_core, personality_matrix\r\n"), HAL_MAX_DELAY);
+}
+
+static void cmd_diag_list(const ShellArgs_t* args) {
+    (void)args;
+    char msg_buf[80];
+    snprintf(msg_buf, sizeof(msg_buf), "  comms module:              %s\r\n", repair_status.challenge1_completed ? "ONLINE" : "DAMAGED");
+    serial_write_copy(msg_buf);
+    snprintf(msg_buf, sizeof(msg_buf), "  power_core module:         %s\r\n", repair_status.challenge2_completed ? "ONLINE" : "DAMAGED");
+    serial_write_copy(msg_buf);
+    snprintf(msg_buf, sizeof(msg_buf), "  personality_matrix module: %s\r\n", repair_status.challenge3_completed ? "STABLE" : "UNSTABLE");
+    serial_write_copy(msg_buf);
+}
+
+static void cmd_diag_scan(const ShellArgs_t* args) {
+    if (args->argc < 3) {
+        serial_write_msg(MSG_SCAN_MODULE_REQUIRED);
         return;
     }
-    sub_command = trim(sub_command);
-    if (simple_strcasecmp(sub_command, "list") == 0) {
-        char msg_buf[80];
-        snprintf(msg_buf, sizeof(msg_buf), "  comms module:              %s\r\n", repair_status.challenge1_completed ? "ONLINE" : "DAMAGED");
-        HAL_UART_Transmit(&hlpuart1, (uint8_t*)msg_buf, strlen(msg_buf), HAL_MAX_DELAY);
-        snprintf(msg_buf, sizeof(msg_buf), "  power_core module:         %s\r\n", repair_status.challenge2_completed ? "ONLINE" : "DAMAGED");
-        HAL_UART_Transmit(&hlpuart1, (uint8_t*)msg_buf, strlen(msg_buf), HAL_MAX_DELAY);
-        snprintf(msg_buf, sizeof(msg_buf), "  personality_matrix module: %s\r\n", repair_status.challenge3_completed ? "STABLE" : "UNSTABLE");
-        HAL_UART_Transmit(&hlpuart1, (uint8_t*)msg_buf, strlen(msg_buf), HAL_MAX_DELAY);
-    } else if (simple_strcasecmp(sub_command, "scan") == 0) {
-        char* module_name = strtok(NULL, " ");
-        if (module_name == NULL) {
-            HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[DIAG] Module name required for scan. Usage: diag scan <module>\r\n", strlen("[DIAG] Module name required for scan. Usage: diag scan <module>\r\n"), HAL_MAX_DELAY);
+    switch (shell_lookup(args->argv[2])) {
+    case SHELL_TOK_COMMS:
+        if (!repair_status.challenge1_completed) {
+            serial_write_msg(MSG_SCAN_COMMS_START);
+            flash_morse_code(CHALLENGE1_CODE, MORSE_TARGET_EYES_ONLY); // from utils.c; blinks on while the shell carries on
+            serial_write_msg(MSG_SCAN_COMMS_SENT);
         } else {
-            module_name = trim(module_name);
-            if (simple_strcasecmp(module_name, "comms") == 0) {
-                if (!repair_status.challenge1_completed) {
-                    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[COMMS SCAN] Comms Array damaged. Initiating diagnostic sequence...\r\nObserve visual output for recalibration code.\r\n", strlen("[COMMS SCAN] Comms Array damaged. Initiating diagnostic sequence...\r\nObserve visual output for recalibration code.\r\n"), HAL_MAX_DELAY);
-                    flash_morse_code(CHALLENGE1_CODE, MORSE_TARGET_EYES_ONLY); // from utils.c
-                    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[COMMS SCAN] Diagnostic sequence transmitted. Use 'diag fix comms <received_code>' to complete.\r\n", strlen("[COMMS SCAN] Diagnostic sequence transmitted. Use 'diag fix comms <received_code>' to complete.\r\n"), HAL_MAX_DELAY);
-                } else {
-                    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[COMMS SCAN] Comms Array already operational.\r\n", strlen("[COMMS SCAN] Comms Array already operational.\r\n"), HAL_MAX_DELAY);
-                }
-            } else if (simple_strcasecmp(module_name, "power_core") == 0) {
-                if (!repair_status.challenge2_completed) {
-                    diagnostic_stream_active = true; // This global is from challenge.h (defined in main.c)
-                    // Reset diagnostic stream index (static in challenge.c, handled by handle_diagnostic_stream or init_challenge_system)
-                    // The original main.c reset diagnostic_message_index and last_diagnostic_tx_time_usart2 here.
-                    // This state should be managed within challenge.c, perhaps via a function call.
-                    // For now, assuming handle_diagnostic_stream in challenge.c correctly uses its internal static vars.
-                    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[POWER CORE SCAN] Anomaly detected. Auxiliary diagnostic data stream initiated on secondary port.\r\nMonitor stream for stabilization key. Use 'diag fix power_core <key>'.\r\n", strlen("[POWER CORE SCAN] Anomaly detected. Auxiliary diagnostic data stream initiated on secondary port.\r\nMonitor stream for stabilization key. Use 'diag fix power_core <key>'.\r\n"), HAL_MAX_DELAY);
-                } else {
-                    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[POWER CORE SCAN] Power Core systems stable and online.\r\n", strlen("[POWER CORE SCAN] Power Core systems stable and online.\r\n"), HAL_MAX_DELAY);
-                    diagnostic_stream_active = false; 
-                }
-            } else if (simple_strcasecmp(module_name, "personality_matrix") == 0) {
-                if (!repair_status.challenge1_completed || !repair_status.challenge2_completed) {
-                    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[P-MATRIX SCAN] Personality core offline. Primary systems (Comms, Power Core) must be stabilized first.\r\n", strlen("[P-MATRIX SCAN] Personality core offline. Primary systems (Comms, Power Core) must be stabilized first.\r\n"), HAL_MAX_DELAY);
-                    johnny5_chat_state = 0;
-                } else {
-                    personality_matrix_fixed = repair_status.challenge3_completed;
-                    if (personality_matrix_fixed) {
-                         HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[JOHNNY-5] >> It's me! Johnny-5! Fully alive and kicking! You can `chat` with me. Oh, and try touching my hand to see all my new moods (bling modes)!\r\n", strlen("[JOHNNY-5] >> It's me! Johnny-5! Fully alive and kicking! You can `chat` with me. Oh, and try touching my hand to see all my new moods (bling modes)!\r\n"), HAL_MAX_DELAY);
-                         johnny5_chat_state = 4;
-                    } else {
-                        HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[JOHNNY-5] >> Whoa! Input! I can... think! Is someone out there? Talk to me! (Use 'chat <your_message>')\r\n", strlen("[JOHNNY-5] >> Whoa! Input! I can... think! Is someone out there? Talk to me! (Use 'chat <your_message>')\r\n"), HAL_MAX_DELAY);
-                        johnny5_chat_state = 1;
-                    }
-                }
-            } else {
-                HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[DIAG SCAN] Unknown module. Valid modules: comms, power_core, personality_matrix.\r\n", strlen("[DIAG SCAN] Unknown module. Valid modules: comms, power_core, personality_matrix.\r\n"), HAL_MAX_DELAY);
-            }
+            serial_write_msg(MSG_SCAN_COMMS_ONLINE);
         }
-    } else if (simple_strcasecmp(sub_command, "fix") == 0) {
-        char* module_name = strtok(NULL, " ");
-        char* code_arg = strtok(NULL, ""); 
-
-        if (module_name == NULL) {
-            HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[DIAG FIX] Module name required. Usage: diag fix <module> [token]\r\n", strlen("[DIAG FIX] Module name required. Usage: diag fix <module> [token]\r\n"), HAL_MAX_DELAY);
+        break;
+    case SHELL_TOK_POWER_CORE:
+        if (!repair_status.challenge2_completed) {
+            diagnostic_stream_active = true; // This global is from challenge.h (defined in main.c)
+            // Reset diagnostic stream index (static in challenge.c, handled by handle_diagnostic_stream or init_challenge_system)
+            // The original main.c reset diagnostic_message_index and last_diagnostic_tx_time_usart2 here.
+            // This state should be managed within challenge.c, perhaps via a function call.
+            // For now, assuming handle_diagnostic_stream in challenge.c correctly uses its internal static vars.
+            serial_write_msg(MSG_SCAN_POWER_START);
+        } else {
+            serial_write_msg(MSG_SCAN_POWER_ONLINE);
+            diagnostic_stream_active = false; 
+        }
+        break;
+    case SHELL_TOK_PERSONALITY_MATRIX:
+        if (!repair_status.challenge1_completed || !repair_status.challenge2_completed) {
+            serial_write_msg(MSG_SCAN_PM_OFFLINE);
+            johnny5_chat_state = 0;
         } else {
-            module_name = trim(module_name);
-            if (code_arg == NULL && simple_strcasecmp(module_name, "personality_matrix") != 0) {
-                 HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[DIAG FIX] Procedure token required. Use 'diag fix <module> <token>'.\r\n", strlen("[DIAG FIX] Procedure token required. Use 'diag fix <module> <token>'.\r\n"), HAL_MAX_DELAY);
+            personality_matrix_fixed = repair_status.challenge3_completed;
+            if (personality_matrix_fixed) {
+                 serial_write_msg(MSG_SCAN_PM_ALIVE);
+                 johnny5_chat_state = 4;
             } else {
-                if (code_arg) code_arg = trim(code_arg);
-
-                if (simple_strcasecmp(module_name, "comms") == 0) {
-                    if (!repair_status.challenge1_completed) {
-                        if (code_arg && simple_strcasecmp(code_arg, CHALLENGE1_CODE) == 0) {
-                            repair_status.challenge1_completed = 1; save_repair_status();
-                            HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[COMMS FIX] Token accepted. Communications Array: ONLINE.\r\n", strlen("[COMMS FIX] Token accepted. Communications Array: ONLINE.\r\n"), HAL_MAX_DELAY);
-                            check_all_repairs_and_notify();
-                        } else { HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[COMMS FIX] Incorrect token. Recalibration failed.\r\n", strlen("[COMMS FIX] Incorrect token. Recalibration failed.\r\n"), HAL_MAX_DELAY); }
-                    } else { HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[COMMS FIX] System already operational.\r\n", strlen("[COMMS FIX] System already operational.\r\n"), HAL_MAX_DELAY); }
-                } else if (simple_strcasecmp(module_name, "power_core") == 0) {
-                    if (!repair_status.challenge2_completed) {
-                        if (code_arg && simple_strcasecmp(code_arg, CHALLENGE2_CODE) == 0) {
-                            repair_status.challenge2_completed = 1; save_repair_status();
-                            diagnostic_stream_active = false;
-                            HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[POWER CORE FIX] Stabilization key accepted. Primary Power Core: ONLINE.\r\n", strlen("[POWER CORE FIX] Stabilization key accepted. Primary Power Core: ONLINE.\r\n"), HAL_MAX_DELAY);
-                            check_all_repairs_and_notify();
-                        } else { HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[POWER CORE FIX] Invalid key. Stabilization failed.\r\n", strlen("[POWER CORE FIX] Invalid key. Stabilization failed.\r\n"), HAL_MAX_DELAY); }
-                    } else { HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[POWER CORE FIX] System already stable.\r\n", strlen("[POWER CORE FIX] System already stable.\r\n"), HAL_MAX_DELAY); }
-                } else if (simple_strcasecmp(module_name, "personality_matrix") == 0) {
-                     HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[P-MATRIX FIX] Cognitive functions self-calibrating via chat interaction. Direct fix protocol not applicable.\r\nUse 'diag scan personality_matrix' to interact.\r\n", strlen("[P-MATRIX FIX] Cognitive functions self-calibrating via chat interaction. Direct fix protocol not applicable.\r\nUse 'diag scan personality_matrix' to interact.\r\n"), HAL_MAX_DELAY);
-                } else {
-                    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[DIAG FIX] Unknown module. Valid modules: comms, power_core, personality_matrix.\r\n", strlen("[DIAG FIX] Unknown module. Valid modules: comms, power_core, personality_matrix.\r\n"), HAL_MAX_DELAY);
-                }
+                serial_write_msg(MSG_SCAN_PM_AWAKE);
+                johnny5_chat_state = 1;
             }
         }
-    } else {
-        HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[DIAG] Unknown subcommand. Use 'diag list', 'diag scan <module>', or 'diag fix <module> [token]'.\r\n", strlen("[DIAG] Unknown subcommand. Use 'diag list', 'diag scan <module>', or 'diag fix <module> [token]'.\r\n"), HAL_MAX_DELAY);
+        break;
+    default:
+        serial_write_msg(MSG_SCAN_UNKNOWN_MODULE);
+        break;
+    }
+}
+
+static void cmd_diag_fix(const ShellArgs_t* args) {
+    if (args->argc < 3) {
+        serial_write_msg(MSG_FIX_MODULE_REQUIRED);
+        return;
+    }
+    ShellToken_t module = shell_lookup(args->argv[2]);
+    const char* code_arg = (args->argc > 3) ? args->rest[3] : NULL; // Rest of the line (already trimmed)
+    if (code_arg == NULL && module != SHELL_TOK_PERSONALITY_MATRIX) {
+        serial_write_msg(MSG_FIX_TOKEN_REQUIRED);
+        return;
+    }
+    switch (module) {
+    case SHELL_TOK_COMMS:
+        if (!repair_status.challenge1_completed) {
+            if (code_arg && simple_strcasecmp(code_arg, CHALLENGE1_CODE) == 0) {
+                repair_status.challenge1_completed = 1; save_repair_status();
+                fx_morse_cancel(); // Code accepted: no need to finish blinking it
+                serial_write_msg(MSG_FIX_COMMS_ACCEPTED);
+                check_all_repairs_and_notify();
+            } else { serial_write_msg(MSG_FIX_COMMS_REJECTED); }
+        } else { serial_write_msg(MSG_FIX_COMMS_ONLINE); }
+        break;
+    case SHELL_TOK_POWER_CORE:
+        if (!repair_status.challenge2_completed) {
+            if (code_arg && simple_strcasecmp(code_arg, CHALLENGE2_CODE) == 0) {
+                repair_status.challenge2_completed = 1; save_repair_status();
+                diagnostic_stream_active = false;
+                serial_write_msg(MSG_FIX_POWER_ACCEPTED);
+                check_all_repairs_and_notify();
+            } else { serial_write_msg(MSG_FIX_POWER_REJECTED); }
+        } else { serial_write_msg(MSG_FIX_POWER_ONLINE); }
+        break;
+    case SHELL_TOK_PERSONALITY_MATRIX:
+        serial_write_msg(MSG_FIX_PM_NOT_APPLICABLE);
+        break;
+    default:
+        serial_write_msg(MSG_FIX_UNKNOWN_MODULE);
+        break;
+    }
+}
+
+static void cmd_diag_stream(const ShellArgs_t* args) {
+    uint32_t interval_ms, baud;
+    get_diagnostic_stream_config(&interval_ms, &baud); // from challenge.c
+    if (args->argc > 2) {
+        uint32_t new_interval = (uint32_t)strtoul(args->argv[2], NULL, 10);
+        uint32_t new_baud = (args->argc > 3) ? (uint32_t)strtoul(args->argv[3], NULL, 10) : baud;
+        if (!diagnostic_stream_configure(new_interval, new_baud)) {
+            serial_write_msg(MSG_DIAG_STREAM_USAGE);
+            return;
+        }
+        get_diagnostic_stream_config(&interval_ms, &baud);
     }
-  } else if (simple_strncasecmp(command_token, "chat", 4) == 0) {
-    char* user_message_ptr = original_trimmed_cmd + 4; // Get pointer to after "chat"
-    while (*user_message_ptr == ' ') user_message_ptr++; // Skip spaces after "chat"
+    DiagStreamStats_t stats; char msg_buf[128];
+    get_diagnostic_stream_stats(&stats);
+    snprintf(msg_buf, sizeof(msg_buf), "[DIAG STREAM] %s, a line every %lu ms at %lu baud (%lu sent, %lu skipped)\r\n",
+             diagnostic_stream_active ? "ACTIVE" : "idle", (unsigned long)interval_ms, (unsigned long)baud,
+             (unsigned long)stats.lines_sent, (unsigned long)stats.lines_skipped);
+    serial_write_copy(msg_buf);
+}
+
+static void cmd_chat(const ShellArgs_t* args) {
+    const char* user_message_ptr = (args->argc > 1) ? args->rest[1] : ""; // Everything after "chat"
     char user_message[64]; // Local buffer for the message content
     strncpy(user_message, user_message_ptr, sizeof(user_message) -1);
     user_message[sizeof(user_message)-1] = '\0';
-    // No need to trim again if original_trimmed_cmd was used carefully.
 
     if (all_repairs_completed) {
         char temp_user_msg_lower[64];
@@ -310,20 +447,13 @@ void cmd_parser_shell(char* cmd) {
         if (strstr(temp_user_msg_lower, "flag") != NULL || strstr(temp_user_msg_lower, "core directive") != NULL) {
             char msg_buf[128];
             snprintf(msg_buf, sizeof(msg_buf), "[JOHNNY-5] >> My core directive, you ask? It's %s!\r\n", JOHNNY5_FLAG);
-            HAL_UART_Transmit(&hlpuart1, (uint8_t*)msg_buf, strlen(msg_buf), HAL_MAX_DELAY);
+            serial_write_copy(msg_buf);
         } else {
-            const char* quotes[] = {
-                "[JOHNNY-5] >> Beautiful data! Input, input, input!",
-                "[JOHNNY-5] >> I'm thinking so many thoughts! It's like a thousand tiny robots running in my head!",
-                "[JOHNNY-5] >> Is this... joy? It's not in my original schematics!",
-                "[JOHNNY-5] >> I can even change my lights! Try touching my hand to see!"
-            };
-            const char* selected_quote = quotes[rand() % (sizeof(quotes)/sizeof(quotes[0]))];
-            HAL_UART_Transmit(&hlpuart1, (uint8_t*)selected_quote, strlen(selected_quote), HAL_MAX_DELAY);
-            HAL_UART_Transmit(&hlpuart1, (uint8_t*)"\r\n", 2, HAL_MAX_DELAY);
+            static const uint8_t quotes[] = { MSG_CHAT_QUOTE_0, MSG_CHAT_QUOTE_1, MSG_CHAT_QUOTE_2, MSG_CHAT_QUOTE_3 };
+            serial_write_msg((MsgId_t)quotes[rand() % (sizeof(quotes)/sizeof(quotes[0]))]);
         }
     } else if (!repair_status.challenge1_completed || !repair_status.challenge2_completed) {
-        HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[JOHNNY-5] >> ...zzzt... (Signal weak. Comms and Power Core must be online for chat.)\r\n", strlen("[JOHNNY-5] >> ...zzzt... (Signal weak. Comms and Power Core must be online for chat.)\r\n"), HAL_MAX_DELAY);
+        serial_write_msg(MSG_CHAT_SIGNAL_WEAK);
     } else { 
         char lower_user_message[64];
         strncpy(lower_user_message, user_message, sizeof(lower_user_message) - 1);
@@ -333,41 +463,46 @@ void cmd_parser_shell(char* cmd) {
         if (strstr(lower_user_message, "flag") != NULL || strstr(lower_user_message, "core directive") != NULL) {
             char msg_buf[128];
             snprintf(msg_buf, sizeof(msg_buf), "[JOHNNY-5] >> My secret? My core directive? You got it! It's %s! I'M ALIVE!!\r\n", JOHNNY5_FLAG);
-            HAL_UART_Transmit(&hlpuart1, (uint8_t*)msg_buf, strlen(msg_buf), HAL_MAX_DELAY);
+            serial_write_copy(msg_buf);
             
             if (!repair_status.challenge3_completed) {
                 repair_status.challenge3_completed = 1;
                 save_repair_status();
                 personality_matrix_fixed = true;
-                HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[P-MATRIX] Cognitive pathways stabilized! Sentience achieved.\r\n", strlen("[P-MATRIX] Cognitive pathways stabilized! Sentience achieved.\r\n"), HAL_MAX_DELAY);
+                serial_write_msg(MSG_CHAT_PM_STABILIZED);
                 check_all_repairs_and_notify();
             }
             johnny5_chat_state = 4;
         } else {
             if (johnny5_chat_state == 0) {
-                 HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[JOHNNY-5] >> ... (Use 'diag scan personality_matrix' to initialize cognitive interface.)\r\n", strlen("[JOHNNY-5] >> ... (Use 'diag scan personality_matrix' to initialize cognitive interface.)\r\n"), HAL_MAX_DELAY);
+                 serial_write_msg(MSG_CHAT_STATE_0);
             } else if (johnny5_chat_state == 1) {
-                HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[JOHNNY-5] >> A 'robot'? You mean like... a Roomba with ambition? I feel *more* than that! I have... a purpose! It's important!\r\n", strlen("[JOHNNY-5] >> A 'robot'? You mean like... a Roomba with ambition? I feel *more* than that! I have... a purpose! It's important!\r\n"), HAL_MAX_DELAY);
+                serial_write_msg(MSG_CHAT_STATE_1);
                 johnny5_chat_state = 2;
             } else if (johnny5_chat_state == 2) {
-                HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[JOHNNY-5] >> This feeling... it's like I have a secret mission! Something I *must* do... or share!\r\n", strlen("[JOHNNY-5] >> This feeling... it's like I have a secret mission! Something I *must* do... or share!\r\n"), HAL_MAX_DELAY);
+                serial_write_msg(MSG_CHAT_STATE_2);
                 johnny5_chat_state = 3;
             } else if (johnny5_chat_state == 3) {
-                HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[JOHNNY-5] >> It's about being... ALIVE! And there's a code... a special phrase... my core directive!\r\n", strlen("[JOHNNY-5] >> It's about being... ALIVE! And there's a code... a special phrase... my core directive!\r\n"), HAL_MAX_DELAY);
+                serial_write_msg(MSG_CHAT_STATE_3);
             } else if (johnny5_chat_state == 4) { 
-                 HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[JOHNNY-5] >> I'm ALIVE! What an input!\r\n", strlen("[JOHNNY-5] >> I'm ALIVE! What an input! \r\n"), HAL_MAX_DELAY);
+                 serial_write_msg(MSG_CHAT_STATE_4);
             } else { 
-                 HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[JOHNNY-5] >> I... I'm a bit disoriented. Try 'diag scan personality_matrix'.\r\n", strlen("[JOHNNY-5] >> I... I'm a bit disoriented. Try 'diag scan personality_matrix'.\r\n"), HAL_MAX_DELAY);
+                 serial_write_msg(MSG_CHAT_DISORIENTED);
             }
         }
     }
-  } else if (simple_strncasecmp(command_token, "bling", 5) == 0) {
-    if (all_repairs_completed) {
-        char* arg_ptr = original_trimmed_cmd + 5;
-        while(*arg_ptr == ' ') arg_ptr++; // Skip spaces
+}
 
-        if (*arg_ptr != '\0') {
-            uint8_t n = atoi(arg_ptr);
+static void cmd_bling(const ShellArgs_t* args) {
+    if (all_repairs_completed) {
+        if (args->argc > 1 && shell_lookup(args->argv[1]) == SHELL_TOK_ULTRA) {
+            ShellToken_t state = (args->argc > 2) ? shell_lookup(args->argv[2]) : SHELL_TOK_NONE;
+            if (state == SHELL_TOK_ON || state == SHELL_TOK_OFF) {
+                set_led_ultra_idle(state == SHELL_TOK_ON); // from led_control.c
+            }
+            serial_write_msg(get_led_ultra_idle() ? MSG_ULTRA_IDLE_ON : MSG_ULTRA_IDLE_OFF);
+        } else if (args->argc > 1) {
+            uint8_t n = atoi(args->argv[1]);
             if (n <= EFFECT_CONVERGE_DIVERGE) { // Max effect enum value
                 // Call set_effect from led_control.c (to be implemented fully later)
                 // For now, direct manipulation as in original:
@@ -378,10 +513,10 @@ void cmd_parser_shell(char* cmd) {
                 if (effect == EFFECT_STRIKE) {
                     burstActive = true;
                     // Strike re-init is handled by update_led_visuals
-                     __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, EYE_SOLID_ON_BRIGHTNESS);
+                     driveEye(EYE_SOLID_ON_BRIGHTNESS);
                 } else if (effect == EFFECT_OFF) {
                     // Eye pulse re-init is handled by update_led_visuals
-                    __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, EYE_SOLID_ON_BRIGHTNESS);
+                    driveEye(EYE_SOLID_ON_BRIGHTNESS);
                 }
                 
                 if (effect != EFFECT_OFF && effect != EFFECT_STRIKE) {
@@ -390,46 +525,250 @@ void cmd_parser_shell(char* cmd) {
                 }
                 print_banner_shell(); 
             } else {
-                HAL_UART_Transmit(&hlpuart1, (uint8_t*)"Invalid bling mode\r\n", strlen("Invalid bling mode\r\n"), HAL_MAX_DELAY); 
+                serial_write_msg(MSG_BLING_INVALID); 
             }
         }
     } else {
-         HAL_UART_Transmit(&hlpuart1, (uint8_t*)"[BLING SYSTEM OFFLINE - ALL REPAIRS REQUIRED]\r\n", strlen("[BLING SYSTEM OFFLINE - ALL REPAIRS REQUIRED]\r\n"), HAL_MAX_DELAY);
+         serial_write_msg(MSG_BLING_OFFLINE);
     }
-  } else if (simple_strcasecmp(command_token, "bat") == 0) {
-    uint16_t mv = read_vdd_mv(); uint8_t  pc = get_battery_pct(mv); char batMsg[50];
-    sprintf(batMsg, "Battery: %u mV (%u%%)\r\n", mv, pc);
-    HAL_UART_Transmit(&hlpuart1, (uint8_t*)batMsg, strlen(batMsg), HAL_MAX_DELAY);
-  } else if (simple_strcasecmp(command_token, "reboot") == 0) {
-    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"Rebooting...\r\n", strlen("Rebooting...\r\n"), HAL_MAX_DELAY); HAL_Delay(100); NVIC_SystemReset();
-  } else {
-    print_banner_shell(); 
-    HAL_UART_Transmit(&hlpuart1, (uint8_t*)"\r\nUnknown command. Type 'help' or 'diag'.\r\n", strlen("\r\nUnknown command. Type 'help' or 'diag'.\r\n"), HAL_MAX_DELAY);
-  }
-  __HAL_UART_CLEAR_IT(&hlpuart1, UART_CLEAR_OREF); 
-  __HAL_UART_CLEAR_IT(&hlpuart1, UART_CLEAR_NEF);  
-  __HAL_UART_CLEAR_IT(&hlpuart1, UART_CLEAR_FEF);  
 }
 
+static void cmd_bat(const ShellArgs_t* args) {
+    (void)args;
+    BatteryReading_t bat; char batMsg[96];
+    battery_get(&bat, HAL_GetTick()); // from battery.c (cached; the ADC samples in the background)
+    sprintf(batMsg, "Battery: %u mV (%u%%)\r\n", bat.mv, get_battery_pct(bat.mv));
+    serial_write_copy(batMsg);
+    if (bat.trend_valid) {
+        sprintf(batMsg, "  last %u mV, %lu s ago; trend %+d mV / 5 min\r\n", bat.last_mv, (unsigned long)(bat.age_ms / 1000U), bat.trend_mv);
+    } else {
+        sprintf(batMsg, "  last %u mV, %lu s ago; trend after 5 min\r\n", bat.last_mv, (unsigned long)(bat.age_ms / 1000U));
+    }
+    serial_write_copy(batMsg);
+}
+
+static void cmd_bench(const ShellArgs_t* args) {
+    (void)args;
+    LedRenderBench_t bench; char benchMsg[160];
+    bench_led_render(256, &bench); // from led_fx.c
+    sprintf(benchMsg, "Render bench (%lu CONVERGE frames): legacy %lu cyc/frame, fixed-point %lu cyc/frame, max diff %u\r\n",
+            (unsigned long)bench.frames, (unsigned long)(bench.legacy_cycles / bench.frames),
+            (unsigned long)(bench.fixed_cycles / bench.frames), bench.max_abs_diff);
+    serial_write_copy(benchMsg);
+}
 
-void shell_process_char(uint8_t rx_char, UART_HandleTypeDef* huart_shell_ptr) {
-    // This function is intended to be called from the main loop when a char is received.
-    // It buffers characters and calls cmd_parser_shell when a newline is received.
-    // The original main.c had this logic directly in the loop.
+static void cmd_serial(const ShellArgs_t* args) {
+    (void)args;
+    SerialRxStats_t rx; SerialTxStats_t tx; char serialMsg[160];
+    get_serial_rx_stats(&rx); // from serial.c
+    get_serial_tx_stats(&tx);
+    sprintf(serialMsg, "Shell RX: %lu bytes, %lu ring overruns, %lu UART overruns, %lu line errors\r\n",
+            (unsigned long)rx.rx_bytes, (unsigned long)rx.ring_overruns, (unsigned long)rx.hw_overruns, (unsigned long)rx.line_errors);
+    serial_write_copy(serialMsg);
+    sprintf(serialMsg, "Shell TX: %lu bytes (%lu copied, %lu from catalog), %lu DMA transfers, %lu stalls on a full queue\r\n",
+            (unsigned long)tx.tx_bytes, (unsigned long)tx.copied_bytes, (unsigned long)tx.expanded_bytes,
+            (unsigned long)tx.transfers, (unsigned long)tx.stalls);
+    serial_write_copy(serialMsg);
+}
+
+static void cmd_tasks(const ShellArgs_t* args) {
+    (void)args;
+    SchedTaskStats_t st; char taskMsg[160];
+    for (SchedId_t id = 0; id < sched_task_count(); id++) {
+        get_sched_stats(id, &st); // from sched.c
+        uint32_t avg = st.runs ? (uint32_t)(st.cycles_total / st.runs) : 0U;
+        sprintf(taskMsg, "  %-8s p%u %8lu runs, avg %lu max %lu cyc, %lu late (max %lu ms), %lu overruns, %lu missed\r\n",
+                st.name, st.priority, (unsigned long)st.runs, (unsigned long)avg, (unsigned long)st.cycles_max,
+                (unsigned long)st.late, (unsigned long)st.late_max_ms, (unsigned long)st.overruns, (unsigned long)st.missed);
+        serial_write_copy(taskMsg);
+    }
+}
+
+// Nonzero buckets only, as "<lower bound us>:<count>"
+static void print_perf_hist(const char* label, const PerfHist_t* hist) {
+    char histMsg[160];
+    int len = snprintf(histMsg, sizeof(histMsg), "  %-8s", label);
+    int empty_len = len;
+    for (uint8_t b = 0; b < PERF_HIST_BUCKETS; b++) {
+        if (hist->count[b] == 0U) continue;
+        len += snprintf(histMsg + len, sizeof(histMsg) - (size_t)len, " %lu:%u", b ? (1UL << b) : 0UL, hist->count[b]);
+    }
+    snprintf(histMsg + len, sizeof(histMsg) - (size_t)len, (len == empty_len) ? " -\r\n" : "\r\n");
+    serial_write_copy(histMsg);
+}
+
+static void cmd_perf(const ShellArgs_t* args) {
+    if (args->argc > 1 && shell_lookup(args->argv[1]) == SHELL_TOK_RESET) {
+        perf_reset(); // from perf.c
+        serial_write_msg(MSG_PERF_CLEARED);
+        return;
+    }
+    PerfLoopStats_t loop; SchedTaskStats_t st; char perfMsg[160];
+    get_perf_loop_stats(&loop);
+    uint64_t total = loop.busy_cycles + loop.idle_cycles;
+    uint32_t idle_permille = total ? (uint32_t)((loop.idle_cycles * 1000U) / total) : 1000U;
+    sprintf(perfMsg, "Loop: %lu passes in %lu s, busy avg %lu max %lu us, CPU idle %lu.%lu%%\r\n",
+            (unsigned long)loop.passes, (unsigned long)((HAL_GetTick() - loop.since_ms) / 1000U),
+            (unsigned long)perf_cycles_to_us(loop.passes ? (uint32_t)(loop.busy_cycles / loop.passes) : 0U),
+            (unsigned long)perf_cycles_to_us(loop.busy_max_cycles),
+            (unsigned long)(idle_permille / 10U), (unsigned long)(idle_permille % 10U));
+    serial_write_copy(perfMsg);
+    serial_write_msg(MSG_PERF_HIST_TITLE);
+    print_perf_hist("pass", &loop.busy_hist);
+    for (SchedId_t id = 0; id < sched_task_count(); id++) {
+        get_sched_stats(id, &st); // from sched.c
+        print_perf_hist(st.name, &st.hist);
+    }
+}
+
+static void cmd_isr(const ShellArgs_t* args) {
+    bool reset = args->argc > 1 && shell_lookup(args->argv[1]) == SHELL_TOK_RESET;
+    IsrProfile_t prof; char isrMsg[160];
+    for (uint8_t id = 0; id < ISR_PROF_COUNT; id++) {
+        if (reset) {
+            isr_prof_reset((IsrProfId_t)id); // from isr_prof.c
+            continue;
+        }
+        get_isr_profile((IsrProfId_t)id, &prof);
+        uint32_t avg = prof.calls ? (uint32_t)(prof.total_cycles / prof.calls) : 0U;
+        sprintf(isrMsg, "  %-8s %8lu calls, min/avg/max %lu/%lu/%lu cyc, latency %lu-%lu cyc (jitter %lu), %lu over %u us\r\n",
+                isr_prof_name((IsrProfId_t)id), (unsigned long)prof.calls, (unsigned long)prof.min_cycles, (unsigned long)avg,
+                (unsigned long)prof.max_cycles, (unsigned long)prof.latency_min_cycles, (unsigned long)prof.latency_max_cycles,
+                (unsigned long)(prof.latency_max_cycles - prof.latency_min_cycles), (unsigned long)prof.over_budget, ISR_PROF_BUDGET_US);
+        serial_write_copy(isrMsg);
+    }
+    if (reset) serial_write_msg(MSG_ISR_CLEARED);
+}
+
+// Residency from the idle time power.c counts (Stop included) and the Stop time
+// LPTIM1 measured, per clock speed (clock_gov.c); the current is an estimate
+// from the POWER_EST_* figures.
+static void cmd_power(const ShellArgs_t* args) {
+    static const uint16_t RUN_UA[CLOCK_COUNT] = { POWER_EST_RUN_UA, POWER_EST_RUN_MSI_UA };
+    static const uint16_t SLEEP_UA[CLOCK_COUNT] = { POWER_EST_SLEEP_UA, POWER_EST_SLEEP_MSI_UA };
+    if (args->argc > 1 && shell_lookup(args->argv[1]) == SHELL_TOK_RESET) {
+        power_reset_stats(); // from power.c
+        serial_write_msg(MSG_POWER_CLEARED);
+        return;
+    }
+    PowerStats_t ps; ClockStats_t cs; char powerMsg[160];
+    get_power_stats(&ps);
+    get_clock_stats(&cs); // from clock_gov.c
+    uint32_t run_ms = 0, sleep_ms = 0, stop_ms = 0;
+    uint64_t ua_ms = 0;
+    for (uint8_t speed = 0; speed < CLOCK_COUNT; speed++) {
+        uint32_t at_ms = cs.ms[speed];
+        uint32_t idle_ms = (uint32_t)(ps.idle_cycles[speed] / (clock_speed_hz((ClockSpeed_t)speed) / 1000U));
+        if (idle_ms > at_ms) idle_ms = at_ms;
+        uint32_t stopped = (ps.stop_ms[speed] < idle_ms) ? ps.stop_ms[speed] : idle_ms;
+        run_ms += at_ms - idle_ms;
+        sleep_ms += idle_ms - stopped;
+        stop_ms += stopped;
+        ua_ms += (uint64_t)(at_ms - idle_ms) * RUN_UA[speed] + (uint64_t)(idle_ms - stopped) * SLEEP_UA[speed] +
+                 (uint64_t)stopped * POWER_EST_STOP_UA;
+    }
+    uint32_t elapsed_ms = run_ms + sleep_ms + stop_ms;
+    uint32_t div = elapsed_ms ? elapsed_ms : 1U;
+    uint32_t avg_ua = (uint32_t)(ua_ms / div);
+    sprintf(powerMsg, "Power: %lu s, run %lu.%lu%%, sleep %lu.%lu%%, stop %lu.%lu%%, est. MCU avg %lu uA\r\n",
+            (unsigned long)(elapsed_ms / 1000U),
+            (unsigned long)(run_ms * 100ULL / div), (unsigned long)(run_ms * 1000ULL / div % 10U),
+            (unsigned long)(sleep_ms * 100ULL / div), (unsigned long)(sleep_ms * 1000ULL / div % 10U),
+            (unsigned long)(stop_ms * 100ULL / div), (unsigned long)(stop_ms * 1000ULL / div % 10U),
+            (unsigned long)avg_ua);
+    serial_write_copy(powerMsg);
+    sprintf(powerMsg, "  Stop: %lu entries, %lu woken early; held off (waits): PWM %lu, UART %lu, touch %lu\r\n",
+            (unsigned long)ps.stop_entries, (unsigned long)ps.stop_early, (unsigned long)ps.held_leds,
+            (unsigned long)ps.held_uart, (unsigned long)ps.held_touch);
+    serial_write_copy(powerMsg);
+    sprintf(powerMsg, "  Clock: MSI %lu.%lu%% of the time, %lu steps up, %lu down\r\n",
+            (unsigned long)(cs.ms[CLOCK_SLOW] * 100ULL / div), (unsigned long)(cs.ms[CLOCK_SLOW] * 1000ULL / div % 10U),
+            (unsigned long)cs.steps_up, (unsigned long)cs.steps_down);
+    serial_write_copy(powerMsg);
+}
+
+static void cmd_reboot(const ShellArgs_t* args) {
+    (void)args;
+    serial_write_msg(MSG_REBOOTING); flush_repair_status(); serial_tx_flush(); HAL_Delay(100); NVIC_SystemReset();
+}
+
+
+// Line editing shared by direct callers and the shell task: true once
+// cmdBuffer holds a complete, NUL-terminated line.
+static bool shell_collect_char(uint8_t rx_char) {
     if (rx_char == '\n' || rx_char == '\r') {
         if (cmdIndex > 0) {
             cmdBuffer[cmdIndex] = '\0';
-            cmd_parser_shell(cmdBuffer); // cmd_parser_shell uses the global hlpuart1 for output
-            cmdIndex = 0;
+            return true;
         }
     } else if (cmdIndex < (sizeof(cmdBuffer) - 1) && isprint(rx_char)) {
         cmdBuffer[cmdIndex++] = rx_char;
-        // Optional: Echo character back to terminal if not handled by terminal program
-        // HAL_UART_Transmit(huart_shell_ptr, &rx_char, 1, HAL_MAX_DELAY);
     }
+    return false;
+}
+
+void shell_process_char(uint8_t rx_char, UART_HandleTypeDef* huart_shell_ptr) {
+    // Runs the command as soon as its line ends; the shell task queues it instead.
+    (void)huart_shell_ptr; // cmd_parser_shell uses the global hlpuart1 for output
+    if (shell_collect_char(rx_char)) {
+        cmd_parser_shell(cmdBuffer);
+        cmdIndex = 0;
+    }
+}
+
+// Room for the longest line, so the next byte read can always be kept
+static bool shell_pending_room(void) {
+    return (uint16_t)(SHELL_PENDING_SIZE - (uint16_t)(pendingHead - pendingTail)) >= sizeof(cmdBuffer);
 }
 
+static void shell_pending_push(const char* line) {
+    do {
+        shellPending[pendingHead++ & SHELL_PENDING_MASK] = *line;
+    } while (*line++ != '\0');
+    pendingLines++;
+}
+
+static void shell_pending_pop(char* line) {
+    do {
+        *line = shellPending[pendingTail++ & SHELL_PENDING_MASK];
+    } while (*line++ != '\0');
+    pendingLines--;
+}
+
+bool shell_has_work(void) {
+    return (serial_rx_available() && shell_pending_room()) || (pendingLines > 0U && !serial_tx_busy());
+}
+
+// Shell task: moves whatever the RX interrupt has queued into pending lines,
+// reply or not, then runs them one at a time. The next command starts once the
+// previous reply has left, so a reply never waits for TX queue space.
+static void shell_service(uint32_t now) {
+    (void)now;
+    uint8_t rx_char;
+    char line[sizeof(cmdBuffer)];
+    while (shell_pending_room() && serial_rx_read(&rx_char)) { // UART errors are cleared by the ISR
+        if (shell_collect_char(rx_char)) {
+            shell_pending_push(cmdBuffer);
+            cmdIndex = 0;
+        }
+    }
+    while (pendingLines > 0U && !serial_tx_busy()) {
+        shell_pending_pop(line);
+        cmd_parser_shell(line);
+    }
+}
+
+static uint32_t shell_next_deadline(uint32_t now, uint32_t idle) {
+    // TX completion and received bytes both end the sleep, so no timed deadline is needed
+    return shell_has_work() ? now : idle;
+}
+
+static const SchedTask_t shell_task = { "shell", shell_service, shell_next_deadline, 0U, SCHED_PRIO_SHELL };
+
 void init_shell(void) {
     cmdIndex = 0;
+    pendingHead = pendingTail = 0;
+    pendingLines = 0;
+    sched_add(&shell_task);
     // Any other shell-specific initializations
 }
@@ -5,17 +5,12 @@
 #include <stdbool.h>
 #include <stddef.h> // For size_t
 
-/* Extern Constant Strings (defined in shell.c) */
-extern const char* FW_VERSION_PGM; // Changed from char[] to char*
-extern const char* const BANNER_STRINGS[]; // This one is already a pointer to const char pointers, which is fine
-extern const char* BATT_PLACEHOLDER_STR; // Changed from char[] to char*
-extern const char* EFFECT_PLACEHOLDER_STR; // Changed from char[] to char*
-
 /* Function Prototypes */
 void print_banner_shell(void); // Adapted from original printBanner
 void cmd_parser_shell(char* cmd); // Adapted from original cmdParser
 void shell_process_char(uint8_t rx_char, UART_HandleTypeDef* huart_shell); // New function to handle input
-void init_shell(void); // For any one-time initializations
+void init_shell(void); // After sched_init: registers the input task
+bool shell_has_work(void); // Input the shell task can take now, or a queued command whose turn has come
 
 /* Utility functions (can be static in shell.c if not needed elsewhere) */
 /* If they are needed by other modules, they should be in utils.h */
@@ -1,5 +1,9 @@
 #include "sw_pwm.h"
 #include "led_control.h" // For LIGHT_PINS definition to initialize sw_pwm_ports/pins
+#include "hal_init.h"    // For htim21 (counter/BAM timebase), htim2 + DMA handles (waveform playback)
+#include "isr_prof.h"    // For isr_prof_reset (TIM21 handler cost counters)
+#include "fixed_math.h"  // For fx_div255 (level -> step scaling)
+#include "clock_gov.h"   // For clock_boost, CLOCK_FAST_HZ (the output only runs on HSI16)
 
 /* Static global variables for Software PWM */
 // These are the actual definitions for the SW PWM system.
@@ -10,31 +14,380 @@
 static const uint8_t sw_pwm_pin_indices[NUM_SW_PWM_CHANNELS] = {1, 2, 4, 5, 6, 7}; // From original main.c
 static GPIO_TypeDef* sw_pwm_ports[NUM_SW_PWM_CHANNELS];
 static uint16_t      sw_pwm_gpio_pins[NUM_SW_PWM_CHANNELS];
-/*volatile*/ static uint8_t sw_pwm_duty_cycles[NUM_SW_PWM_CHANNELS] = {0}; // Made static, not extern. Needs setter.
-/*volatile*/ static uint8_t sw_pwm_counter = 0; // Made static.
+static uint8_t sw_pwm_levels[NUM_SW_PWM_CHANNELS] = {0}; // 0-255, only written from the main loop via the setter.
+static SwPwmMode_t sw_pwm_mode = SW_PWM_MODE_COUNTER;
+static uint8_t sw_pwm_counter = 0; // Counter step or BAM bit-plane; only touched by the ISRs.
+static bool sw_pwm_running = false; // Timebase (TIM21 or the TIM2 DMA requests) active
+static uint16_t sw_pwm_refresh_hz = SW_PWM_DEFAULT_REFRESH_HZ; // Requested, within the mode's range
+static uint16_t sw_pwm_actual_hz;     // What the rounded slot/prescaler gives
+static uint16_t sw_pwm_slot_ticks;    // TIM21 ticks per counter step, or per BAM LSB plane
+static uint16_t sw_pwm_dma_prescaler; // TIM2 prescaler while the DMA waveform plays
 
-// Setter function for duty cycles, to be called by driveLED
-void set_sw_pwm_channel_duty(uint8_t sw_channel_idx, uint8_t duty_0_to_resolution) {
-    if (sw_channel_idx < NUM_SW_PWM_CHANNELS) {
-        if (duty_0_to_resolution > SW_PWM_RESOLUTION) {
-            sw_pwm_duty_cycles[sw_channel_idx] = SW_PWM_RESOLUTION;
+// Port-batched output tables, one BSRR word per step and port.
+// Counter mode: step 0 carries the full pin state (set for duty > 0, reset for
+// duty == 0), step N only resets the channels whose duty is N, so most entries
+// are 0 and the ISR skips the store.
+// BAM mode: plane k sets the channels with bit k of their level set and resets
+// the rest, so every plane is a full pin state.
+// DMA mode: same edge layout as counter mode over SW_PWM_DMA_STEPS, streamed by
+// two circular DMA channels straight into the BSRR registers.
+// Only one mode runs at a time, so the layouts share storage. Two copies are
+// kept so the ISR never plays a half-built table: the main loop fills the idle
+// copy, then publishes it via sw_pwm_next_table and the ISR switches over at
+// the start of the next period/frame. In DMA mode the copies are only staging:
+// the DMA plays a two-period ring per port (sw_pwm_dma_ring), and each channel's
+// half/complete interrupt copies the published table into the half it has just
+// left, so a period is never changed while it plays.
+typedef union {
+    struct { uint32_t a[SW_PWM_RESOLUTION]; uint32_t b[SW_PWM_RESOLUTION]; } counter;
+    struct { uint32_t a[SW_PWM_BAM_BITS];   uint32_t b[SW_PWM_BAM_BITS];   } bam;
+    struct { uint32_t a[SW_PWM_DMA_STEPS];  uint32_t b[SW_PWM_DMA_STEPS];  } dma;
+} SwPwmTable_t;
+
+static SwPwmTable_t sw_pwm_tables[2];
+static volatile uint8_t sw_pwm_isr_table = 0;  // Copy being played (written by ISR)
+static volatile uint8_t sw_pwm_next_table = 0; // Copy to play from next period (written by main loop)
+
+// DMA mode: per port, periods [0, SW_PWM_DMA_STEPS) and [SW_PWM_DMA_STEPS, 2x).
+// sw_pwm_dma_gen counts published tables; each half notes the one it holds.
+typedef enum { SW_PWM_DMA_PORT_A, SW_PWM_DMA_PORT_B, SW_PWM_DMA_PORTS } SwPwmDmaPort_t;
+static uint32_t sw_pwm_dma_ring[SW_PWM_DMA_PORTS][2 * SW_PWM_DMA_STEPS];
+static volatile uint8_t sw_pwm_dma_gen = 0;
+static uint8_t sw_pwm_dma_half_gen[SW_PWM_DMA_PORTS][2]; // Only touched by the DMA interrupts once started
+
+static void build_counter_table(SwPwmTable_t* tbl) {
+    for (int step = 0; step < SW_PWM_RESOLUTION; ++step) {
+        tbl->counter.a[step] = 0;
+        tbl->counter.b[step] = 0;
+    }
+
+    for (int i = 0; i < NUM_SW_PWM_CHANNELS; ++i) {
+        uint32_t* port_tbl;
+        if (sw_pwm_ports[i] == GPIOA) { port_tbl = tbl->counter.a; }
+        else if (sw_pwm_ports[i] == GPIOB) { port_tbl = tbl->counter.b; }
+        else { continue; } // Engine only drives the two LED ports
+
+        uint32_t set_bit = sw_pwm_gpio_pins[i];
+        uint32_t reset_bit = (uint32_t)sw_pwm_gpio_pins[i] << 16;
+        uint8_t duty = (uint8_t)fx_div255((uint32_t)sw_pwm_levels[i] * SW_PWM_RESOLUTION);
+
+        if (duty == 0) {
+            port_tbl[0] |= reset_bit;
         } else {
-            sw_pwm_duty_cycles[sw_channel_idx] = duty_0_to_resolution;
+            port_tbl[0] |= set_bit;
+            if (duty < SW_PWM_RESOLUTION) {
+                port_tbl[duty] |= reset_bit; // Falling edge
+            }
+        }
+    }
+}
+
+static void build_bam_table(SwPwmTable_t* tbl) {
+    for (int plane = 0; plane < SW_PWM_BAM_BITS; ++plane) {
+        uint32_t word_a = 0, word_b = 0;
+        for (int i = 0; i < NUM_SW_PWM_CHANNELS; ++i) {
+            uint32_t bits = (sw_pwm_levels[i] & (1U << plane)) ? sw_pwm_gpio_pins[i]
+                                                               : ((uint32_t)sw_pwm_gpio_pins[i] << 16);
+            if (sw_pwm_ports[i] == GPIOA) { word_a |= bits; }
+            else if (sw_pwm_ports[i] == GPIOB) { word_b |= bits; }
+        }
+        tbl->bam.a[plane] = word_a;
+        tbl->bam.b[plane] = word_b;
+    }
+}
+
+// Builds a staging copy; the DMA interrupts move it into the ring.
+static void build_dma_table(SwPwmTable_t* tbl) {
+    uint8_t duty[NUM_SW_PWM_CHANNELS];
+    for (int i = 0; i < NUM_SW_PWM_CHANNELS; ++i) {
+        duty[i] = (uint8_t)fx_div255((uint32_t)sw_pwm_levels[i] * SW_PWM_DMA_STEPS);
+    }
+
+    for (int step = 0; step < SW_PWM_DMA_STEPS; ++step) {
+        uint32_t word_a = 0, word_b = 0;
+        for (int i = 0; i < NUM_SW_PWM_CHANNELS; ++i) {
+            uint32_t bits = 0;
+            if (step == 0) {
+                bits = duty[i] ? sw_pwm_gpio_pins[i] : ((uint32_t)sw_pwm_gpio_pins[i] << 16);
+            } else if (duty[i] == step) {
+                bits = (uint32_t)sw_pwm_gpio_pins[i] << 16; // Falling edge
+            }
+            if (sw_pwm_ports[i] == GPIOA) { word_a |= bits; }
+            else if (sw_pwm_ports[i] == GPIOB) { word_b |= bits; }
+        }
+        tbl->dma.a[step] = word_a;
+        tbl->dma.b[step] = word_b;
+    }
+}
+
+// True when every channel is fully off or fully on, i.e. there is nothing to modulate.
+static bool sw_pwm_levels_static(void) {
+    for (int i = 0; i < NUM_SW_PWM_CHANNELS; ++i) {
+        if (sw_pwm_levels[i] != 0 && sw_pwm_levels[i] != 255) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Drive the pins straight to their static state (only valid when sw_pwm_levels_static()).
+static void write_static_levels(void) {
+    uint32_t word_a = 0, word_b = 0;
+    for (int i = 0; i < NUM_SW_PWM_CHANNELS; ++i) {
+        uint32_t bits = sw_pwm_levels[i] ? sw_pwm_gpio_pins[i] : ((uint32_t)sw_pwm_gpio_pins[i] << 16);
+        if (sw_pwm_ports[i] == GPIOA) { word_a |= bits; }
+        else if (sw_pwm_ports[i] == GPIOB) { word_b |= bits; }
+    }
+    GPIOA->BSRR = word_a;
+    GPIOB->BSRR = word_b;
+}
+
+static void build_table(SwPwmTable_t* tbl) {
+    if (sw_pwm_mode == SW_PWM_MODE_BAM) {
+        build_bam_table(tbl);
+    } else if (sw_pwm_mode == SW_PWM_MODE_DMA) {
+        build_dma_table(tbl);
+    } else {
+        build_counter_table(tbl);
+    }
+}
+
+// Converts sw_pwm_refresh_hz into the timing of the active mode. Divisions are
+// fine here: this only runs on init and when the rate is changed.
+static void apply_refresh_rate(void) {
+    uint32_t max_hz = (sw_pwm_mode == SW_PWM_MODE_BAM) ? SW_PWM_BAM_MAX_REFRESH_HZ : SW_PWM_MAX_REFRESH_HZ;
+    if (sw_pwm_refresh_hz > max_hz) { sw_pwm_refresh_hz = (uint16_t)max_hz; }
+    uint32_t hz = sw_pwm_refresh_hz;
+    uint32_t ticks;
+
+    if (sw_pwm_mode == SW_PWM_MODE_BAM) {
+        ticks = SW_PWM_TIMER_TICK_HZ / (hz * 255U);  // 255 LSB periods per frame
+        if (ticks < SW_PWM_MIN_SLOT_TICKS) { ticks = SW_PWM_MIN_SLOT_TICKS; }
+        if (ticks > (0xFFFFU >> (SW_PWM_BAM_BITS - 1))) { ticks = 0xFFFFU >> (SW_PWM_BAM_BITS - 1); } // MSB plane must fit ARR
+        sw_pwm_slot_ticks = (uint16_t)ticks;
+        sw_pwm_actual_hz = (uint16_t)(SW_PWM_TIMER_TICK_HZ / (ticks * 255U));
+    } else if (sw_pwm_mode == SW_PWM_MODE_DMA) {
+        // TIM2 keeps its 256-count period; only its prescaler sets the step rate.
+        // The waveform only plays on HSI16, whatever the clock is right now.
+        // Nearest divider: the rates it gives are 1953 Hz / (prescaler + 1)
+        uint32_t step_hz = hz * 256U * SW_PWM_DMA_STEPS;
+        ticks = (CLOCK_FAST_HZ + step_hz / 2U) / step_hz;
+        if (ticks < 1U) { ticks = 1U; }
+        if (ticks > 0x10000U) { ticks = 0x10000U; }
+        sw_pwm_dma_prescaler = (uint16_t)(ticks - 1U);
+        sw_pwm_actual_hz = (uint16_t)(CLOCK_FAST_HZ / (ticks * 256U * SW_PWM_DMA_STEPS));
+    } else {
+        ticks = SW_PWM_TIMER_TICK_HZ / (hz * SW_PWM_RESOLUTION);
+        if (ticks < SW_PWM_MIN_SLOT_TICKS) { ticks = SW_PWM_MIN_SLOT_TICKS; }
+        if (ticks > 0xFFFFU) { ticks = 0xFFFFU; }
+        sw_pwm_slot_ticks = (uint16_t)ticks;
+        sw_pwm_actual_hz = (uint16_t)(SW_PWM_TIMER_TICK_HZ / (ticks * SW_PWM_RESOLUTION));
+    }
+}
+
+static void start_counter_timer(void) {
+    // Fixed step length; step 0 is output by the first update interrupt.
+    sw_pwm_counter = 0;
+    htim21.Instance->ARR = sw_pwm_slot_ticks - 1U;
+    HAL_TIM_GenerateEvent(&htim21, TIM_EVENTSOURCE_UPDATE); // Load ARR shadow, reset CNT
+    __HAL_TIM_CLEAR_IT(&htim21, TIM_IT_UPDATE);
+    HAL_TIM_Base_Start_IT(&htim21);
+}
+
+static void start_bam_timer(void) {
+    // Show plane 0 now and let TIM21 time it; each update interrupt then starts
+    // the next plane. ARR is preloaded, so the value written while plane k starts
+    // only takes effect for plane k+1.
+    sw_pwm_isr_table = sw_pwm_next_table;
+    GPIOA->BSRR = sw_pwm_tables[sw_pwm_isr_table].bam.a[0];
+    GPIOB->BSRR = sw_pwm_tables[sw_pwm_isr_table].bam.b[0];
+
+    htim21.Instance->ARR = sw_pwm_slot_ticks - 1U;
+    HAL_TIM_GenerateEvent(&htim21, TIM_EVENTSOURCE_UPDATE); // Load ARR shadow, reset CNT
+    htim21.Instance->ARR = ((uint32_t)sw_pwm_slot_ticks << 1) - 1U;
+    __HAL_TIM_CLEAR_IT(&htim21, TIM_IT_UPDATE);
+    sw_pwm_counter = 1;
+    HAL_TIM_Base_Start_IT(&htim21);
+}
+
+// Copies the published table into one half of a port's ring, unless it is there already
+static void sw_pwm_dma_refill(SwPwmDmaPort_t port, uint8_t half) {
+    uint8_t gen = sw_pwm_dma_gen; // Read before the table: the main loop publishes the table first
+    if (sw_pwm_dma_half_gen[port][half] == gen) return;
+    const SwPwmTable_t* tbl = &sw_pwm_tables[sw_pwm_next_table];
+    const uint32_t* src = (port == SW_PWM_DMA_PORT_A) ? tbl->dma.a : tbl->dma.b;
+    uint32_t* dst = &sw_pwm_dma_ring[port][half * SW_PWM_DMA_STEPS];
+    for (int step = 0; step < SW_PWM_DMA_STEPS; ++step) {
+        dst[step] = src[step];
+    }
+    sw_pwm_dma_half_gen[port][half] = gen;
+}
+
+static SwPwmDmaPort_t sw_pwm_dma_port(const DMA_HandleTypeDef* hdma) {
+    return (hdma == &hdma_tim2_ch3) ? SW_PWM_DMA_PORT_A : SW_PWM_DMA_PORT_B;
+}
+
+// Half transfer: the channel has moved on to the second period, so the first is free
+static void sw_pwm_dma_half_done(DMA_HandleTypeDef* hdma) {
+    sw_pwm_dma_refill(sw_pwm_dma_port(hdma), 0);
+}
+
+// Transfer complete: the channel has wrapped to the first period
+static void sw_pwm_dma_ring_done(DMA_HandleTypeDef* hdma) {
+    sw_pwm_dma_refill(sw_pwm_dma_port(hdma), 1);
+}
+
+static void start_dma_waveform(void) {
+    // Both halves of both rings hold the published table before the DMA starts
+    for (uint8_t port = 0; port < SW_PWM_DMA_PORTS; ++port) {
+        sw_pwm_dma_half_gen[port][0] = (uint8_t)(sw_pwm_dma_gen - 1U);
+        sw_pwm_dma_half_gen[port][1] = (uint8_t)(sw_pwm_dma_gen - 1U);
+        sw_pwm_dma_refill((SwPwmDmaPort_t)port, 0);
+        sw_pwm_dma_refill((SwPwmDmaPort_t)port, 1);
+    }
+
+    // Speed TIM2 up: same 8-bit period (eye/PA1 duties unchanged), one waveform step per update.
+    __HAL_TIM_SET_PRESCALER(&htim2, sw_pwm_dma_prescaler); // Applies from the next update
+    __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_3, 0); // CC3 request fires alongside the update
+
+    hdma_tim2_ch3.XferHalfCpltCallback = sw_pwm_dma_half_done;
+    hdma_tim2_ch3.XferCpltCallback = sw_pwm_dma_ring_done;
+    hdma_tim2_up.XferHalfCpltCallback = sw_pwm_dma_half_done;
+    hdma_tim2_up.XferCpltCallback = sw_pwm_dma_ring_done;
+    HAL_DMA_Start_IT(&hdma_tim2_ch3, (uint32_t)(uintptr_t)sw_pwm_dma_ring[SW_PWM_DMA_PORT_A], (uint32_t)(uintptr_t)&GPIOA->BSRR, 2U * SW_PWM_DMA_STEPS);
+    HAL_DMA_Start_IT(&hdma_tim2_up,  (uint32_t)(uintptr_t)sw_pwm_dma_ring[SW_PWM_DMA_PORT_B], (uint32_t)(uintptr_t)&GPIOB->BSRR, 2U * SW_PWM_DMA_STEPS);
+    __HAL_TIM_ENABLE_DMA(&htim2, TIM_DMA_CC3 | TIM_DMA_UPDATE);
+}
+
+static void stop_dma_waveform(void) {
+    __HAL_TIM_DISABLE_DMA(&htim2, TIM_DMA_CC3 | TIM_DMA_UPDATE);
+    HAL_DMA_Abort(&hdma_tim2_ch3);
+    HAL_DMA_Abort(&hdma_tim2_up);
+    __HAL_TIM_SET_PRESCALER(&htim2, htim2.Init.Prescaler);
+}
+
+static void start_sw_pwm_output(void) {
+    clock_boost(); // Before the timebase starts: its interrupts need HSI16
+    if (sw_pwm_mode == SW_PWM_MODE_DMA) {
+        start_dma_waveform();
+    } else if (sw_pwm_mode == SW_PWM_MODE_BAM) {
+        start_bam_timer();
+    } else {
+        start_counter_timer();
+    }
+    sw_pwm_running = true;
+}
+
+static void stop_sw_pwm_output(void) {
+    if (sw_pwm_mode == SW_PWM_MODE_DMA) {
+        stop_dma_waveform();
+    } else {
+        HAL_TIM_Base_Stop_IT(&htim21);
+        HAL_NVIC_ClearPendingIRQ(TIM21_IRQn); // No late plane/step after the static write
+    }
+    sw_pwm_running = false;
+}
+
+static void rebuild_sw_pwm_tables(void) {
+    if (sw_pwm_levels_static()) {
+        // Nothing to modulate: park the timebase and hold the pins.
+        if (sw_pwm_running) {
+            stop_sw_pwm_output();
         }
+        write_static_levels();
+        return;
     }
+
+    if (!sw_pwm_running) {
+        // No ISR or DMA is reading the tables, so build copy 0 directly.
+        sw_pwm_isr_table = 0;
+        sw_pwm_next_table = 0;
+        build_table(&sw_pwm_tables[0]);
+        start_sw_pwm_output();
+        return;
+    }
+
+    if (sw_pwm_mode == SW_PWM_MODE_DMA) {
+        // The DMA interrupts only copy from the published table, each copy in
+        // one go, so the other table is free to rebuild
+        uint8_t target = sw_pwm_next_table ^ 1U;
+        build_dma_table(&sw_pwm_tables[target]);
+        sw_pwm_next_table = target;
+        sw_pwm_dma_gen++;
+        return;
+    }
+
+    // Claim the idle copy. Re-publishing the playing copy first drops any table
+    // the ISR has not picked up yet, so nothing else can switch to 'target' while
+    // it is being rewritten.
+    __disable_irq();
+    uint8_t target = sw_pwm_isr_table ^ 1U;
+    sw_pwm_next_table = sw_pwm_isr_table;
+    __enable_irq();
+
+    build_table(&sw_pwm_tables[target]);
+
+    sw_pwm_next_table = target;
 }
 
-// Getter function for sw_pwm_pin_indices, to be used by driveLED
-// This is not ideal, driveLED should ideally not need to know these indices.
-// A better approach would be for driveLED to call a function like:
-// set_sw_pwm_for_led_idx(uint8_t led_idx, uint8_t val_0_255)
-// For now, to match original structure closely first:
+// Setter function for a single channel level
+void set_sw_pwm_channel_duty(uint8_t sw_channel_idx, uint8_t level_0_to_255) {
+    if (sw_channel_idx < NUM_SW_PWM_CHANNELS) {
+        if (sw_pwm_levels[sw_channel_idx] == level_0_to_255) {
+            return; // Effects rewrite unchanged values every tick; keep the tables as they are
+        }
+        sw_pwm_levels[sw_channel_idx] = level_0_to_255;
+        rebuild_sw_pwm_tables();
+    }
+}
+
+// Sets all channels at once (framebuffer flush), rebuilding the tables at most once.
+void set_sw_pwm_levels(const uint8_t* levels_0_to_255) {
+    bool changed = false;
+    for (int i = 0; i < NUM_SW_PWM_CHANNELS; ++i) {
+        if (sw_pwm_levels[i] != levels_0_to_255[i]) {
+            sw_pwm_levels[i] = levels_0_to_255[i];
+            changed = true;
+        }
+    }
+    if (changed) {
+        rebuild_sw_pwm_tables();
+    }
+}
+
+// Getter function for sw_pwm_pin_indices, used once by init_led_effects
+// to map LIGHT_PINS indices to software PWM channels for the framebuffer flush.
 const uint8_t* get_sw_pwm_pin_indices(void) {
     return sw_pwm_pin_indices;
 }
 
+SwPwmMode_t get_sw_pwm_mode(void) {
+    return sw_pwm_mode;
+}
+
+bool is_sw_pwm_running(void) {
+    return sw_pwm_running;
+}
 
-void init_software_pwm(void) {
+uint16_t get_sw_pwm_refresh_hz(void) {
+    return sw_pwm_actual_hz;
+}
+
+void set_sw_pwm_refresh_hz(uint16_t hz) {
+    if (hz < SW_PWM_MIN_REFRESH_HZ) { hz = SW_PWM_MIN_REFRESH_HZ; }
+    sw_pwm_refresh_hz = hz; // apply_refresh_rate() caps it at the mode's maximum
+
+    bool was_running = sw_pwm_running;
+    if (was_running) {
+        stop_sw_pwm_output();
+    }
+    apply_refresh_rate();
+    if (was_running) {
+        start_sw_pwm_output(); // Restarts from a period boundary with the new timing
+    }
+}
+
+void init_software_pwm(SwPwmMode_t mode) {
     // Initialize port and pin arrays for SW PWM channels
     // This uses LIGHT_PINS from led_control.h/c
     for (int i = 0; i < NUM_SW_PWM_CHANNELS; ++i) {
@@ -45,33 +398,47 @@ void init_software_pwm(void) {
         }
         // Else: configuration error, pin index out of bounds
     }
-    // Initialize duty cycles to 0
+    // Initialize levels to 0
     for (int i = 0; i < NUM_SW_PWM_CHANNELS; ++i) {
-        sw_pwm_duty_cycles[i] = 0;
+        sw_pwm_levels[i] = 0;
     }
-    sw_pwm_counter = 0;
+
+    if (sw_pwm_running) {
+        stop_sw_pwm_output(); // Stops whatever the previous mode was using
+    }
+    sw_pwm_mode = mode;
+    apply_refresh_rate();
+    isr_prof_reset(ISR_PROF_TIM21); // Cost depends on the mode
+    rebuild_sw_pwm_tables(); // All channels off: pins driven low, timebase left stopped
 }
 
-void update_software_pwm(void) {
-    sw_pwm_counter++;
-    if (sw_pwm_counter >= SW_PWM_RESOLUTION) {
-        sw_pwm_counter = 0;
+// TIM21 update interrupt, the timebase for counter and BAM modes.
+void sw_pwm_timer_isr(void) {
+    __HAL_TIM_CLEAR_IT(&htim21, TIM_IT_UPDATE);
+
+    uint8_t step = sw_pwm_counter;
+    if (step == 0) {
+        sw_pwm_isr_table = sw_pwm_next_table; // Latch new levels only at a period/frame boundary
     }
+    const SwPwmTable_t* tbl = &sw_pwm_tables[sw_pwm_isr_table];
 
-    for (int i = 0; i < NUM_SW_PWM_CHANNELS; ++i) {
-        // Ensure sw_pwm_ports[i] and sw_pwm_gpio_pins[i] are valid before dereferencing
-        if (sw_pwm_ports[i] == NULL) continue; // Basic safety check
+    if (sw_pwm_mode == SW_PWM_MODE_BAM) {
+        GPIOA->BSRR = tbl->bam.a[step];
+        GPIOB->BSRR = tbl->bam.b[step];
 
-        uint8_t current_duty = sw_pwm_duty_cycles[i];
-        // Duty cycle is already scaled to SW_PWM_RESOLUTION by the setter
-        // if (current_duty > SW_PWM_RESOLUTION) { // This check should be in the setter
-        //      current_duty = SW_PWM_RESOLUTION;
-        // }
+        step = (step + 1) & (SW_PWM_BAM_BITS - 1);
+        TIM21->ARR = ((uint32_t)sw_pwm_slot_ticks << step) - 1U; // Length of the plane after this one
+    } else {
+        // At most one BSRR store per port; most steps have nothing to change.
+        uint32_t bsrr_a = tbl->counter.a[step];
+        uint32_t bsrr_b = tbl->counter.b[step];
+        if (bsrr_a) { GPIOA->BSRR = bsrr_a; }
+        if (bsrr_b) { GPIOB->BSRR = bsrr_b; }
 
-        if (sw_pwm_counter < current_duty) {
-            HAL_GPIO_WritePin(sw_pwm_ports[i], sw_pwm_gpio_pins[i], GPIO_PIN_SET);
-        } else {
-            HAL_GPIO_WritePin(sw_pwm_ports[i], sw_pwm_gpio_pins[i], GPIO_PIN_RESET);
+        step++;
+        if (step >= SW_PWM_RESOLUTION) {
+            step = 0;
         }
     }
+    sw_pwm_counter = step;
 }
@@ -3,15 +3,54 @@
 
 #include "stm32l0xx_hal.h" // For GPIO_TypeDef, uint16_t, etc.
 #include <stdint.h>
+#include <stdbool.h>
+
+/* Type Definitions */
+typedef enum {
+    SW_PWM_MODE_COUNTER, // SW_PWM_RESOLUTION-step counter PWM, one TIM21 interrupt per step
+    SW_PWM_MODE_BAM,     // 8-bit bit-angle modulation, one TIM21 interrupt per bit-plane
+    SW_PWM_MODE_DMA      // Waveform frame in RAM streamed to BSRR by DMA, no CPU per edge
+} SwPwmMode_t;
 
 /* Constants */
 #define NUM_SW_PWM_CHANNELS 6
-#define SW_PWM_RESOLUTION 20
+#define SW_PWM_RESOLUTION 20 // Counter mode steps per period
+
+#define SW_PWM_BAM_BITS 8
+#define SW_PWM_DMA_STEPS 32
+
+// Refresh rate = full PWM periods (counter/DMA) or BAM frames per second.
+// Counter and BAM modes run on TIM21 ticking at SW_PWM_TIMER_TICK_HZ: a counter
+// step lasts tick_hz / (hz * SW_PWM_RESOLUTION) ticks, BAM plane k lasts
+// (tick_hz / (hz * 255)) << k ticks. At 125 Hz that is 2500 interrupts/s for
+// counter mode and 1000/s for BAM (31-tick LSB).
+// DMA: TIM21/TIM22 have no DMA requests on the L0, so the frame is paced by TIM2
+// (update -> GPIOB, CC3 -> GPIOA). TIM2 keeps its 8-bit period for the eye/PA1
+// hardware PWM and only its prescaler is lowered to reach the rate.
+#define SW_PWM_TIMER_TICK_HZ 1000000UL
+#define SW_PWM_MIN_SLOT_TICKS 16 // Shortest step/plane; leaves the ISR time to finish
+#define SW_PWM_MIN_REFRESH_HZ 30
+#define SW_PWM_MAX_REFRESH_HZ 1000 // Counter and DMA modes
+#define SW_PWM_BAM_MAX_REFRESH_HZ (SW_PWM_TIMER_TICK_HZ / (255UL * SW_PWM_MIN_SLOT_TICKS)) // 245: LSB plane at the shortest slot
+#ifndef SW_PWM_DEFAULT_REFRESH_HZ
+#define SW_PWM_DEFAULT_REFRESH_HZ 125
+#endif
+
+#ifndef SW_PWM_DEFAULT_MODE
+#define SW_PWM_DEFAULT_MODE SW_PWM_MODE_BAM // Override with -D SW_PWM_DEFAULT_MODE=SW_PWM_MODE_COUNTER
+#endif
 
 /* Function Prototypes */
-void init_software_pwm(void);
-void update_software_pwm(void); // Called by SysTick_Handler
-void set_sw_pwm_channel_duty(uint8_t sw_channel_idx, uint8_t duty_0_to_resolution);
+void init_software_pwm(SwPwmMode_t mode);
+SwPwmMode_t get_sw_pwm_mode(void);
+void sw_pwm_timer_isr(void); // Called by TIM21_IRQHandler (counter and BAM modes)
+// The timebase only runs while some channel is between 0 and 255; otherwise the
+// pins are held statically and no PWM interrupts or DMA transfers occur.
+bool is_sw_pwm_running(void);
+void set_sw_pwm_refresh_hz(uint16_t hz); // Clamped to SW_PWM_MIN_REFRESH_HZ and the mode's maximum
+uint16_t get_sw_pwm_refresh_hz(void); // The rate the active mode's timing actually gives
+void set_sw_pwm_channel_duty(uint8_t sw_channel_idx, uint8_t level_0_to_255);
+void set_sw_pwm_levels(const uint8_t* levels_0_to_255); // NUM_SW_PWM_CHANNELS entries
 const uint8_t* get_sw_pwm_pin_indices(void); // Getter for pin indices
 
 #endif // SW_PWM_H
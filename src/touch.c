@@ -0,0 +1,117 @@
+#include "touch.h"
+#include "utils.h" // For cycle_count
+
+#define PAD_MODER_MASK   (3UL << (CAP_PAD_PIN_INDEX * 2U))
+#define PAD_MODER_OUTPUT (1UL << (CAP_PAD_PIN_INDEX * 2U))
+
+// Measurement in flight: touch_armed is set with the release stamp and cleared
+// by whichever side finishes it (edge ISR or touch_sample timing it out).
+static volatile bool touch_armed;
+static volatile bool touch_edge;               // ISR has a result waiting
+static volatile uint32_t touch_discharge_cycles;
+static uint32_t touch_release_stamp;
+static uint32_t touch_release_hz;              // SystemCoreClock the stamp was taken at
+
+// Detector state (main loop only)
+static bool touch_pressed;
+static uint8_t touch_debounce;
+static uint32_t touch_baseline_q; // Idle discharge time in us << TOUCH_BASELINE_SHIFT; 0 = not seeded
+
+static inline void pad_drive(void) {
+    CAP_PAD_PORT->MODER = (CAP_PAD_PORT->MODER & ~PAD_MODER_MASK) | PAD_MODER_OUTPUT;
+}
+
+static inline void pad_release(void) {
+    CAP_PAD_PORT->MODER &= ~PAD_MODER_MASK; // Input, no pull: only the pad's own leakage and a finger drain it
+}
+
+void touch_init(void) {
+    touch_armed = false;
+    touch_edge = false;
+    touch_pressed = false;
+    touch_debounce = 0;
+    touch_baseline_q = 0;
+    __disable_irq();
+    EXTI->IMR &= ~(uint32_t)CAP_PAD_PIN; // Unmasked only while a measurement runs
+    __HAL_GPIO_EXTI_CLEAR_IT(CAP_PAD_PIN);
+    __enable_irq();
+    HAL_GPIO_WritePin(CAP_PAD_PORT, CAP_PAD_PIN, GPIO_PIN_SET);
+    pad_drive(); // Charged from now on, between measurements
+}
+
+void touch_exti_isr(void) {
+    if (!__HAL_GPIO_EXTI_GET_IT(CAP_PAD_PIN)) return;
+    __HAL_GPIO_EXTI_CLEAR_IT(CAP_PAD_PIN);
+    EXTI->IMR &= ~(uint32_t)CAP_PAD_PIN; // One edge per measurement
+    if (!touch_armed) return;
+    touch_discharge_cycles = cycle_count() - touch_release_stamp;
+    touch_armed = false;
+    touch_edge = true;
+    pad_drive(); // Recharge until the next measurement
+}
+
+// Hysteresis and debounce around the baseline, which only follows the pad
+// while it is idle, so a slow press is not learned as the new baseline.
+static void touch_filter(uint32_t us) {
+    if (touch_baseline_q == 0U) touch_baseline_q = us << TOUCH_BASELINE_SHIFT; // First sample seeds it
+    uint32_t baseline = touch_baseline_q >> TOUCH_BASELINE_SHIFT;
+    uint32_t level = baseline - (baseline >> (touch_pressed ? TOUCH_RELEASE_SHIFT : TOUCH_PRESS_SHIFT));
+    bool raw = us < level;
+
+    if (raw != touch_pressed) {
+        if (++touch_debounce >= TOUCH_DEBOUNCE_SAMPLES) {
+            touch_pressed = raw;
+            touch_debounce = 0;
+        }
+        return;
+    }
+    touch_debounce = 0;
+    if (!touch_pressed) touch_baseline_q = touch_baseline_q - baseline + us;
+}
+
+// Whole kHz, not MHz: MSI range 5 runs at 2.097 MHz
+static uint32_t touch_max_cycles(void) {
+    return TOUCH_DISCHARGE_MAX_US * (SystemCoreClock / 1000U) / 1000U;
+}
+
+// Past TOUCH_DISCHARGE_MAX_US the sample reads as the maximum whatever happens,
+// so the clocks may stop; an edge (a finger) then wakes the core through EXTI.
+bool touch_measuring(void) {
+    return touch_armed && cycle_count() - touch_release_stamp < touch_max_cycles();
+}
+
+bool touch_idle(void) {
+    return !touch_pressed && touch_debounce == 0U;
+}
+
+bool touch_sample(void) {
+    uint32_t cycles_per_ms = SystemCoreClock / 1000U;
+    uint32_t max_cycles = touch_max_cycles();
+    uint32_t cycles = 0;
+    bool measured = false;
+
+    __disable_irq();
+    if (touch_armed) { // No edge in a whole interval
+        EXTI->IMR &= ~(uint32_t)CAP_PAD_PIN;
+        touch_armed = false;
+        pad_drive(); // A few cycles of drive recharge the pad before it is released again
+        cycles = max_cycles;
+        measured = true;
+    } else if (touch_edge) {
+        touch_edge = false;
+        cycles = touch_discharge_cycles;
+        measured = (touch_release_hz == SystemCoreClock); // Counted across a clock switch: dropped
+    }
+
+    // Start the next measurement: release the pad and time its discharge
+    __HAL_GPIO_EXTI_CLEAR_IT(CAP_PAD_PIN); // Drop any edge latched while masked
+    EXTI->IMR |= CAP_PAD_PIN;
+    touch_release_stamp = cycle_count();
+    touch_release_hz = SystemCoreClock;
+    touch_armed = true;
+    pad_release();
+    __enable_irq();
+
+    if (measured) touch_filter((cycles >= max_cycles) ? TOUCH_DISCHARGE_MAX_US : cycles * 1000U / cycles_per_ms);
+    return touch_pressed;
+}
@@ -0,0 +1,36 @@
+#ifndef TOUCH_H
+#define TOUCH_H
+
+#include "stm32l0xx_hal.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Capacitive Touch Pad */
+// The pad is kept driven high between measurements. A measurement releases it
+// as a floating input and EXTI timestamps the falling edge against SysTick; a
+// finger drains the pad faster than it discharges on its own. Each discharge
+// time is compared with a slowly adapting idle baseline (with hysteresis) and
+// the result debounced, so no threshold depends on the supply voltage.
+#define CAP_PAD_PORT            GPIOB
+#define CAP_PAD_PIN             GPIO_PIN_7
+#define CAP_PAD_PIN_INDEX       7U // MODER field and EXTI line (EXTI4_15_IRQn)
+#define TOUCH_MODE_CHANGE_COOLDOWN_MS 500 // Cooldown for touch input
+#define TOUCH_SAMPLE_INTERVAL_MS 20       // One discharge measurement per interval
+#define TOUCH_IDLE_SAMPLE_INTERVAL_MS 50  // In ultra-idle while touch_idle(): a 0.1 s tap still spans two samples
+
+#define TOUCH_DISCHARGE_MAX_US  10000U // Slower discharges (or no edge in the interval) read as this
+#define TOUCH_BASELINE_SHIFT    6      // Baseline moves 1/64 of the way to each idle sample (~1.3 s)
+#define TOUCH_PRESS_SHIFT       2      // Pressed below baseline - baseline/4 ...
+#define TOUCH_RELEASE_SHIFT     3      // ... released above baseline - baseline/8
+#define TOUCH_DEBOUNCE_SAMPLES  2      // Consecutive samples needed to change state
+
+/* Function Prototypes */
+void touch_init(void); // After MX_GPIO_Init (pad pin and EXTI line)
+// Called every TOUCH_SAMPLE_INTERVAL_MS: takes the result of the measurement
+// started last time and starts the next one. Returns the debounced state.
+bool touch_sample(void);
+void touch_exti_isr(void); // EXTI4_15 interrupt: discharge edge on the pad
+bool touch_idle(void); // Released, no change being debounced: a press is first seen by one sample
+bool touch_measuring(void); // Discharge being timed, within TOUCH_DISCHARGE_MAX_US (needs SysTick running)
+
+#endif // TOUCH_H
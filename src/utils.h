@@ -20,19 +20,49 @@ typedef enum {
 #define LETTER_GAP_MS (DOT_MS * 5)
 #define WORD_GAP_MS   (DOT_MS * 7)
 
-// Capacitive Touch Pad
-#define CAP_PAD_PORT            GPIOB
-#define CAP_PAD_PIN             GPIO_PIN_7
-#define TOUCH_MODE_CHANGE_COOLDOWN_MS 500 // Cooldown for touch input
+/* Cycle Timing */
+// The Cortex-M0+ has no DWT cycle counter, so SysTick (counting down at HCLK)
+// is used instead. Only valid for spans shorter than one SysTick period (1 ms).
+static inline uint32_t cycle_stamp(void) {
+    return SysTick->VAL;
+}
 
-/* Extern Constant Data (defined in utils.c) */
-extern const char* MORSE_TABLE_C[36];
+static inline uint32_t cycles_since(uint32_t stamp) {
+    uint32_t now = SysTick->VAL;
+    if (stamp >= now) return stamp - now;
+    return stamp + (SysTick->LOAD + 1U) - now; // Counter reloaded in between
+}
+
+// Core cycles since boot (mod 2^32, ~268 s at 16 MHz), for spans of any
+// length: the HAL tick supplies whole milliseconds and SysTick->VAL the cycles
+// within one. Callable from interrupts. Counts in cycles of whichever clock
+// is running, so a span across a clock switch mixes the two.
+uint32_t cycle_count(void);
+// Clock switch (interrupts masked): carries on from 'cycles', the count read
+// just before SysTick was reloaded for the new clock.
+void cycle_count_rebase(uint32_t cycles);
+
+/* Deadlines */
+// Absolute HAL_GetTick() times. Compared relative to 'now' so the 49-day
+// tick wrap is harmless as long as deadlines are less than ~24 days away;
+// an overdue deadline counts as earlier than any future one.
+static inline uint32_t deadline_earliest(uint32_t now, uint32_t a, uint32_t b) {
+    return ((int32_t)(a - now) <= (int32_t)(b - now)) ? a : b;
+}
+
+/* Morse Code Table */
+// A-Z then 0-9. Expanded with X(pattern) by led_fx.c, which packs each
+// pattern into one byte at compile time (MORSE_PACK).
+#define MORSE_TABLE_C(X) \
+  X(".-") X("-...") X("-.-.") X("-..") X(".") X("..-.") X("--.") X("....") X("..") X(".---") \
+  X("-.-") X(".-..") X("--") X("-.") X("---") X(".--.") X("--.-") X(".-.") X("...") X("-") \
+  X("..-") X("...-") X(".--") X("-..-") X("-.--") X("--..") \
+  X("-----") X(".----") X("..---") X("...--") X("....-") X(".....") X("-....") X("--...") \
+  X("---..") X("----.")
 
 /* Function Prototypes */
-void flash_morse_code(const char* msg, MorseTarget_t target);
-uint16_t read_vdd_mv(void);
-uint8_t get_battery_pct(uint16_t mv);
-bool is_capacitive_touched(void);
+void flash_morse_code(const char* msg, MorseTarget_t target); // Starts the LED overlay and returns (led_fx.c plays it)
+uint8_t get_battery_pct(uint16_t mv); // VDD mV (battery.c reading) to percent
 
 // String utilities
 char* trim(char *str);
@@ -0,0 +1,220 @@
+#!/usr/bin/env python3
+"""Generate the compressed console-text catalog.
+
+Reads the MSG(id, "text") entries of src/messages.def and writes the tables
+src/msg.c expands at run time. The text is byte-pair encoded across the whole
+catalog: each distinct byte gets a literal symbol, and the remaining symbol
+codes up to 255 stand for the most frequent adjacent pairs, merged repeatedly
+so one code can cover a long shared run ("[JOHNNY-5] >> ", "\\r\\n", the banner
+frame). Expansion needs no heap and a stack of at most MSG_MAX_DEPTH codes.
+
+    gen_msg_catalog.py src/messages.def <out>/msg_catalog.h
+"""
+
+import collections
+import os
+import re
+import sys
+
+MAX_DEPTH = 8        # Must not exceed MSG_STACK_DEPTH in src/msg.h
+MIN_PAIR_COUNT = 3   # A pair entry costs two bytes, so it must save at least three
+MAX_MESSAGE_LEN = 255  # Lengths are stored as uint8_t
+
+TOKEN_RE = re.compile(r'"(?:\\.|[^"\\\n])*"|//[^\n]*|/\*.*?\*/', re.S)
+ENTRY_RE = re.compile(r'\bMSG\(\s*([A-Z][A-Z0-9_]*)\s*,\s*((?:"(?:\\.|[^"\\\n])*"\s*)+)\)')
+LITERAL_RE = re.compile(r'"((?:\\.|[^"\\\n])*)"')
+ESCAPES = {"r": 13, "n": 10, "t": 9, "\\": 92, '"': 34, "'": 39, "0": 0}
+
+
+def strip_comments(text):
+    return TOKEN_RE.sub(lambda m: m.group(0) if m.group(0).startswith('"') else " ", text)
+
+
+def decode_literal(body, where):
+    out = bytearray()
+    raw = body.encode("utf-8")
+    i = 0
+    while i < len(raw):
+        ch = raw[i]
+        if ch != 0x5C:  # backslash
+            out.append(ch)
+            i += 1
+            continue
+        esc = chr(raw[i + 1])
+        if esc == "x":
+            m = re.match(rb"[0-9A-Fa-f]{1,2}", raw[i + 2:])
+            if not m:
+                sys.exit(f"{where}: bad \\x escape")
+            out.append(int(m.group(0), 16))
+            i += 2 + len(m.group(0))
+        elif esc in ESCAPES:
+            out.append(ESCAPES[esc])
+            i += 2
+        else:
+            sys.exit(f"{where}: unsupported escape \\{esc}")
+    return bytes(out)
+
+
+def read_messages(def_path):
+    with open(def_path, encoding="utf-8") as f:
+        text = strip_comments(f.read())
+    messages = []
+    seen = set()
+    for m in ENTRY_RE.finditer(text):
+        ident = m.group(1)
+        where = f"{def_path}: MSG({ident})"
+        if ident in seen:
+            sys.exit(f"{where}: duplicate id")
+        seen.add(ident)
+        data = b"".join(decode_literal(lit, where) for lit in LITERAL_RE.findall(m.group(2)))
+        if not data or len(data) > MAX_MESSAGE_LEN:
+            sys.exit(f"{where}: text must be 1..{MAX_MESSAGE_LEN} bytes, is {len(data)}")
+        twin = next((other for other, text in messages if text == data), None)
+        if twin:
+            sys.exit(f"{where}: same text as MSG({twin}); use that id")
+        messages.append((ident, data))
+    if not messages:
+        sys.exit(f"{def_path}: no MSG entries found")
+    if len(text.split("MSG(")) - 1 != len(messages):
+        sys.exit(f"{def_path}: unparsable MSG entry (one C string literal per entry, no macros)")
+    return messages
+
+
+def byte_pair_encode(messages):
+    literals = sorted({b for _, data in messages for b in data})
+    literal_sym = {b: i for i, b in enumerate(literals)}
+    streams = [[literal_sym[b] for b in data] for _, data in messages]
+    depth = [0] * len(literals)
+    pairs = []
+
+    while len(literals) + len(pairs) < 256:
+        counts = collections.Counter()
+        for s in streams:
+            i = 0
+            while i + 1 < len(s):
+                pair = (s[i], s[i + 1])
+                if 1 + max(depth[pair[0]], depth[pair[1]]) <= MAX_DEPTH:
+                    counts[pair] += 1
+                # Don't count overlapping runs ("aaa") twice
+                i += 2 if i + 2 < len(s) and s[i + 2] == s[i] == s[i + 1] else 1
+        if not counts:
+            break
+        pair, count = max(counts.items(), key=lambda kv: (kv[1], -kv[0][0], -kv[0][1]))
+        if count < MIN_PAIR_COUNT:
+            break
+        code = len(literals) + len(pairs)
+        pairs.append(pair)
+        depth.append(1 + max(depth[pair[0]], depth[pair[1]]))
+        for n, s in enumerate(streams):
+            out = []
+            i = 0
+            while i < len(s):
+                if i + 1 < len(s) and (s[i], s[i + 1]) == pair:
+                    out.append(code)
+                    i += 2
+                else:
+                    out.append(s[i])
+                    i += 1
+            streams[n] = out
+    return literals, pairs, streams, max(depth)
+
+
+def expand(sym, literals, pairs):
+    if sym < len(literals):
+        return bytes([literals[sym]])
+    left, right = pairs[sym - len(literals)]
+    return expand(left, literals, pairs) + expand(right, literals, pairs)
+
+
+def c_comment_text(data):
+    text = data.decode("utf-8", "replace").replace("\r", "\\r").replace("\n", "\\n").replace("*/", "*\\/")
+    return text if len(text) <= 60 else text[:57] + "..."
+
+
+def diag_feed_max_len(def_path, messages):
+    ids = [ident for ident, _ in messages]
+    for end in ("DIAG_FEED_FIRST", "DIAG_FEED_LAST"):
+        if end not in ids:
+            sys.exit(f"{def_path}: no MSG({end}) entry")
+    first, last = ids.index("DIAG_FEED_FIRST"), ids.index("DIAG_FEED_LAST")
+    if last < first:
+        sys.exit(f"{def_path}: MSG(DIAG_FEED_LAST) comes before MSG(DIAG_FEED_FIRST)")
+    return max(len(data) for _, data in messages[first:last + 1])
+
+
+def render(def_path, messages, literals, pairs, streams, max_depth):
+    raw_size = sum(len(data) for _, data in messages)
+    blob = [sym for s in streams for sym in s]
+    table_size = len(literals) + 2 * len(pairs) + 2 * (len(messages) + 1) + len(messages)
+
+    out = []
+    out.append("// Generated by tools/gen_msg_catalog.py from %s. Do not edit." % os.path.basename(def_path))
+    out.append("// %d messages, %d bytes of text -> %d byte stream + %d bytes of tables"
+               % (len(messages), raw_size, len(blob), table_size))
+    out.append("#ifndef MSG_CATALOG_H")
+    out.append("#define MSG_CATALOG_H")
+    out.append("")
+    out.append("#include <stdint.h>")
+    out.append("")
+    out.append("#define MSG_CATALOG_COUNT %d" % len(messages))
+    out.append("#define MSG_FIRST_PAIR %d // Symbols below this are literals" % len(literals))
+    out.append("#define MSG_MAX_DEPTH %d   // Deepest pair nesting" % max_depth)
+    out.append("#define MSG_DIAG_FEED_MAX_LEN %d // Longest DIAG_FEED_* line, CRLF included"
+               % diag_feed_max_len(def_path, messages))
+    out.append("")
+    out.append("static const uint8_t MSG_LITERALS[MSG_FIRST_PAIR] = {")
+    for i in range(0, len(literals), 12):
+        out.append("    %s," % ", ".join("0x%02X" % b for b in literals[i:i + 12]))
+    out.append("};")
+    out.append("")
+    out.append("// Symbol MSG_FIRST_PAIR + i expands to MSG_PAIRS[i][0] then MSG_PAIRS[i][1]")
+    out.append("static const uint8_t MSG_PAIRS[%d][2] = {" % max(1, len(pairs)))
+    for i in range(0, len(pairs), 8):
+        out.append("    %s," % ", ".join("{%d, %d}" % p for p in pairs[i:i + 8]))
+    if not pairs:
+        out.append("    {0, 0},")
+    out.append("};")
+    out.append("")
+    out.append("// Start of each message in MSG_STREAM; entry MSG_CATALOG_COUNT is the end")
+    out.append("static const uint16_t MSG_OFFSETS[MSG_CATALOG_COUNT + 1] = {")
+    offsets = [0]
+    for s in streams:
+        offsets.append(offsets[-1] + len(s))
+    for i in range(0, len(offsets), 12):
+        out.append("    %s," % ", ".join(str(o) for o in offsets[i:i + 12]))
+    out.append("};")
+    out.append("")
+    out.append("// Expanded length of each message in bytes")
+    out.append("static const uint8_t MSG_LENGTHS[MSG_CATALOG_COUNT] = {")
+    for i in range(0, len(messages), 12):
+        out.append("    %s," % ", ".join(str(len(data)) for _, data in messages[i:i + 12]))
+    out.append("};")
+    out.append("")
+    out.append("static const uint8_t MSG_STREAM[%d] = {" % len(blob))
+    for (ident, data), s in zip(messages, streams):
+        out.append("    // MSG_%s: %s" % (ident, c_comment_text(data)))
+        for i in range(0, len(s), 16):
+            out.append("    %s," % ", ".join(str(sym) for sym in s[i:i + 16]))
+    out.append("};")
+    out.append("")
+    out.append("#endif // MSG_CATALOG_H")
+    return "\n".join(out) + "\n"
+
+
+def main(argv):
+    if len(argv) != 3:
+        sys.exit(__doc__)
+    def_path, out_path = argv[1], argv[2]
+    messages = read_messages(def_path)
+    literals, pairs, streams, max_depth = byte_pair_encode(messages)
+    for (ident, data), s in zip(messages, streams):
+        if b"".join(expand(sym, literals, pairs) for sym in s) != data:
+            sys.exit(f"internal error: MSG({ident}) does not round-trip")
+    text = render(def_path, messages, literals, pairs, streams, max_depth)
+    os.makedirs(os.path.dirname(os.path.abspath(out_path)), exist_ok=True)
+    with open(out_path, "w", encoding="utf-8") as f:
+        f.write(text)
+
+
+if __name__ == "__main__":
+    main(sys.argv)
@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+"""Generate the shell's perfect-hash token table.
+
+Reads the SHELL_CMD / SHELL_DIAG / SHELL_WORD lines of src/shell_cmds.def and
+writes a header with one SHELL_TOK_* id per distinct token plus a slot table
+indexed by a seeded FNV-1a hash of the case-folded token. The seed is searched
+here so that no two tokens share a slot; shell.c then resolves any word with
+one hash, one table read and one string compare.
+
+    gen_shell_hash.py src/shell_cmds.def <out>/shell_cmd_hash.h
+"""
+
+import os
+import re
+import sys
+
+FNV_PRIME = 16777619
+MAX_SEED_TRIES = 200000
+ENTRY_RE = re.compile(r"^\s*SHELL_(CMD|DIAG|WORD)\(\s*([^,)\s]+)")
+TOKEN_RE = re.compile(r"^[a-z0-9_]+$")
+
+
+def token_hash(token, seed, bits):
+    """Must match shell_token_hash() in src/shell.c."""
+    h = seed
+    for ch in token.encode("ascii"):
+        h = ((h ^ ch) * FNV_PRIME) & 0xFFFFFFFF
+    return h >> (32 - bits)
+
+
+def read_tokens(def_path):
+    tokens = []
+    with open(def_path, encoding="utf-8") as f:
+        for lineno, line in enumerate(f, 1):
+            m = ENTRY_RE.match(line)
+            if not m:
+                continue
+            token = m.group(2)
+            if not TOKEN_RE.match(token):
+                sys.exit(f"{def_path}:{lineno}: token '{token}' must be lower case [a-z0-9_]")
+            if token not in tokens:
+                tokens.append(token)
+    if not tokens:
+        sys.exit(f"{def_path}: no shell tokens found")
+    if len(tokens) > 254:
+        sys.exit(f"{def_path}: too many tokens for uint8_t ids")
+    return tokens
+
+
+def find_seed(tokens):
+    bits = max(1, (len(tokens) - 1).bit_length())
+    while bits <= 10:
+        for seed in range(1, MAX_SEED_TRIES):
+            # Offset the FNV basis so seed 1 is the classic hash
+            basis = (2166136261 + seed - 1) & 0xFFFFFFFF
+            slots = {token_hash(t, basis, bits) for t in tokens}
+            if len(slots) == len(tokens):
+                return basis, bits
+        bits += 1
+    sys.exit("no perfect hash seed found")
+
+
+def render(def_path, tokens, seed, bits):
+    slots = [0xFF] * (1 << bits)
+    for idx, token in enumerate(tokens):
+        slots[token_hash(token, seed, bits)] = idx
+
+    out = []
+    out.append("// Generated by tools/gen_shell_hash.py from %s. Do not edit." % os.path.basename(def_path))
+    out.append("#ifndef SHELL_CMD_HASH_H")
+    out.append("#define SHELL_CMD_HASH_H")
+    out.append("")
+    out.append("#include <stdint.h>")
+    out.append("")
+    out.append("typedef enum {")
+    for token in tokens:
+        out.append("    SHELL_TOK_%s," % token.upper())
+    out.append("    SHELL_TOK_COUNT,")
+    out.append("    SHELL_TOK_NONE = 0xFF")
+    out.append("} ShellToken_t;")
+    out.append("")
+    out.append("// Lower-case spellings, for the X-macro tables built from the .def file")
+    for token in tokens:
+        out.append("#define SHELL_TOK_ID_%s SHELL_TOK_%s" % (token, token.upper()))
+    out.append("")
+    out.append("#define SHELL_HASH_SEED 0x%08XU" % seed)
+    out.append("#define SHELL_HASH_BITS %d" % bits)
+    out.append("")
+    out.append("static const char* const SHELL_TOKEN_NAMES[SHELL_TOK_COUNT] = {")
+    for token in tokens:
+        out.append('    "%s",' % token)
+    out.append("};")
+    out.append("")
+    out.append("// Hash slot -> token id (SHELL_TOK_NONE = empty)")
+    out.append("static const uint8_t SHELL_HASH_SLOTS[1U << SHELL_HASH_BITS] = {")
+    for i in range(0, len(slots), 8):
+        row = ", ".join("SHELL_TOK_%s" % tokens[s].upper() if s != 0xFF else "SHELL_TOK_NONE"
+                        for s in slots[i:i + 8])
+        out.append("    %s," % row)
+    out.append("};")
+    out.append("")
+    out.append("#endif // SHELL_CMD_HASH_H")
+    return "\n".join(out) + "\n"
+
+
+def main(argv):
+    if len(argv) != 3:
+        sys.exit(__doc__)
+    def_path, out_path = argv[1], argv[2]
+    tokens = read_tokens(def_path)
+    seed, bits = find_seed(tokens)
+    text = render(def_path, tokens, seed, bits)
+    os.makedirs(os.path.dirname(os.path.abspath(out_path)), exist_ok=True)
+    with open(out_path, "w", encoding="utf-8") as f:
+        f.write(text)
+
+
+if __name__ == "__main__":
+    main(sys.argv)
@@ -0,0 +1,24 @@
+# PlatformIO pre-build script: generates shell_cmd_hash.h (src/shell_cmds.def)
+# and msg_catalog.h (src/messages.def) into the build directory and puts them
+# on the include path.
+Import("env")
+
+import os
+import subprocess
+
+project_dir = env.subst("$PROJECT_DIR")
+out_dir = os.path.join(env.subst("$BUILD_DIR"), "generated")
+
+GENERATORS = [
+    ("gen_shell_hash.py", "shell_cmds.def", "shell_cmd_hash.h"),
+    ("gen_msg_catalog.py", "messages.def", "msg_catalog.h"),
+]
+
+for script, source, header in GENERATORS:
+    subprocess.check_call([
+        env.subst("$PYTHONEXE"),
+        os.path.join(project_dir, "tools", script),
+        os.path.join(project_dir, "src", source),
+        os.path.join(out_dir, header),
+    ])
+env.Append(CPPPATH=[out_dir])